@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Core/AttributeDefines.hpp"
+#include "Core/MacroDefines.hpp"
+
+#if defined(__SSSE3__)
+    #include <tmmintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace IRCCore
+{
+
+/** A set of characters to validate the names, with a lookup table.
+ *
+ * @details The SSSE3 validator looks up 16 bytes at a time in two 16 entry tables of the low and high nibbles, with pshufb.
+ *          Each distinct set of the low nibbles of a high nibble is a bit, so that a byte is in the class
+ *          if the bits of its low nibble and its high nibble intersect. It is exact if the class has 8 or less distinct sets,
+ *          which is true for the classes below. The other classes, or the CPUs without SSSE3 use the 256 entry table.
+ *          The loads are unaligned and never read past the given length.
+ */
+class CharClass
+{
+public:
+    typedef bool (*MemberFunc)(const unsigned char c);
+
+    /** Build the tables of the characters that isMember() returns true. */
+    explicit CharClass(MemberFunc isMember)
+        : mbNibbleExact(true)
+    {
+        unsigned short rowMasks[16];
+        for (int hi = 0; hi < 16; hi++)
+        {
+            rowMasks[hi] = 0;
+            for (int lo = 0; lo < 16; lo++)
+            {
+                mbMembers[hi * 16 + lo] = isMember(static_cast<unsigned char>(hi * 16 + lo));
+                rowMasks[hi] |= mbMembers[hi * 16 + lo] ? (1 << lo) : 0;
+            }
+        }
+
+        // A bit of each distinct set of the low nibbles
+        unsigned short distinctMasks[8];
+        int numDistinctMasks = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            mLoNibbleBits[i] = 0;
+            mHiNibbleBits[i] = 0;
+        }
+        for (int hi = 0; hi < 16 && mbNibbleExact; hi++)
+        {
+            if (rowMasks[hi] == 0)
+            {
+                continue;
+            }
+
+            int bit = 0;
+            for (; bit < numDistinctMasks && distinctMasks[bit] != rowMasks[hi]; bit++)
+            {
+            }
+            if (bit == numDistinctMasks)
+            {
+                if (numDistinctMasks == 8)
+                {
+                    mbNibbleExact = false;
+                    break;
+                }
+                distinctMasks[numDistinctMasks++] = rowMasks[hi];
+                for (int lo = 0; lo < 16; lo++)
+                {
+                    mLoNibbleBits[lo] |= ((rowMasks[hi] >> lo) & 1) ? (1 << bit) : 0;
+                }
+            }
+            mHiNibbleBits[hi] = static_cast<unsigned char>(1 << bit);
+        }
+    }
+
+    FORCEINLINE bool IsMember(const char c) const
+    {
+        return mbMembers[static_cast<unsigned char>(c)];
+    }
+
+    /** The nibble tables are exact, and FindNonMemberSsse3() can be used. */
+    FORCEINLINE bool IsNibbleExact() const
+    {
+        return mbNibbleExact;
+    }
+
+    /** Index of the first character not in the class in [str, str + len), or len if all are in it. */
+    FORCEINLINE size_t FindNonMemberScalar(const char* str, const size_t len) const
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            if (!IsMember(str[i]))
+            {
+                return i;
+            }
+        }
+        return len;
+    }
+
+#if defined(__SSSE3__)
+    FORCEINLINE size_t FindNonMemberSsse3(const char* str, const size_t len) const
+    {
+        Assert(mbNibbleExact);
+        const __m128i loNibbleBits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mLoNibbleBits));
+        const __m128i hiNibbleBits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mHiNibbleBits));
+        const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        size_t i = 0;
+        for (; i + 16 <= len; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            const __m128i loBits = _mm_shuffle_epi8(loNibbleBits, _mm_and_si128(chunk, nibbleMask));
+            const __m128i hiBits = _mm_shuffle_epi8(hiNibbleBits, _mm_and_si128(_mm_srli_epi16(chunk, 4), nibbleMask));
+            const __m128i nonMembers = _mm_cmpeq_epi8(_mm_and_si128(loBits, hiBits), _mm_setzero_si128());
+            const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(nonMembers));
+            if (mask != 0)
+            {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        return i + FindNonMemberScalar(str + i, len - i);
+    }
+#endif
+
+    /** Index of the first character not in the class in [str, str + len), or len if all are in it, with the fastest validator of the CPU. */
+    FORCEINLINE size_t FindNonMember(const char* str, const size_t len) const
+    {
+#if defined(__SSSE3__)
+        if (LIKELY(mbNibbleExact))
+        {
+            return FindNonMemberSsse3(str, len);
+        }
+#endif
+        return FindNonMemberScalar(str, len);
+    }
+
+    /** All characters of [str, str + len) are in the class. */
+    FORCEINLINE bool IsValid(const char* str, const size_t len) const
+    {
+        return FindNonMember(str, len) == len;
+    }
+
+private:
+    bool mbMembers[256];
+    unsigned char mLoNibbleBits[16];
+    unsigned char mHiNibbleBits[16];
+    bool mbNibbleExact;
+};
+
+namespace detail
+{
+    FORCEINLINE bool IsAlnumChar(const unsigned char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    }
+
+    FORCEINLINE bool IsNicknameChar(const unsigned char c)
+    {
+        return IsAlnumChar(c) || c == '_';
+    }
+
+    FORCEINLINE bool IsUserParamChar(const unsigned char c)
+    {
+        return IsAlnumChar(c) || c == '_' || c == '*';
+    }
+
+    // RFC 2812 chanstring. Any octet except NUL, BEL, CR, LF, ' ', ',' and ':'.
+    FORCEINLINE bool IsChannelChar(const unsigned char c)
+    {
+        return c != '\0' && c != '\a' && c != '\r' && c != '\n' && c != ' ' && c != ',' && c != ':';
+    }
+
+    // RFC 2812 key. Any 7-bit character except NUL, CR, LF, FF, tabs and ' ', and ',' that separates the keys.
+    FORCEINLINE bool IsKeyChar(const unsigned char c)
+    {
+        return c > 0 && c < 0x80 && c != '\r' && c != '\n' && c != '\f' && c != '\t' && c != '\v' && c != ' ' && c != ',';
+    }
+}
+
+/** Letters, digits and '_'. */
+FORCEINLINE const CharClass& GetNicknameCharClass()
+{
+    static const CharClass charClass(detail::IsNicknameChar);
+    return charClass;
+}
+
+/** Letters, digits, '_' and '*'. The parameters of the USER. */
+FORCEINLINE const CharClass& GetUserParamCharClass()
+{
+    static const CharClass charClass(detail::IsUserParamChar);
+    return charClass;
+}
+
+/** Characters of the channel name, including the prefix. */
+FORCEINLINE const CharClass& GetChannelCharClass()
+{
+    static const CharClass charClass(detail::IsChannelChar);
+    return charClass;
+}
+
+/** Characters of the channel key. */
+FORCEINLINE const CharClass& GetKeyCharClass()
+{
+    static const CharClass charClass(detail::IsKeyChar);
+    return charClass;
+}
+
+/** A part of a string. Not NULL terminated. */
+struct StrView
+{
+    const char* Str;
+    size_t Len;
+};
+
+/** Split the comma separated list into the views of the non-empty items, without modifying it.
+ *
+ *  @param str          The list.
+ *  @param len          Length of the list.
+ *  @param outItems     [out] Array to receive the items in order.
+ *  @param maxNumItems  Size of the outItems. The items after it are not stored.
+ *  @return             Number of the stored items.
+ */
+FORCEINLINE size_t SplitCommaListScalar(const char* str, const size_t len, StrView* outItems, const size_t maxNumItems)
+{
+    size_t numItems = 0;
+    size_t itemStart = 0;
+    for (size_t i = 0; i <= len && numItems < maxNumItems; i++)
+    {
+        if (i == len || str[i] == ',')
+        {
+            if (i > itemStart)
+            {
+                outItems[numItems].Str = str + itemStart;
+                outItems[numItems].Len = i - itemStart;
+                numItems++;
+            }
+            itemStart = i + 1;
+        }
+    }
+    return numItems;
+}
+
+#if defined(__SSE2__)
+/** SplitCommaListScalar() that finds the commas of 16 bytes at a time. */
+FORCEINLINE size_t SplitCommaListSse2(const char* str, const size_t len, StrView* outItems, const size_t maxNumItems)
+{
+    const __m128i commas = _mm_set1_epi8(',');
+    size_t numItems = 0;
+    size_t itemStart = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, commas)));
+        for (; mask != 0 && numItems < maxNumItems; mask &= mask - 1)
+        {
+            const size_t commaIdx = i + __builtin_ctz(mask);
+            if (commaIdx > itemStart)
+            {
+                outItems[numItems].Str = str + itemStart;
+                outItems[numItems].Len = commaIdx - itemStart;
+                numItems++;
+            }
+            itemStart = commaIdx + 1;
+        }
+    }
+    // The last item from the itemStart, that has no comma before the tail
+    return numItems + SplitCommaListScalar(str + itemStart, len - itemStart, outItems + numItems, maxNumItems - numItems);
+}
+#endif
+
+/** Split the comma separated list with the fastest splitter of the CPU. (See SplitCommaListScalar()) */
+FORCEINLINE size_t SplitCommaList(const char* str, const size_t len, StrView* outItems, const size_t maxNumItems)
+{
+#if defined(__SSE2__)
+    return SplitCommaListSse2(str, len, outItems, maxNumItems);
+#else
+    return SplitCommaListScalar(str, len, outItems, maxNumItems);
+#endif
+}
+
+} // namespace IRCCore
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Core/AttributeDefines.hpp"
+#include "Core/MacroDefines.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define IRCCORE_CHAR_SCAN_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace IRCCore
+{
+
+/** Scanners of the received bytes.
+ *
+ * @details The AVX2 scanner compares 32 bytes at a time, and the SSE2 one 16 bytes.
+ *          The build flags (-mavx) do not enable AVX2, so the AVX2 scanner is compiled with the target attribute
+ *          and selected at run time by IsAvx2Supported(). The other CPUs use SSE2, or the scalar loop.
+ *          The loads are unaligned and never read past the given length.
+ */
+
+/** Index of the first '\n' in [str, str + len), or len if there is none. */
+FORCEINLINE size_t FindLineFeedScalar(const char* str, const size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (str[i] == '\n')
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+#if defined(__SSE2__)
+FORCEINLINE size_t FindLineFeedSse2(const char* str, const size_t len)
+{
+    const __m128i lineFeeds = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lineFeeds)));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + FindLineFeedScalar(str + i, len - i);
+}
+#endif
+
+#if defined(IRCCORE_CHAR_SCAN_AVX2)
+__attribute__((target("avx2"))) inline size_t FindLineFeedAvx2(const char* str, const size_t len)
+{
+    const __m256i lineFeeds = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, lineFeeds)));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    // The tail of 16 bytes or more
+    if (i + 16 <= len)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(lineFeeds))));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+        i += 16;
+    }
+    return i + FindLineFeedScalar(str + i, len - i);
+}
+
+/** The CPU supports AVX2. Checked once. */
+FORCEINLINE bool IsAvx2Supported()
+{
+    static const bool bSupported = __builtin_cpu_supports("avx2");
+    return bSupported;
+}
+#endif
+
+/** Index of the first '\n' in [str, str + len), or len if there is none, with the fastest scanner of the CPU. */
+FORCEINLINE size_t FindLineFeed(const char* str, const size_t len)
+{
+#if defined(IRCCORE_CHAR_SCAN_AVX2)
+    if (LIKELY(IsAvx2Supported()))
+    {
+        return FindLineFeedAvx2(str, len);
+    }
+#endif
+#if defined(__SSE2__)
+    return FindLineFeedSse2(str, len);
+#else
+    return FindLineFeedScalar(str, len);
+#endif
+}
+
+} // namespace IRCCore
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <time.h>
+
+#include "Core/AttributeDefines.hpp"
+#include "Core/FixedWidthType.hpp"
+
+namespace IRCCore
+{
+
+/** Microseconds of the monotonic clock. It is not affected by the change of the system time. */
+FORCEINLINE uint64_t GetMonotonicMicrosec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+/** Nanoseconds of the system time. The clock of the kernel receive timestamps. (SO_TIMESTAMPNS) */
+FORCEINLINE uint64_t GetRealtimeNanosec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/** Size of the string of FormatUtcTime() with the NULL character. */
+static const size_t UTC_TIME_STR_SIZE = sizeof("YYYY-MM-DDThh:mm:ss.sssZ");
+
+/** Format the system time in UTC with milliseconds, "YYYY-MM-DDThh:mm:ss.sssZ". (IRCv3 server-time)
+ *
+ *  @param realtimeNanosec  Nanoseconds of the system time. (See GetRealtimeNanosec())
+ *  @param outStr           [out] UTC_TIME_STR_SIZE bytes to receive the NULL terminated string.
+ */
+FORCEINLINE void FormatUtcTime(const uint64_t realtimeNanosec, char* outStr)
+{
+    const time_t sec = static_cast<time_t>(realtimeNanosec / 1000000000);
+    const unsigned int millisec = static_cast<unsigned int>(realtimeNanosec / 1000000 % 1000);
+    struct tm utc;
+    gmtime_r(&sec, &utc);
+    strftime(outStr, UTC_TIME_STR_SIZE, "%Y-%m-%dT%H:%M:%S", &utc);
+
+    char* p = outStr + sizeof("YYYY-MM-DDThh:mm:ss") - 1;
+    *p++ = '.';
+    *p++ = static_cast<char>('0' + millisec / 100);
+    *p++ = static_cast<char>('0' + millisec / 10 % 10);
+    *p++ = static_cast<char>('0' + millisec % 10);
+    *p++ = 'Z';
+    *p = '\0';
+}
+
+} // namespace IRCCore
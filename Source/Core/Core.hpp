@@ -9,6 +9,11 @@
 #include "Core/FixedMemoryPool.hpp"
 
 #include "Core/FixedWidthType.hpp"
+#include "Core/Clock.hpp"
+#include "Core/TimerWheel.hpp"
+#include "Core/LatencyHistogram.hpp"
+#include "Core/CharScan.hpp"
+#include "Core/CharClass.hpp"
 #include "Core/GlobalConstants.hpp"
 #include "Core/Log.hpp"
 #include "Core/MacroDefines.hpp"
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+
+#include "Core/AttributeDefines.hpp"
+#include "Core/FixedWidthType.hpp"
+#include "Core/MacroDefines.hpp"
+
+namespace IRCCore
+{
+
+/** Histogram of the latencies in microseconds with the power of 2 buckets.
+ *
+ * @details The bucket N counts the latencies in [2^(N-1), 2^N), and the bucket 0 counts 0.
+ *          Add() is a bit scan and an increment, so it can be called on every event.
+ *          The percentiles are the upper bounds of the buckets, so they are at most 2 times of the real ones.
+ */
+class LatencyHistogram
+{
+public:
+    enum { NUM_BUCKETS = 32 };
+
+    FORCEINLINE LatencyHistogram()
+    {
+        Reset();
+    }
+
+    FORCEINLINE void Reset()
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+        {
+            mBuckets[i] = 0;
+        }
+        mNumSamples = 0;
+        mMaxMicrosec = 0;
+    }
+
+    FORCEINLINE void Add(const uint64_t latencyMicrosec)
+    {
+        mBuckets[getBucketIdx(latencyMicrosec)]++;
+        mNumSamples++;
+        if (latencyMicrosec > mMaxMicrosec)
+        {
+            mMaxMicrosec = latencyMicrosec;
+        }
+    }
+
+    FORCEINLINE uint64_t GetNumSamples() const { return mNumSamples; }
+    FORCEINLINE uint64_t GetMaxMicrosec() const { return mMaxMicrosec; }
+
+    /** Upper bound of the bucket where the per-mille rank (0 ~ 1000) falls, or 0 if there is no sample. (ex. 999 for p999) */
+    uint64_t GetPerMilleMicrosec(const unsigned int perMille) const
+    {
+        if (mNumSamples == 0)
+        {
+            return 0;
+        }
+
+        // Rank of the sample, from 1.
+        const uint64_t rank = (mNumSamples * perMille + 999) / 1000;
+        uint64_t numCounted = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++)
+        {
+            numCounted += mBuckets[i];
+            if (numCounted >= rank && numCounted != 0)
+            {
+                return (i == 0) ? 0 : (static_cast<uint64_t>(1) << i) - 1;
+            }
+        }
+        return mMaxMicrosec;
+    }
+
+    /** "samples=.. p50=.. p99=.. p999=.. max=.. [<2us:N <4us:N ..]" with the non-empty buckets. */
+    std::string ToString() const
+    {
+        std::stringstream ss;
+        ss << "samples=" << mNumSamples
+           << " p50=" << GetPerMilleMicrosec(500) << " p99=" << GetPerMilleMicrosec(990) << " p999=" << GetPerMilleMicrosec(999)
+           << " max=" << mMaxMicrosec << " [";
+        bool bFirst = true;
+        for (int i = 0; i < NUM_BUCKETS; i++)
+        {
+            if (mBuckets[i] == 0)
+            {
+                continue;
+            }
+            ss << (bFirst ? "" : " ") << "<" << (static_cast<uint64_t>(1) << i) << "us:" << mBuckets[i];
+            bFirst = false;
+        }
+        ss << "]";
+        return ss.str();
+    }
+
+private:
+    static FORCEINLINE int getBucketIdx(const uint64_t latencyMicrosec)
+    {
+        if (latencyMicrosec == 0)
+        {
+            return 0;
+        }
+#if defined(__GNUC__)
+        const int numBits = 64 - __builtin_clzll(latencyMicrosec);
+#else
+        int numBits = 0;
+        for (uint64_t bits = latencyMicrosec; bits != 0; bits >>= 1)
+        {
+            numBits++;
+        }
+#endif
+        return (numBits < NUM_BUCKETS) ? numBits : NUM_BUCKETS - 1;
+    }
+
+private:
+    uint64_t mBuckets[NUM_BUCKETS];
+    uint64_t mNumSamples;
+    uint64_t mMaxMicrosec;
+};
+
+} // namespace IRCCore
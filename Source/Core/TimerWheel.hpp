@@ -0,0 +1,286 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/AttributeDefines.hpp"
+#include "Core/FixedWidthType.hpp"
+#include "Core/MacroDefines.hpp"
+
+namespace IRCCore
+{
+
+/** Hierarchical timer wheel with O(1) schedule and cancel.
+ *
+ * @details The time is counted in ticks, and the unit of a tick is up to the user.
+ *          There are NUM_LEVELS wheels of NUM_SLOTS slots. A timer is placed in the lowest level that covers the remaining ticks,
+ *          and moved down (cascaded) when the higher level slot is reached. Then it expires in the slot of the level 0.
+ *
+ *          The timers are linked into the slots intrusively, so the wheel does not allocate.
+ *          Each level has an occupancy bitmap of the slots, so that the next tick to process is found without scanning the slots.
+ *          Advance() jumps over the ticks with nothing to do, and GetNextEventTick() gives the timeout to wait for.
+ *
+ * @warning A timer must be canceled before it is destroyed.
+ */
+class TimerWheel
+{
+public:
+    enum
+    {
+        SLOT_BITS   = 6,
+        NUM_SLOTS   = 1 << SLOT_BITS,
+        NUM_LEVELS  = 4,
+        SLOT_MASK   = NUM_SLOTS - 1,
+        NO_SLOT     = -1
+    };
+
+    /** Max ticks from the current tick to schedule. A later timer is clamped to it. */
+    static const uint64_t MAX_DELAY_TICKS = (static_cast<uint64_t>(1) << (SLOT_BITS * NUM_LEVELS)) - 1;
+
+    /** Returned by GetNextEventTick() if there is no timer. */
+    static const uint64_t NO_EVENT_TICK = ~static_cast<uint64_t>(0);
+
+    /** Node linked into a slot. Embed in the owner. */
+    struct Timer
+    {
+        Timer* Prev;
+        Timer* Next;
+        uint64_t ExpireTick;
+
+        /** Index of the slot in the wheel (Level * NUM_SLOTS + Slot), or NO_SLOT if not scheduled. */
+        int SlotIdx;
+
+        /** Passed back by Advance(). */
+        void* Owner;
+
+        FORCEINLINE Timer()
+            : Prev(NULL)
+            , Next(NULL)
+            , ExpireTick(0)
+            , SlotIdx(NO_SLOT)
+            , Owner(NULL)
+        {
+        }
+
+        FORCEINLINE bool IsScheduled() const { return SlotIdx != NO_SLOT; }
+    };
+
+    /** @param currentTick The tick to start from. */
+    explicit TimerWheel(const uint64_t currentTick = 0)
+        : mCurrentTick(currentTick)
+        , mNumTimers(0)
+    {
+        for (int level = 0; level < NUM_LEVELS; level++)
+        {
+            mOccupancy[level] = 0;
+        }
+        for (int slotIdx = 0; slotIdx < NUM_LEVELS * NUM_SLOTS; slotIdx++)
+        {
+            mSlots[slotIdx].Prev = &mSlots[slotIdx];
+            mSlots[slotIdx].Next = &mSlots[slotIdx];
+        }
+    }
+
+    /** Set the current tick of an empty wheel. */
+    FORCEINLINE void Reset(const uint64_t currentTick)
+    {
+        Assert(mNumTimers == 0);
+        mCurrentTick = currentTick;
+    }
+
+    FORCEINLINE uint64_t GetCurrentTick() const { return mCurrentTick; }
+    FORCEINLINE size_t GetNumTimers() const { return mNumTimers; }
+
+    /** Schedule the timer to expire at the tick. A scheduled timer is moved.
+     *  A tick not after the current tick expires at the next tick.
+     */
+    FORCEINLINE void Schedule(Timer& timer, const uint64_t expireTick)
+    {
+        if (timer.IsScheduled())
+        {
+            unlink(timer);
+        }
+        else
+        {
+            mNumTimers++;
+        }
+        timer.ExpireTick = expireTick;
+        link(timer, mCurrentTick + 1);
+    }
+
+    FORCEINLINE void Cancel(Timer& timer)
+    {
+        if (timer.IsScheduled())
+        {
+            unlink(timer);
+            mNumTimers--;
+        }
+    }
+
+    /** The first tick after the current tick that Advance() has something to do, or NO_EVENT_TICK.
+     *
+     *  @details It is the expiry of a timer in the level 0, or the cascade of a higher level slot.
+     *           So it is not later than the next expiry, and can be earlier.
+     */
+    uint64_t GetNextEventTick() const
+    {
+        uint64_t nextTick = NO_EVENT_TICK;
+        for (int level = 0; level < NUM_LEVELS; level++)
+        {
+            if (mOccupancy[level] == 0)
+            {
+                continue;
+            }
+
+            // The slots are visited in the order from the next one.
+            // A level 0 slot is visited every tick, and a higher level slot when the lower levels wrap around.
+            const int shift = level * SLOT_BITS;
+            const uint64_t baseTick = (mCurrentTick >> shift) + 1;
+            const unsigned int startSlot = static_cast<unsigned int>(baseTick & SLOT_MASK);
+            const uint64_t rotated = rotateRight(mOccupancy[level], startSlot);
+            const uint64_t eventTick = (baseTick + countTrailingZeros(rotated)) << shift;
+            if (eventTick < nextTick)
+            {
+                nextTick = eventTick;
+            }
+        }
+        return nextTick;
+    }
+
+    /** Advance to the tick, and append the owners of the expired timers to outExpiredOwners.
+     *  The expired timers are not scheduled anymore, and can be scheduled again.
+     *
+     *  @return Number of the expired timers.
+     */
+    size_t Advance(const uint64_t tick, std::vector<void*>& outExpiredOwners)
+    {
+        size_t numExpired = 0;
+        while (mCurrentTick < tick)
+        {
+            // Jump over the ticks with nothing to do.
+            const uint64_t nextTick = GetNextEventTick();
+            if (nextTick > tick)
+            {
+                mCurrentTick = tick;
+                break;
+            }
+            mCurrentTick = nextTick;
+
+            // Cascade from the highest level, so that the timers moved down are cascaded again in this tick.
+            for (int level = NUM_LEVELS - 1; level > 0; level--)
+            {
+                const int shift = level * SLOT_BITS;
+                if ((mCurrentTick & ((static_cast<uint64_t>(1) << shift) - 1)) != 0)
+                {
+                    continue;
+                }
+                Timer& slot = mSlots[level * NUM_SLOTS + ((mCurrentTick >> shift) & SLOT_MASK)];
+                while (slot.Next != &slot)
+                {
+                    Timer& timer = *slot.Next;
+                    unlink(timer);
+                    link(timer, mCurrentTick);
+                }
+            }
+
+            Timer& slot = mSlots[mCurrentTick & SLOT_MASK];
+            while (slot.Next != &slot)
+            {
+                Timer& timer = *slot.Next;
+                Assert(timer.ExpireTick <= mCurrentTick);
+                unlink(timer);
+                mNumTimers--;
+                outExpiredOwners.push_back(timer.Owner);
+                numExpired++;
+            }
+        }
+        return numExpired;
+    }
+
+private:
+    /** @param minTick  A passed timer is scheduled at the next tick. A cascaded timer can expire in the current tick. */
+    FORCEINLINE void link(Timer& timer, const uint64_t minTick)
+    {
+        uint64_t expireTick = timer.ExpireTick;
+        if (expireTick < minTick)
+        {
+            expireTick = minTick;
+        }
+        else if (expireTick - mCurrentTick > MAX_DELAY_TICKS)
+        {
+            expireTick = mCurrentTick + MAX_DELAY_TICKS;
+        }
+        timer.ExpireTick = expireTick;
+
+        // The lowest level that covers the remaining ticks.
+        const uint64_t delay = expireTick - mCurrentTick;
+        int level = 0;
+        while (level < NUM_LEVELS - 1 && delay >= (static_cast<uint64_t>(1) << (SLOT_BITS * (level + 1))))
+        {
+            level++;
+        }
+        const int slot = static_cast<int>((expireTick >> (SLOT_BITS * level)) & SLOT_MASK);
+
+        Timer& head = mSlots[level * NUM_SLOTS + slot];
+        timer.Prev = head.Prev;
+        timer.Next = &head;
+        head.Prev->Next = &timer;
+        head.Prev = &timer;
+        timer.SlotIdx = level * NUM_SLOTS + slot;
+        mOccupancy[level] |= static_cast<uint64_t>(1) << slot;
+    }
+
+    FORCEINLINE void unlink(Timer& timer)
+    {
+        Assert(timer.IsScheduled());
+        timer.Prev->Next = timer.Next;
+        timer.Next->Prev = timer.Prev;
+
+        // Clear the occupancy bit if the slot became empty.
+        Timer& head = mSlots[timer.SlotIdx];
+        if (head.Next == &head)
+        {
+            mOccupancy[timer.SlotIdx / NUM_SLOTS] &= ~(static_cast<uint64_t>(1) << (timer.SlotIdx % NUM_SLOTS));
+        }
+        timer.Prev = NULL;
+        timer.Next = NULL;
+        timer.SlotIdx = NO_SLOT;
+    }
+
+    static FORCEINLINE uint64_t rotateRight(const uint64_t bits, const unsigned int count)
+    {
+        return (count == 0) ? bits : ((bits >> count) | (bits << (NUM_SLOTS - count)));
+    }
+
+    /** @warning bits must not be 0. */
+    static FORCEINLINE unsigned int countTrailingZeros(const uint64_t bits)
+    {
+        Assert(bits != 0);
+#if defined(__GNUC__)
+        return static_cast<unsigned int>(__builtin_ctzll(bits));
+#else
+        unsigned int count = 0;
+        while ((bits & (static_cast<uint64_t>(1) << count)) == 0)
+        {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+private:
+    uint64_t mCurrentTick;
+    size_t mNumTimers;
+
+    /** Bit N of a level is set if the slot N is not empty. */
+    uint64_t mOccupancy[NUM_LEVELS];
+
+    /** Head of the circular list of each slot. */
+    Timer mSlots[NUM_LEVELS * NUM_SLOTS];
+
+private:
+    /** @warning Copy is not allowed. The timers point to the slots. */
+    TimerWheel(const TimerWheel& rhs);
+    TimerWheel& operator=(const TimerWheel& rhs);
+};
+
+} // namespace IRCCore
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+namespace IRC
+{
+
+/** Event queue backend using native Linux epoll.
+ *
+ * @details Emulates the kqueue model the server is written for, so that the event loop does not need to know the backend.
+ *          \li A change is a (socket, filter, flags, udata) tuple like kevent.
+ *              The per-socket filters are merged into one epoll interest mask and applied with epoll_ctl().
+ *          \li An epoll_event that is readable and writable at the same time is split into a READ event and a WRITE event.
+ *          \li epoll_event can carry only one of fd or pointer, so the udata is kept in a table indexed by the socket descriptor.
+ *              Descriptors are small dense integers, so it is a single array access per event.
+ *          \li A failed change is reported as an observed event with FLAG_ERROR like kevent, if there is room in the event list.
+ *          \li EPOLLHUP/EPOLLRDHUP is a READ event with FLAG_EOF (and FLAG_ERROR with EPOLLERR). EPOLLERR alone is a READ event with FLAG_ERROR only.
+ *          \li FLAG_CLEAR makes the socket edge-triggered (EPOLLET). It applies to all filters of the socket.
+ *              FLAG_DISABLE/FLAG_ENABLE remove/add the filter from the interest mask but keep the udata.
+ *              FLAG_ENABLE always re-arms the socket, so that a filter that is ready already is observed again.
+ *              The edge-triggered mode is kept while all filters of the socket are disabled.
+ *
+ * @see     EventQueue, KqueueEventQueue
+ */
+class EpollEventQueue
+{
+public:
+    /** Mirror of the fields of kevent used by the server. */
+    struct Event
+    {
+        uintptr_t       ident;
+        short           filter;
+        unsigned short  flags;
+        void*           udata;
+    };
+
+    enum EFilter {
+        FILTER_READ   = -1,
+        FILTER_WRITE  = -2,
+        FILTER_ACCEPT = FILTER_READ
+    };
+
+    enum EFlag {
+        FLAG_ADD     = 0x0001,
+        FLAG_DELETE  = 0x0002,
+        FLAG_ENABLE  = 0x0004,
+        FLAG_DISABLE = 0x0008,
+        FLAG_CLEAR   = 0x0020,
+        FLAG_ERROR   = 0x4000,
+        FLAG_EOF     = 0x8000
+    };
+
+    FORCEINLINE EpollEventQueue()
+        : mhEpoll(-1)
+        , mUdataTable()
+        , mInterestTable()
+        , mNativeEvents()
+    {
+    }
+
+    FORCEINLINE ~EpollEventQueue()
+    {
+        Destroy();
+    }
+
+    /** Name of the backend for logging. */
+    static FORCEINLINE const char* GetBackendName()
+    {
+        return "epoll";
+    }
+
+    /** Fill the event to register or observe. (Same as EV_SET) */
+    static FORCEINLINE void SetEvent(Event& outEvent, const int hSocket, const short filter, const unsigned short flags, void* udataOpt)
+    {
+        outEvent.ident  = hSocket;
+        outEvent.filter = filter;
+        outEvent.flags  = flags;
+        outEvent.udata  = udataOpt;
+    }
+
+    /** @return false if failed to create epoll. */
+    bool Create()
+    {
+        Assert(mhEpoll == -1);
+
+        mhEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (mhEpoll == -1)
+        {
+            return false;
+        }
+
+        mUdataTable.reserve(DESCRIPTOR_TABLE_RESERVE);
+        mInterestTable.reserve(DESCRIPTOR_TABLE_RESERVE);
+        return true;
+    }
+
+    void Destroy()
+    {
+        if (mhEpoll != -1)
+        {
+            close(mhEpoll);
+            mhEpoll = -1;
+        }
+        mUdataTable.clear();
+        mInterestTable.clear();
+    }
+
+    /** Apply the change list and wait for the observed events. (Same as kevent())
+     *
+     * @param changes       Events to register/modify/delete. Can be NULL if numChanges is 0.
+     * @param numChanges    Number of the changes.
+     * @param outEvents     [out] Array to receive the observed events.
+     * @param maxEvents     Capacity of the outEvents. If 0, only the changes are applied.
+     * @param timeoutOpt    NULL to wait indefinitely.
+     * @return              Number of the observed events, or -1 on error.
+     */
+    int Wait(const Event* changes, const int numChanges, Event* outEvents, const int maxEvents, const struct timespec* timeoutOpt)
+    {
+        Assert(mhEpoll != -1);
+
+        // Apply the changes
+        int numEvents = 0;
+        for (int i = 0; i < numChanges; i++)
+        {
+            if (UNLIKELY(applyChange(changes[i]) == false) && numEvents < maxEvents)
+            {
+                SetEvent(outEvents[numEvents], static_cast<int>(changes[i].ident), changes[i].filter, FLAG_ERROR, changes[i].udata);
+                numEvents++;
+            }
+        }
+
+        if (maxEvents == 0 || numEvents > 0)
+        {
+            return numEvents;
+        }
+
+        // Each native event can be split into two events (READ and WRITE).
+        const int maxNativeEvents = (maxEvents + 1) / 2;
+        if (mNativeEvents.size() < static_cast<size_t>(maxNativeEvents))
+        {
+            mNativeEvents.resize(maxNativeEvents);
+        }
+
+        int timeoutMs = -1;
+        if (timeoutOpt != NULL)
+        {
+            const long NANOSEC_PER_MILLISEC = 1000000;
+            timeoutMs = static_cast<int>(timeoutOpt->tv_sec * 1000 + (timeoutOpt->tv_nsec + NANOSEC_PER_MILLISEC - 1) / NANOSEC_PER_MILLISEC);
+        }
+
+        const int numNativeEvents = epoll_wait(mhEpoll, &mNativeEvents[0], maxNativeEvents, timeoutMs);
+        if (numNativeEvents == -1)
+        {
+            // Same as kevent, a signal is not an error but a spurious wakeup.
+            return (errno == EINTR) ? 0 : -1;
+        }
+
+        // Translate to the kqueue style events
+        for (int i = 0; i < numNativeEvents; i++)
+        {
+            const struct epoll_event& nativeEvent = mNativeEvents[i];
+            const int       hSocket = nativeEvent.data.fd;
+            const uint32_t  mask    = nativeEvent.events;
+            void* const     udata   = mUdataTable[hSocket];
+
+            if (UNLIKELY(mask & (EPOLLHUP | EPOLLRDHUP)))
+            {
+                const unsigned short flags = (mask & EPOLLERR) ? (FLAG_EOF | FLAG_ERROR) : FLAG_EOF;
+                SetEvent(outEvents[numEvents++], hSocket, FILTER_READ, flags, udata);
+                continue;
+            }
+
+            // An error without the hang-up can be a pending error or a message in the error queue. (ex. MSG_ZEROCOPY notification)
+            // The WRITE event observed together is kept, but the READ event is not. The user checks the socket.
+            if (UNLIKELY(mask & EPOLLERR))
+            {
+                SetEvent(outEvents[numEvents++], hSocket, FILTER_READ, FLAG_ERROR, udata);
+                if (mask & EPOLLOUT)
+                {
+                    SetEvent(outEvents[numEvents++], hSocket, FILTER_WRITE, 0, udata);
+                }
+                continue;
+            }
+
+            if (mask & EPOLLIN)
+            {
+                SetEvent(outEvents[numEvents++], hSocket, FILTER_READ, 0, udata);
+            }
+            if (mask & EPOLLOUT)
+            {
+                SetEvent(outEvents[numEvents++], hSocket, FILTER_WRITE, 0, udata);
+            }
+        }
+        Assert(numEvents <= maxEvents);
+
+        return numEvents;
+    }
+
+private:
+    /** @warning Copy is not allowed. */
+    EpollEventQueue(const EpollEventQueue& rhs);
+    EpollEventQueue& operator=(const EpollEventQueue& rhs);
+
+    /** Merge a kqueue style change into the interest mask of the socket and apply it.
+     *
+     * @return false if epoll_ctl() failed.
+     */
+    bool applyChange(const Event& change)
+    {
+        const int hSocket = static_cast<int>(change.ident);
+        Assert(hSocket >= 0);
+
+        if (static_cast<size_t>(hSocket) >= mInterestTable.size())
+        {
+            mUdataTable.resize(hSocket + 1, NULL);
+            mInterestTable.resize(hSocket + 1, 0);
+        }
+
+        uint32_t filterMask = 0;
+        switch (change.filter)
+        {
+        case FILTER_READ:
+            filterMask = EPOLLIN | EPOLLRDHUP;
+            break;
+        case FILTER_WRITE:
+            filterMask = EPOLLOUT;
+            break;
+        default:
+            Assume(0);
+        }
+
+        // The READ filter is the first registration of a new socket.
+        // Discard the stale interest of the closed socket that had the same descriptor number.
+        // (close() removes the socket from epoll automatically.)
+        uint32_t interest = mInterestTable[hSocket];
+        if ((change.flags & FLAG_ADD) && change.filter == FILTER_READ)
+        {
+            interest = 0;
+        }
+
+        const uint32_t prevInterest = interest;
+        if (change.flags & FLAG_ADD)
+        {
+            if (!(change.flags & FLAG_DISABLE))
+            {
+                interest |= filterMask;
+            }
+            mUdataTable[hSocket] = change.udata;
+        }
+        else if (change.flags & FLAG_ENABLE)
+        {
+            interest |= filterMask;
+        }
+        else if (change.flags & (FLAG_DELETE | FLAG_DISABLE))
+        {
+            interest &= ~filterMask;
+        }
+
+        if (change.flags & FLAG_CLEAR)
+        {
+            interest |= EPOLLET;
+        }
+
+        // Edge trigger flag alone is not a registration, but it is kept for the filter enabled later.
+        const bool bPrevRegistered = (prevInterest & ~EPOLLET) != 0;
+        const bool bRegistered     = (interest & ~EPOLLET) != 0;
+
+        // Not registered and nothing to register. (e.g. A DELETE or DISABLE of a filter that was never added)
+        // An empty interest must not be added, because epoll always reports EPOLLERR/EPOLLHUP of a registered socket
+        // and they would be the READ EOF events of a filter that was never added.
+        if (!bPrevRegistered && !bRegistered)
+        {
+            mInterestTable[hSocket] = interest;
+            return true;
+        }
+
+        // Nothing to apply. (e.g. A disabled filter is added)
+        if (interest == prevInterest && !(change.flags & FLAG_ENABLE))
+        {
+            return true;
+        }
+
+        struct epoll_event nativeEvent;
+        std::memset(&nativeEvent, 0, sizeof(nativeEvent));
+        nativeEvent.events  = interest;
+        nativeEvent.data.fd = hSocket;
+
+        int op = EPOLL_CTL_MOD;
+        if (!bPrevRegistered)
+        {
+            Assert(bRegistered);
+            op = EPOLL_CTL_ADD;
+        }
+        else if (!bRegistered)
+        {
+            op = EPOLL_CTL_DEL;
+        }
+
+        int result = epoll_ctl(mhEpoll, op, hSocket, &nativeEvent);
+        if (result == -1 && op == EPOLL_CTL_ADD && errno == EEXIST)
+        {
+            result = epoll_ctl(mhEpoll, EPOLL_CTL_MOD, hSocket, &nativeEvent);
+        }
+        else if (result == -1 && op == EPOLL_CTL_MOD && errno == ENOENT)
+        {
+            result = epoll_ctl(mhEpoll, EPOLL_CTL_ADD, hSocket, &nativeEvent);
+        }
+
+        mInterestTable[hSocket] = (result == -1) ? prevInterest : interest;
+        return result != -1;
+    }
+
+private:
+    enum { DESCRIPTOR_TABLE_RESERVE = 1024 };
+
+    int mhEpoll;
+
+    /** udata of the registered sockets. Indexed by the socket descriptor. */
+    std::vector<void*> mUdataTable;
+
+    /** Merged epoll interest mask of the registered sockets. Indexed by the socket descriptor. (0 means not registered) */
+    std::vector<uint32_t> mInterestTable;
+
+    /** Buffer to receive the native events from epoll_wait() */
+    std::vector<struct epoll_event> mNativeEvents;
+};
+
+} // namespace IRC
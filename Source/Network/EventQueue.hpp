@@ -0,0 +1,47 @@
+/** @file   Source/Network/EventQueue.hpp
+ *  @brief  Build time selection of the event queue backend.
+ *
+ *  @details The backend is selected with the IRC_EVENT_BACKEND_<NAME> macro (see Makefile EVENT_BACKEND).
+ *           If none is defined, epoll is used on Linux and kqueue on the others.
+ *
+ *           Every backend provides the same kqueue style interface, so that the event loop is written once.
+ *           \li Event     : Type of the change list and the observed event list. Has ident, filter, flags and udata fields.
+ *           \li EFilter   : FILTER_READ, FILTER_WRITE, FILTER_ACCEPT (Same as FILTER_READ except io_uring)
+ *           \li EFlag     : FLAG_ADD, FLAG_DELETE, FLAG_ENABLE, FLAG_DISABLE, FLAG_CLEAR(edge-triggered), FLAG_EOF, FLAG_ERROR
+ *           \li SetEvent(), Create(), Destroy(), Wait(), GetBackendName()
+ *
+ *           There is no virtual dispatch because there is only one backend in a build.
+ *
+ *           The io_uring backend is completion based, so the event loop has a few backend specific paths
+ *           for accepting, receiving and sending under IRC_EVENT_BACKEND_IO_URING. (See IoUringEventQueue)
+ */
+#pragma once
+
+#if !defined(IRC_EVENT_BACKEND_KQUEUE) && !defined(IRC_EVENT_BACKEND_EPOLL) && !defined(IRC_EVENT_BACKEND_IO_URING)
+    #if defined(__linux__)
+        #define IRC_EVENT_BACKEND_EPOLL
+    #else
+        #define IRC_EVENT_BACKEND_KQUEUE
+    #endif
+#endif
+
+#if defined(IRC_EVENT_BACKEND_EPOLL)
+    #include "Network/EpollEventQueue.hpp"
+#elif defined(IRC_EVENT_BACKEND_IO_URING)
+    #include "Network/IoUringEventQueue.hpp"
+#elif defined(IRC_EVENT_BACKEND_KQUEUE)
+    #include "Network/KqueueEventQueue.hpp"
+#endif
+
+namespace IRC
+{
+
+#if defined(IRC_EVENT_BACKEND_EPOLL)
+    typedef EpollEventQueue EventQueue;
+#elif defined(IRC_EVENT_BACKEND_IO_URING)
+    typedef IoUringEventQueue EventQueue;
+#elif defined(IRC_EVENT_BACKEND_KQUEUE)
+    typedef KqueueEventQueue EventQueue;
+#endif
+
+} // namespace IRC
@@ -0,0 +1,880 @@
+#pragma once
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <linux/io_uring.h>
+
+// <linux/fs.h> included by io_uring.h defines it, which conflicts with FlexibleFixedMemoryPool.
+#undef BLOCK_SIZE
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+#include "Server/MsgBlock.hpp"
+
+namespace IRC
+{
+
+/** Event queue backend using Linux io_uring. (Completion based)
+ *
+ * @details Unlike kqueue and epoll, the I/O itself is done by the kernel and only the results are observed.
+ *          It keeps the kqueue style interface of the other backends, but the meaning of the events differs.
+ *          \li FILTER_ACCEPT ADD arms a multishot accept request.
+ *              An observed READ event of the listen socket has the accepted socket in the data field.
+ *              Out of the file descriptors (EMFILE/ENFILE), it has -1 in the data field and the errno in the fflags field,
+ *              and the accept request is not re-armed until the next ENABLE.
+ *              FILTER_ACCEPT DISABLE cancels the accept request, and ENABLE arms it again.
+ *          \li FILTER_READ ADD arms a multishot recv request that receives into the provided buffer ring.
+ *              An observed READ event has the received bytes in the data field and the buffer id in the fflags field.
+ *              The received block is borrowed with GetRecvBuffer() or taken with TakeRecvBuffer() until the next Wait().
+ *          \li FILTER_WRITE ADD does not register anything. It is observed as a WRITE event with 0 data at the next Wait(),
+ *              which tells the event loop to submit the sending queue with SubmitSend().
+ *              An observed WRITE event with FLAG_REQUEST_DONE has the sent bytes of a finished send request.
+ *              FLAG_ENABLE is the same as FLAG_ADD, and a disabled ADD does nothing.
+ *          \li FILTER_READ DISABLE cancels the recv request like DELETE, and ENABLE arms a new one.
+ *              The canceled request is observed as a READ event with FLAG_REQUEST_DONE and 0 data.
+ *          \li FLAG_CLEAR is ignored. The completions are edge-triggered by nature.
+ *          \li FLAG_REQUEST_DONE is set on the last event of a request.
+ *              The udata (and the buffers of the send requests) must be kept alive until then.
+ *
+ *          The buffer ring is filled with pooled MsgBlock buffers, so the received bytes are handed to the
+ *          ClientControlBlock::RecvMsgBlocks without copy.
+ *          All requests made in a loop tick are submitted with a single io_uring_enter() in the next Wait().
+ *
+ * @note    Requires Linux 6.0 or later. (multishot recv, provided buffer ring)
+ * @see     EventQueue, KqueueEventQueue, EpollEventQueue
+ */
+class IoUringEventQueue
+{
+public:
+    /** Mirror of the fields of kevent used by the server. */
+    struct Event
+    {
+        uintptr_t       ident;
+        short           filter;
+        unsigned short  flags;
+        unsigned int    fflags;
+        intptr_t        data;
+        void*           udata;
+    };
+
+    enum EFilter {
+        FILTER_READ   = -1,
+        FILTER_WRITE  = -2,
+        FILTER_ACCEPT = -3
+    };
+
+    enum EFlag {
+        FLAG_ADD          = 0x0001,
+        FLAG_DELETE       = 0x0002,
+        FLAG_ENABLE       = 0x0004,
+        FLAG_DISABLE      = 0x0008,
+        FLAG_CLEAR        = 0x0020,
+        FLAG_REQUEST_DONE = 0x0100,
+        FLAG_ERROR        = 0x4000,
+        FLAG_EOF          = 0x8000
+    };
+
+    IoUringEventQueue()
+        : mhRing(-1)
+        , mRingFeatures(0)
+        , mSqRingPtr(NULL)
+        , mSqRingSize(0)
+        , mCqRingPtr(NULL)
+        , mCqRingSize(0)
+        , mSqes(NULL)
+        , mSqesSize(0)
+        , mSqHead(NULL)
+        , mSqTail(NULL)
+        , mSqMask(0)
+        , mSqEntries(0)
+        , mCqHead(NULL)
+        , mCqTail(NULL)
+        , mCqMask(0)
+        , mCqes(NULL)
+        , mNumUnsubmittedSqes(0)
+        , mBufRing(NULL)
+        , mBufRingSize(0)
+        , mBufRingTail(0)
+        , mRecvBuffers()
+        , mDeliveredBufferIds()
+        , mRecvRequestTable()
+        , mSyntheticEvents()
+        , mAcceptRequest(NULL)
+        , mbAcceptInFlight(false)
+        , mbAcceptEnabled(false)
+        , mLiveRequests(NULL)
+    {
+    }
+
+    ~IoUringEventQueue()
+    {
+        Destroy();
+    }
+
+    /** Name of the backend for logging. */
+    static FORCEINLINE const char* GetBackendName()
+    {
+        return "io_uring";
+    }
+
+    /** Fill the event to register or observe. (Same as EV_SET) */
+    static FORCEINLINE void SetEvent(Event& outEvent, const int hSocket, const short filter, const unsigned short flags, void* udataOpt)
+    {
+        outEvent.ident  = hSocket;
+        outEvent.filter = filter;
+        outEvent.flags  = flags;
+        outEvent.fflags = 0;
+        outEvent.data   = 0;
+        outEvent.udata  = udataOpt;
+    }
+
+    /** @return false if failed to create the ring or the kernel does not support the required features. */
+    bool Create()
+    {
+        Assert(mhRing == -1);
+
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = CQ_ENTRIES;
+
+        mhRing = static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+        if (mhRing == -1)
+        {
+            return false;
+        }
+        mRingFeatures = params.features;
+        if ((mRingFeatures & IORING_FEAT_EXT_ARG) == 0 || (mRingFeatures & IORING_FEAT_NODROP) == 0)
+        {
+            Destroy();
+            return false;
+        }
+
+        // Map the submission/completion rings and the submission entries
+        mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (mRingFeatures & IORING_FEAT_SINGLE_MMAP)
+        {
+            mSqRingSize = (mCqRingSize > mSqRingSize) ? mCqRingSize : mSqRingSize;
+        }
+
+        mSqRingPtr = mmap(NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mhRing, IORING_OFF_SQ_RING);
+        if (mSqRingPtr == MAP_FAILED)
+        {
+            mSqRingPtr = NULL;
+            Destroy();
+            return false;
+        }
+
+        if (mRingFeatures & IORING_FEAT_SINGLE_MMAP)
+        {
+            mCqRingPtr = mSqRingPtr;
+        }
+        else
+        {
+            mCqRingPtr = mmap(NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mhRing, IORING_OFF_CQ_RING);
+            if (mCqRingPtr == MAP_FAILED)
+            {
+                mCqRingPtr = NULL;
+                Destroy();
+                return false;
+            }
+        }
+
+        mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mhRing, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            Destroy();
+            return false;
+        }
+        mSqes = reinterpret_cast<struct io_uring_sqe*>(sqes);
+
+        char* sqRing = reinterpret_cast<char*>(mSqRingPtr);
+        mSqHead    = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.head);
+        mSqTail    = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.tail);
+        mSqMask    = *reinterpret_cast<unsigned int*>(sqRing + params.sq_off.ring_mask);
+        mSqEntries = *reinterpret_cast<unsigned int*>(sqRing + params.sq_off.ring_entries);
+
+        // The index array is an identity mapping to the submission entries.
+        unsigned int* sqArray = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.array);
+        for (unsigned int i = 0; i < mSqEntries; i++)
+        {
+            sqArray[i] = i;
+        }
+
+        char* cqRing = reinterpret_cast<char*>(mCqRingPtr);
+        mCqHead = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.tail);
+        mCqMask = *reinterpret_cast<unsigned int*>(cqRing + params.cq_off.ring_mask);
+        mCqes   = reinterpret_cast<struct io_uring_cqe*>(cqRing + params.cq_off.cqes);
+
+        // Register the provided buffer ring and fill it with the pooled message blocks
+        mBufRingSize = RECV_BUFFER_RING_ENTRIES * sizeof(struct io_uring_buf);
+        void* bufRing = mmap(NULL, mBufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bufRing == MAP_FAILED)
+        {
+            Destroy();
+            return false;
+        }
+        mBufRing = reinterpret_cast<struct io_uring_buf*>(bufRing);
+
+        struct io_uring_buf_reg bufReg;
+        std::memset(&bufReg, 0, sizeof(bufReg));
+        bufReg.ring_addr    = reinterpret_cast<uintptr_t>(mBufRing);
+        bufReg.ring_entries = RECV_BUFFER_RING_ENTRIES;
+        bufReg.bgid         = RECV_BUFFER_GROUP_ID;
+        if (syscall(__NR_io_uring_register, mhRing, IORING_REGISTER_PBUF_RING, &bufReg, 1) == -1)
+        {
+            Destroy();
+            return false;
+        }
+
+        mBufRingTail = 0;
+        mRecvBuffers.resize(RECV_BUFFER_RING_ENTRIES);
+        for (unsigned short bufferId = 0; bufferId < RECV_BUFFER_RING_ENTRIES; bufferId++)
+        {
+            mRecvBuffers[bufferId] = MakeShared<MsgBlock>();
+            addRecvBufferToRing(bufferId);
+        }
+        publishRecvBuffers();
+
+        mDeliveredBufferIds.reserve(RECV_BUFFER_RING_ENTRIES);
+        mRecvRequestTable.reserve(DESCRIPTOR_TABLE_RESERVE);
+        mSyntheticEvents.reserve(DESCRIPTOR_TABLE_RESERVE);
+
+        return true;
+    }
+
+    void Destroy()
+    {
+        // Closing the ring cancels all requests in the kernel.
+        if (mhRing != -1)
+        {
+            close(mhRing);
+            mhRing = -1;
+        }
+
+        if (mSqes != NULL)
+        {
+            munmap(mSqes, mSqesSize);
+            mSqes = NULL;
+        }
+        if (mCqRingPtr != NULL && mCqRingPtr != mSqRingPtr)
+        {
+            munmap(mCqRingPtr, mCqRingSize);
+        }
+        mCqRingPtr = NULL;
+        if (mSqRingPtr != NULL)
+        {
+            munmap(mSqRingPtr, mSqRingSize);
+            mSqRingPtr = NULL;
+        }
+        if (mBufRing != NULL)
+        {
+            munmap(mBufRing, mBufRingSize);
+            mBufRing = NULL;
+        }
+
+        while (mLiveRequests != NULL)
+        {
+            freeRequest(mLiveRequests);
+        }
+
+        mRecvBuffers.clear();
+        mDeliveredBufferIds.clear();
+        mRecvRequestTable.clear();
+        mSyntheticEvents.clear();
+        mAcceptRequest = NULL;
+        mbAcceptInFlight = false;
+        mbAcceptEnabled = false;
+        mNumUnsubmittedSqes = 0;
+    }
+
+    /** Give the buffers delivered by the previous Wait() back to the ring. A taken buffer is replaced with a new block.
+     *
+     * @warning Call before every Wait() after the buffers of its events are done with.
+     *          It is not done in Wait() because it allocates message blocks from the memory pool,
+     *          which the server accesses only with its state lock.
+     */
+    void RecycleRecvBuffers()
+    {
+        if (mDeliveredBufferIds.empty())
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < mDeliveredBufferIds.size(); i++)
+        {
+            const unsigned short bufferId = mDeliveredBufferIds[i];
+            if (mRecvBuffers[bufferId] == NULL)
+            {
+                mRecvBuffers[bufferId] = MakeShared<MsgBlock>();
+            }
+            mRecvBuffers[bufferId]->MsgLen = 0;
+            addRecvBufferToRing(bufferId);
+        }
+        mDeliveredBufferIds.clear();
+        publishRecvBuffers();
+    }
+
+    /** Apply the change list, submit all pending requests and wait for the completions.
+     *
+     * @param changes       Events to register/delete. Can be NULL if numChanges is 0.
+     * @param numChanges    Number of the changes.
+     * @param outEvents     [out] Array to receive the observed events.
+     * @param maxEvents     Capacity of the outEvents. If 0, only the changes are applied.
+     * @param timeoutOpt    NULL to wait indefinitely.
+     * @return              Number of the observed events, or -1 on error.
+     */
+    int Wait(const Event* changes, const int numChanges, Event* outEvents, const int maxEvents, const struct timespec* timeoutOpt)
+    {
+        Assert(mhRing != -1);
+
+        for (int i = 0; i < numChanges; i++)
+        {
+            applyChange(changes[i]);
+        }
+
+        if (maxEvents == 0)
+        {
+            return (enterRing(0, NULL) == -1) ? -1 : 0;
+        }
+
+        // Do not block if there is something to observe already.
+        const bool bHasReadyEvents = (mSyntheticEvents.empty() == false) || (*mCqHead != __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE));
+        struct timespec timeoutZero;
+        timeoutZero.tv_sec  = 0;
+        timeoutZero.tv_nsec = 0;
+        const struct timespec* timeout = bHasReadyEvents ? &timeoutZero : timeoutOpt;
+        const bool bWait = (timeout == NULL || timeout->tv_sec != 0 || timeout->tv_nsec != 0);
+
+        if (enterRing(bWait ? 1 : 0, timeout) == -1)
+        {
+            return -1;
+        }
+
+        // Write requests of the previous tick first
+        int numEvents = 0;
+        size_t syntheticIdx = 0;
+        for (; syntheticIdx < mSyntheticEvents.size() && numEvents < maxEvents; syntheticIdx++)
+        {
+            outEvents[numEvents++] = mSyntheticEvents[syntheticIdx];
+        }
+        mSyntheticEvents.erase(mSyntheticEvents.begin(), mSyntheticEvents.begin() + syntheticIdx);
+
+        // Reap the completions
+        unsigned int cqHead = *mCqHead;
+        const unsigned int cqTail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        for (; cqHead != cqTail && numEvents < maxEvents; cqHead++)
+        {
+            const struct io_uring_cqe& cqe = mCqes[cqHead & mCqMask];
+            if (translateCompletion(cqe, outEvents[numEvents]))
+            {
+                numEvents++;
+            }
+        }
+        __atomic_store_n(mCqHead, cqHead, __ATOMIC_RELEASE);
+
+        return numEvents;
+    }
+
+    /** Submit a send request of the buffer. It is submitted at the next Wait().
+     *
+     * @param hSocket   Socket to send.
+     * @param udata     udata of the observed WRITE event of this request.
+     * @param buffer    Buffer to send. Must be kept alive until the request is done.
+     * @param length    Length of the buffer.
+     * @param bLinkNext Link with the next send request of the socket, so that the next one starts after this one.
+     *                  If this one fails or is short, the linked requests are canceled. (0 data, no FLAG_ERROR)
+     */
+    void SubmitSend(const int hSocket, void* udata, const char* buffer, const size_t length, const bool bLinkNext)
+    {
+        IoRequest* request = allocRequest(hSocket, OP_SEND, udata);
+
+        struct io_uring_sqe* sqe = getSqe();
+        sqe->opcode    = IORING_OP_SEND;
+        sqe->fd        = hSocket;
+        sqe->addr      = reinterpret_cast<uintptr_t>(buffer);
+        sqe->len       = static_cast<unsigned int>(length);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = reinterpret_cast<uintptr_t>(request);
+        if (bLinkNext)
+        {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+    }
+
+    /** Get the message block received by the observed READ event. MsgLen is the received bytes.
+     *
+     * @warning Valid until the next Wait(). The block is recycled into the buffer ring unless TakeRecvBuffer() is called.
+     */
+    FORCEINLINE const MsgBlock& GetRecvBuffer(const Event& event) const
+    {
+        Assert(event.fflags < mRecvBuffers.size());
+        Assert(mRecvBuffers[event.fflags] != NULL);
+        return *mRecvBuffers[event.fflags];
+    }
+
+    /** Take the ownership of the message block received by the observed READ event. MsgLen is the received bytes.
+     *
+     *  The buffer ring is refilled with a new block at the next Wait().
+     */
+    FORCEINLINE SharedPtr<MsgBlock> TakeRecvBuffer(const Event& event)
+    {
+        Assert(event.fflags < mRecvBuffers.size());
+        Assert(mRecvBuffers[event.fflags] != NULL);
+
+        SharedPtr<MsgBlock> block;
+        block.Swap(mRecvBuffers[event.fflags]);
+        return block;
+    }
+
+private:
+    /** @warning Copy is not allowed. */
+    IoUringEventQueue(const IoUringEventQueue& rhs);
+    IoUringEventQueue& operator=(const IoUringEventQueue& rhs);
+
+    enum EOperation {
+        OP_ACCEPT,
+        OP_RECV,
+        OP_SEND
+    };
+
+    /** An in-flight request. Its address is the user_data of the submission/completion. */
+    /** Not pooled, because requests are allocated in Wait() which can run concurrently on the reactors. */
+    struct IoRequest
+    {
+        int         hSocket;
+        EOperation  Op;
+        void*       Udata;
+
+        /** Intrusive list of the live requests to release them on Destroy() */
+        IoRequest*  Prev;
+        IoRequest*  Next;
+    };
+
+    IoRequest* allocRequest(const int hSocket, const EOperation op, void* udata)
+    {
+        IoRequest* request = new IoRequest;
+        request->hSocket = hSocket;
+        request->Op      = op;
+        request->Udata   = udata;
+        request->Prev    = NULL;
+        request->Next    = mLiveRequests;
+        if (mLiveRequests != NULL)
+        {
+            mLiveRequests->Prev = request;
+        }
+        mLiveRequests = request;
+        return request;
+    }
+
+    void freeRequest(IoRequest* request)
+    {
+        if (request->Prev != NULL)
+        {
+            request->Prev->Next = request->Next;
+        }
+        else
+        {
+            mLiveRequests = request->Next;
+        }
+        if (request->Next != NULL)
+        {
+            request->Next->Prev = request->Prev;
+        }
+
+        if (request->Op == OP_RECV && static_cast<size_t>(request->hSocket) < mRecvRequestTable.size() && mRecvRequestTable[request->hSocket] == request)
+        {
+            mRecvRequestTable[request->hSocket] = NULL;
+        }
+
+        delete request;
+    }
+
+    /** Get a free submission entry. Submit the pending entries if the ring is full. */
+    struct io_uring_sqe* getSqe()
+    {
+        unsigned int sqTail = *mSqTail;
+        if (sqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mSqEntries)
+        {
+            enterRing(0, NULL);
+            sqTail = *mSqTail;
+        }
+        Assert(sqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) < mSqEntries);
+
+        struct io_uring_sqe* sqe = &mSqes[sqTail & mSqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        __atomic_store_n(mSqTail, sqTail + 1, __ATOMIC_RELEASE);
+        mNumUnsubmittedSqes++;
+        return sqe;
+    }
+
+    /** Submit the pending entries and wait for minComplete completions.
+     *
+     * @return -1 on error. A timeout or a signal is not an error.
+     */
+    int enterRing(const unsigned int minComplete, const struct timespec* timeoutOpt)
+    {
+        struct __kernel_timespec kernelTimeout;
+        struct io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        if (timeoutOpt != NULL)
+        {
+            kernelTimeout.tv_sec  = timeoutOpt->tv_sec;
+            kernelTimeout.tv_nsec = timeoutOpt->tv_nsec;
+            arg.ts = reinterpret_cast<uintptr_t>(&kernelTimeout);
+        }
+
+        const unsigned int enterFlags = IORING_ENTER_EXT_ARG | ((minComplete > 0) ? IORING_ENTER_GETEVENTS : 0);
+        const long result = syscall(__NR_io_uring_enter, mhRing, mNumUnsubmittedSqes, minComplete, enterFlags, &arg, sizeof(arg));
+        if (result == -1)
+        {
+            if (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                return 0;
+            }
+            return -1;
+        }
+
+        Assert(static_cast<unsigned int>(result) <= mNumUnsubmittedSqes);
+        mNumUnsubmittedSqes -= static_cast<unsigned int>(result);
+        return 0;
+    }
+
+    void submitAccept(IoRequest* request)
+    {
+        struct io_uring_sqe* sqe = getSqe();
+        sqe->opcode       = IORING_OP_ACCEPT;
+        sqe->fd           = request->hSocket;
+        sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data    = reinterpret_cast<uintptr_t>(request);
+    }
+
+    void submitRecv(IoRequest* request)
+    {
+        struct io_uring_sqe* sqe = getSqe();
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = request->hSocket;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP_ID;
+        sqe->user_data = reinterpret_cast<uintptr_t>(request);
+    }
+
+    void submitCancel(IoRequest* request)
+    {
+        // The completion of the cancel request itself has no user_data and is ignored.
+        struct io_uring_sqe* sqe = getSqe();
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->fd        = -1;
+        sqe->addr      = reinterpret_cast<uintptr_t>(request);
+        sqe->user_data = 0;
+    }
+
+    void applyChange(const Event& change)
+    {
+        const int hSocket = static_cast<int>(change.ident);
+        Assert(hSocket >= 0);
+
+        if (change.filter == FILTER_WRITE)
+        {
+            // Nothing to register. Let the event loop submit the sending queue.
+            if ((change.flags & (FLAG_ADD | FLAG_ENABLE)) && !(change.flags & FLAG_DISABLE))
+            {
+                Event writable;
+                SetEvent(writable, hSocket, FILTER_WRITE, 0, change.udata);
+                mSyntheticEvents.push_back(writable);
+            }
+            return;
+        }
+
+        if (change.filter == FILTER_ACCEPT)
+        {
+            // A single listen socket per queue. The request is kept while the accept is stopped.
+            if (change.flags & FLAG_ADD)
+            {
+                Assert(mAcceptRequest == NULL);
+                mAcceptRequest = allocRequest(hSocket, OP_ACCEPT, change.udata);
+                mbAcceptEnabled = !(change.flags & FLAG_DISABLE);
+            }
+            else if (change.flags & FLAG_DISABLE)
+            {
+                Assert(mAcceptRequest != NULL && mAcceptRequest->hSocket == hSocket);
+                // The canceled request is not re-armed. (See translateCompletion())
+                if (mbAcceptEnabled && mbAcceptInFlight)
+                {
+                    submitCancel(mAcceptRequest);
+                }
+                mbAcceptEnabled = false;
+                return;
+            }
+            else if (change.flags & FLAG_ENABLE)
+            {
+                Assert(mAcceptRequest != NULL && mAcceptRequest->hSocket == hSocket);
+                mbAcceptEnabled = true;
+            }
+
+            // Re-armed by the completion if the canceled request is still in flight.
+            if (mbAcceptEnabled && !mbAcceptInFlight)
+            {
+                submitAccept(mAcceptRequest);
+                mbAcceptInFlight = true;
+            }
+            return;
+        }
+
+        Assert(change.filter == FILTER_READ);
+        if (static_cast<size_t>(hSocket) >= mRecvRequestTable.size())
+        {
+            mRecvRequestTable.resize(hSocket + 1, NULL);
+        }
+
+        if ((change.flags & (FLAG_ADD | FLAG_ENABLE)) && !(change.flags & FLAG_DISABLE))
+        {
+            Assert(mRecvRequestTable[hSocket] == NULL || (change.flags & FLAG_ADD));
+            IoRequest* request = allocRequest(hSocket, OP_RECV, change.udata);
+            mRecvRequestTable[hSocket] = request;
+            submitRecv(request);
+        }
+        else if ((change.flags & (FLAG_DELETE | FLAG_DISABLE)) && mRecvRequestTable[hSocket] != NULL)
+        {
+            // The canceled request is not re-armed anymore. (See translateCompletion())
+            submitCancel(mRecvRequestTable[hSocket]);
+            mRecvRequestTable[hSocket] = NULL;
+        }
+    }
+
+    /** Translate a completion into an observed event, and re-arm or release the request.
+     *
+     * @return false if there is nothing to observe.
+     */
+    bool translateCompletion(const struct io_uring_cqe& cqe, Event& outEvent)
+    {
+        IoRequest* request = reinterpret_cast<IoRequest*>(cqe.user_data);
+        if (request == NULL)
+        {
+            return false;
+        }
+
+        const int  result = cqe.res;
+        const bool bMore  = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        SetEvent(outEvent, request->hSocket, FILTER_READ, 0, request->Udata);
+
+        switch (request->Op)
+        {
+        case OP_ACCEPT:
+        {
+            Assert(request == mAcceptRequest);
+            bool bObserved = true;
+            if (result >= 0)
+            {
+                outEvent.data = result;
+            }
+            // Out of the file descriptors. Re-arming at once would fail again on every completion.
+            // Stop until the event loop frees a descriptor and enables the accept again.
+            else if (result == -EMFILE || result == -ENFILE)
+            {
+                outEvent.data   = -1;
+                outEvent.fflags = -result;
+                if (bMore)
+                {
+                    submitCancel(request);
+                }
+                mbAcceptEnabled = false;
+            }
+            // Transient failures must not stop accepting.
+            else if (result == -ENOBUFS || result == -ENOMEM || result == -ECONNABORTED || result == -EINTR || result == -EAGAIN || result == -ECANCELED)
+            {
+                bObserved = false;
+            }
+            else
+            {
+                outEvent.flags = FLAG_ERROR | FLAG_REQUEST_DONE;
+                freeRequest(request);
+                mAcceptRequest = NULL;
+                mbAcceptInFlight = false;
+                return true;
+            }
+
+            if (bMore == false)
+            {
+                mbAcceptInFlight = mbAcceptEnabled;
+                if (mbAcceptEnabled)
+                {
+                    submitAccept(request);
+                }
+            }
+            return bObserved;
+        }
+
+        case OP_RECV:
+            if (result > 0)
+            {
+                Assert(cqe.flags & IORING_CQE_F_BUFFER);
+                const unsigned short bufferId = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                Assert(bufferId < mRecvBuffers.size());
+                mRecvBuffers[bufferId]->MsgLen = result;
+                mDeliveredBufferIds.push_back(bufferId);
+
+                outEvent.data   = result;
+                outEvent.fflags = bufferId;
+                if (bMore == false)
+                {
+                    if (isRecvRequestCanceled(request))
+                    {
+                        outEvent.flags = FLAG_REQUEST_DONE;
+                        freeRequest(request);
+                    }
+                    else
+                    {
+                        submitRecv(request);
+                    }
+                }
+                return true;
+            }
+
+            // Out of the provided buffers. The ring is refilled at the next Wait().
+            if (result == -ENOBUFS && !isRecvRequestCanceled(request))
+            {
+                submitRecv(request);
+                return false;
+            }
+
+            if (result == 0)
+            {
+                outEvent.flags = FLAG_EOF | FLAG_REQUEST_DONE;
+            }
+            else if (result == -ECANCELED || result == -ENOBUFS)
+            {
+                outEvent.flags = FLAG_REQUEST_DONE;
+            }
+            else
+            {
+                outEvent.flags = FLAG_ERROR | FLAG_REQUEST_DONE;
+            }
+            freeRequest(request);
+            return true;
+
+        case OP_SEND:
+            outEvent.filter = FILTER_WRITE;
+            outEvent.flags  = FLAG_REQUEST_DONE;
+            if (result > 0)
+            {
+                outEvent.data = result;
+            }
+            else if (result != -ECANCELED)
+            {
+                outEvent.flags |= FLAG_ERROR;
+            }
+            freeRequest(request);
+            return true;
+
+        default:
+            Assume(0);
+        }
+
+        return false;
+    }
+
+    /** The recv request is replaced or removed by FLAG_DISABLE/FLAG_DELETE, and must not be submitted again. */
+    FORCEINLINE bool isRecvRequestCanceled(const IoRequest* request) const
+    {
+        return mRecvRequestTable[request->hSocket] != request;
+    }
+
+    FORCEINLINE void addRecvBufferToRing(const unsigned short bufferId)
+    {
+        struct io_uring_buf& buf = mBufRing[mBufRingTail & (RECV_BUFFER_RING_ENTRIES - 1)];
+        buf.addr = reinterpret_cast<uintptr_t>(mRecvBuffers[bufferId]->Msg);
+        buf.len  = sizeof(mRecvBuffers[bufferId]->Msg);
+        buf.bid  = bufferId;
+        mBufRingTail++;
+    }
+
+    FORCEINLINE void publishRecvBuffers()
+    {
+        // The tail of the ring is overlaid on the resv field of the first entry. (See struct io_uring_buf_ring)
+        __atomic_store_n(&mBufRing[0].resv, mBufRingTail, __ATOMIC_RELEASE);
+    }
+
+private:
+    enum {
+        SQ_ENTRIES               = 4096,
+        CQ_ENTRIES               = SQ_ENTRIES * 4,
+        RECV_BUFFER_RING_ENTRIES = 4096,
+        RECV_BUFFER_GROUP_ID     = 0,
+        DESCRIPTOR_TABLE_RESERVE = 1024
+    };
+    STATIC_ASSERT((RECV_BUFFER_RING_ENTRIES & (RECV_BUFFER_RING_ENTRIES - 1)) == 0);
+
+    int mhRing;
+    unsigned int mRingFeatures;
+
+    /** @name Mapped rings */
+    ///@{
+    void*   mSqRingPtr;
+    size_t  mSqRingSize;
+    void*   mCqRingPtr;
+    size_t  mCqRingSize;
+    struct io_uring_sqe* mSqes;
+    size_t  mSqesSize;
+
+    unsigned int* mSqHead;
+    unsigned int* mSqTail;
+    unsigned int  mSqMask;
+    unsigned int  mSqEntries;
+
+    unsigned int* mCqHead;
+    unsigned int* mCqTail;
+    unsigned int  mCqMask;
+    struct io_uring_cqe* mCqes;
+
+    /** Number of the submission entries to pass to the next io_uring_enter() */
+    unsigned int mNumUnsubmittedSqes;
+    ///@}
+
+    /** @name Provided buffer ring of the multishot recv requests */
+    ///@{
+    /** Entries of the ring.
+     *  Not accessed through struct io_uring_buf_ring, because its flexible array member is misplaced in C++. (Empty struct has size 1)
+     */
+    struct io_uring_buf* mBufRing;
+    size_t mBufRingSize;
+    unsigned short mBufRingTail;
+
+    /** Message block of each buffer id. NULL if it is taken by TakeRecvBuffer() */
+    std::vector< SharedPtr< MsgBlock > > mRecvBuffers;
+
+    /** Buffer ids delivered by the last Wait(). Given back to the ring at the next Wait(). */
+    std::vector<unsigned short> mDeliveredBufferIds;
+    ///@}
+
+    /** Multishot recv request of each socket. Indexed by the socket descriptor. */
+    std::vector<IoRequest*> mRecvRequestTable;
+
+    /** WRITE events to observe at the next Wait(). */
+    std::vector<Event> mSyntheticEvents;
+
+    /** Multishot accept request of the listen socket. Kept while the accept is disabled. */
+    IoRequest* mAcceptRequest;
+    bool mbAcceptInFlight;
+    bool mbAcceptEnabled;
+
+    IoRequest* mLiveRequests;
+};
+
+} // namespace IRC
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+namespace IRC
+{
+
+/** Event queue backend using kqueue.
+ *
+ * @details The kevent structure is used as it is for both the change list and the observed event list.
+ *          On Linux, it works through the libkqueue emulation layer.
+ *
+ * @see     EventQueue, EpollEventQueue
+ */
+class KqueueEventQueue
+{
+public:
+    typedef struct kevent Event;
+
+    enum EFilter {
+        FILTER_READ   = EVFILT_READ,
+        FILTER_WRITE  = EVFILT_WRITE,
+        FILTER_ACCEPT = EVFILT_READ
+    };
+
+    /** @note FLAG_ENABLE has EV_ADD too, so that the filter is evaluated again even if it is enabled already. */
+    enum EFlag {
+        FLAG_ADD     = EV_ADD,
+        FLAG_DELETE  = EV_DELETE,
+        FLAG_ENABLE  = EV_ADD | EV_ENABLE,
+        FLAG_DISABLE = EV_DISABLE,
+        FLAG_CLEAR   = EV_CLEAR,
+        FLAG_EOF     = EV_EOF,
+        FLAG_ERROR   = EV_ERROR
+    };
+
+    FORCEINLINE KqueueEventQueue()
+        : mhKqueue(-1)
+    {
+    }
+
+    FORCEINLINE ~KqueueEventQueue()
+    {
+        Destroy();
+    }
+
+    /** Name of the backend for logging. */
+    static FORCEINLINE const char* GetBackendName()
+    {
+        return "kqueue";
+    }
+
+    /** Fill the event to register or observe. (Same as EV_SET) */
+    static FORCEINLINE void SetEvent(Event& outEvent, const int hSocket, const short filter, const unsigned short flags, void* udataOpt)
+    {
+        std::memset(&outEvent, 0, sizeof(outEvent));
+        outEvent.ident  = hSocket;
+        outEvent.filter = filter;
+        outEvent.flags  = flags;
+        outEvent.udata  = udataOpt;
+    }
+
+    /** @return false if failed to create kqueue. */
+    FORCEINLINE bool Create()
+    {
+        Assert(mhKqueue == -1);
+
+        mhKqueue = kqueue();
+        return mhKqueue != -1;
+    }
+
+    FORCEINLINE void Destroy()
+    {
+        if (mhKqueue != -1)
+        {
+            close(mhKqueue);
+            mhKqueue = -1;
+        }
+    }
+
+    /** Apply the change list and wait for the observed events. (Same as kevent())
+     *
+     * @param changes       Events to register/modify/delete. Can be NULL if numChanges is 0.
+     * @param numChanges    Number of the changes.
+     * @param outEvents     [out] Array to receive the observed events.
+     * @param maxEvents     Capacity of the outEvents. If 0, only the changes are applied.
+     * @param timeoutOpt    NULL to wait indefinitely.
+     * @return              Number of the observed events, or -1 on error. A signal is not an error. (ex. SIGUSR2 of the hot upgrade)
+     */
+    FORCEINLINE int Wait(const Event* changes, const int numChanges, Event* outEvents, const int maxEvents, const struct timespec* timeoutOpt)
+    {
+        const int numEvents = kevent(mhKqueue, changes, numChanges, outEvents, maxEvents, timeoutOpt);
+        return (numEvents == -1 && errno == EINTR) ? 0 : numEvents;
+    }
+
+private:
+    /** @warning Copy is not allowed. */
+    KqueueEventQueue(const KqueueEventQueue& rhs);
+    KqueueEventQueue& operator=(const KqueueEventQueue& rhs);
+
+private:
+    int mhKqueue;
+};
+
+} // namespace IRC
@@ -1,11 +1,9 @@
 #pragma once
 
 #include <sys/socket.h>
-#include <sys/event.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-typedef struct kevent kevent_t;
 typedef struct sockaddr sockaddr_t;
 typedef struct sockaddr_in sockaddr_in_t;
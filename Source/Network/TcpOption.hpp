@@ -0,0 +1,109 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <cstring>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+// Hold the partial segments until uncorked. (TCP_NOPUSH of BSD is the same)
+#if defined(TCP_CORK)
+#define IRC_TCP_CORK_OPTION TCP_CORK
+#elif defined(TCP_NOPUSH)
+#define IRC_TCP_CORK_OPTION TCP_NOPUSH
+#endif
+
+// Kernel time of the received packets, to measure the latency to the dispatch. (See [ \ref irc_server_dispatch_latency ])
+// The io_uring backend receives with its own requests, so it is not used there.
+#if defined(SO_TIMESTAMPNS) && defined(SCM_TIMESTAMPNS) && !defined(IRC_EVENT_BACKEND_IO_URING)
+#define IRC_RECV_TIMESTAMP_SUPPORTED
+#endif
+
+namespace IRC
+{
+
+/** Send the small segments without waiting for the ACK of the previous one. (Disable Nagle's algorithm)
+ *
+ * @return false if setsockopt() failed.
+ */
+inline bool SetTcpNoDelay(const int hSocket, const bool bNoDelay)
+{
+    const int value = bNoDelay ? 1 : 0;
+    return setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) == 0;
+}
+
+/** Cork the socket to send only the full segments, or uncork to send the rest at once.
+ *
+ * @return false if setsockopt() failed, or the platform does not support it.
+ */
+inline bool SetTcpCork(const int hSocket, const bool bCork)
+{
+#if defined(IRC_TCP_CORK_OPTION)
+    const int value = bCork ? 1 : 0;
+    return setsockopt(hSocket, IPPROTO_TCP, IRC_TCP_CORK_OPTION, &value, sizeof(value)) == 0;
+#else
+    (void)hSocket;
+    (void)bCork;
+    return false;
+#endif
+}
+
+/** Let a blocking receive of the socket poll the device queue for the microseconds instead of sleeping. (SO_BUSY_POLL of Linux)
+ *
+ * @details A value over the net.core.busy_read sysctl needs CAP_NET_ADMIN.
+ * @return false if setsockopt() failed, or the platform does not support it.
+ */
+inline bool SetBusyPoll(const int hSocket, const unsigned int microsec)
+{
+#if defined(SO_BUSY_POLL)
+    const int value = static_cast<int>(microsec);
+    return setsockopt(hSocket, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) == 0;
+#else
+    (void)hSocket;
+    (void)microsec;
+    return false;
+#endif
+}
+
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+/** Timestamp the received packets of the socket with the system time. */
+inline bool EnableRecvTimestamp(const int hSocket)
+{
+    const int bEnable = 1;
+    return setsockopt(hSocket, SOL_SOCKET, SO_TIMESTAMPNS, &bEnable, sizeof(bEnable)) == 0;
+}
+
+/** readv() with the kernel time of the first received byte.
+ *
+ * @param outTimestampNanosec   Nanoseconds of the system time, or 0 if there is no timestamp.
+ */
+inline ssize_t ReadvWithTimestamp(const int hSocket, struct iovec* iov, const int iovCount, uint64_t& outTimestampNanosec)
+{
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = iov;
+    msg.msg_iovlen     = iovCount;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+
+    outTimestampNanosec = 0;
+    const ssize_t nRecvBytes = recvmsg(hSocket, &msg, 0);
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); nRecvBytes > 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            outTimestampNanosec = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+        }
+    }
+    return nRecvBytes;
+}
+#endif
+
+} // namespace IRC
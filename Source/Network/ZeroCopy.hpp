@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+// MSG_ZEROCOPY transmit of Linux 4.14 or later.
+// The io_uring backend sends with its own requests, so it is not used there.
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY) && !defined(IRC_EVENT_BACKEND_IO_URING)
+#define IRC_ZEROCOPY_SUPPORTED
+#endif
+
+namespace IRC
+{
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+
+/** Allow the sends with MSG_ZEROCOPY on the socket.
+ *
+ * @return false if the kernel does not support it.
+ */
+inline bool EnableZeroCopy(const int hSocket)
+{
+    const int bEnable = 1;
+    return setsockopt(hSocket, SOL_SOCKET, SO_ZEROCOPY, &bEnable, sizeof(bEnable)) == 0;
+}
+
+/** Read the completion notifications of the MSG_ZEROCOPY sends from the error queue of the socket.
+ *
+ * @details The kernel numbers the successful MSG_ZEROCOPY sends of a socket from 0, and notifies a done range of them.
+ *          The ranges of a TCP socket are done in order, so only the last one is returned.
+ *
+ * @param outLastDoneSeq    Last sequence number of the done sends. Not modified if there is no notification.
+ * @param outNumCopied      Number of the sends that the kernel copied anyway. (ex. loopback)
+ * @return Number of the done sends, or -1 if recvmsg() failed.
+ */
+inline int ReapZeroCopyCompletions(const int hSocket, uint32_t& outLastDoneSeq, size_t& outNumCopied)
+{
+    int numDone = 0;
+    while (true)
+    {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(hSocket, &msg, MSG_ERRQUEUE) == -1)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? numDone : -1;
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+
+            struct sock_extended_err extErr;
+            std::memcpy(&extErr, CMSG_DATA(cmsg), sizeof(extErr));
+            if (extErr.ee_origin != SO_EE_ORIGIN_ZEROCOPY || extErr.ee_errno != 0)
+            {
+                continue;
+            }
+
+            // [ee_info, ee_data] are done.
+            const uint32_t numRangeDone = extErr.ee_data - extErr.ee_info + 1;
+            numDone += static_cast<int>(numRangeDone);
+            if (extErr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                outNumCopied += numRangeDone;
+            }
+            outLastDoneSeq = extErr.ee_data;
+        }
+    }
+}
+
+#endif // IRC_ZEROCOPY_SUPPORTED
+
+} // namespace IRC
@@ -0,0 +1,128 @@
+#include <cctype>
+#include "Server/Server.hpp"
+
+namespace IRC
+{
+
+// Syntax: CAP <subcommand> [:<capabilities>]
+// IRCv3 capability negotiation with the LS, LIST, REQ and END subcommands. (See [ \ref irc_server_message_tags ])
+EIrcErrorCode Server::executeClientCommand_CAP(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
+{
+    const std::string   commandName("CAP");
+
+    if (client->bExpired)
+    {
+        return IRC_SUCCESS;
+    }
+
+    // Need more parameters
+    if (msg.NumParams == 0)
+    {
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
+        return IRC_SUCCESS;
+    }
+
+    std::string subcommand = msg.Params[0];
+    for (size_t i = 0; i < subcommand.size(); i++)
+    {
+        subcommand[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(subcommand[i])));
+    }
+    const std::string replyPrefix = ":" + mServerName + " CAP " + (client->bRegistered ? client->Nickname : "*") + " ";
+
+    // List the capabilities of the server
+    if (subcommand == "LS")
+    {
+        // The registration waits for the CAP END.
+        if (!client->bRegistered)
+        {
+            client->bCapNegotiating = true;
+        }
+
+        std::string capabilities;
+        for (int capability = 0; capability < NUM_CAPABILITIES; capability++)
+        {
+            capabilities += (capability > 0) ? " " : "";
+            capabilities += GetCapabilityName(static_cast<ECapability>(capability));
+        }
+        sendMsgToClient(client, MakeShared<MsgBlock>(replyPrefix + "LS :" + capabilities));
+    }
+    // List the enabled capabilities
+    else if (subcommand == "LIST")
+    {
+        std::string capabilities;
+        for (int capability = 0; capability < NUM_CAPABILITIES; capability++)
+        {
+            if (client->IsCapEnabled(static_cast<ECapability>(capability)))
+            {
+                capabilities += capabilities.empty() ? "" : " ";
+                capabilities += GetCapabilityName(static_cast<ECapability>(capability));
+            }
+        }
+        sendMsgToClient(client, MakeShared<MsgBlock>(replyPrefix + "LIST :" + capabilities));
+    }
+    // Enable or disable('-' prefixed) the capabilities. All or none of them are changed.
+    else if (subcommand == "REQ")
+    {
+        if (!client->bRegistered)
+        {
+            client->bCapNegotiating = true;
+        }
+
+        const char* requested = (msg.NumParams > 1) ? msg.Params[1] : "";
+        unsigned int enabledCaps = client->EnabledCaps;
+        bool bAccepted = (requested[0] != '\0');
+        for (const char* p = requested; *p != '\0' && bAccepted; )
+        {
+            for (; *p == ' '; p++)
+            {
+            }
+            if (*p == '\0')
+            {
+                break;
+            }
+
+            const bool bDisable = (*p == '-');
+            const char* name = bDisable ? p + 1 : p;
+            size_t nameLen = 0;
+            for (; name[nameLen] != '\0' && name[nameLen] != ' '; nameLen++)
+            {
+            }
+            p = name + nameLen;
+
+            bAccepted = false;
+            for (int capability = 0; capability < NUM_CAPABILITIES; capability++)
+            {
+                const char* capabilityName = GetCapabilityName(static_cast<ECapability>(capability));
+                if (std::strlen(capabilityName) == nameLen && std::strncmp(capabilityName, name, nameLen) == 0)
+                {
+                    enabledCaps = bDisable ? (enabledCaps & ~(1u << capability)) : (enabledCaps | (1u << capability));
+                    bAccepted = true;
+                    break;
+                }
+            }
+        }
+
+        if (bAccepted)
+        {
+            client->EnabledCaps = enabledCaps;
+        }
+        sendMsgToClient(client, MakeShared<MsgBlock>(replyPrefix + (bAccepted ? "ACK :" : "NAK :") + requested));
+    }
+    // End of the negotiation, and try to register the client
+    else if (subcommand == "END")
+    {
+        if (client->bCapNegotiating)
+        {
+            client->bCapNegotiating = false;
+            registerClient(client);
+        }
+    }
+    else
+    {
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_INVALIDCAPCMD(mServerName, subcommand)));
+    }
+
+    return IRC_SUCCESS;
+}
+
+}
@@ -1,11 +1,127 @@
 #pragma once
 
+#include <cstring>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
 namespace IRC
 {
 
-} // namespace irc
+/** Dispatch table of the client commands. (See [ \ref irc_server_command_dispatch ])
+ *
+ * @details Built once from the IRC_CLIENT_COMMAND_LIST with the upper case names.
+ *          Find() folds the token to upper case while hashing it, so the commands match case-insensitively as RFC 1459 requires,
+ *          and compares the name of the slot only. The slots are probed linearly on a collision,
+ *          but the hash is chosen so that the commands of the list do not collide in NUM_SLOTS.
+ *
+ * @tparam FuncType     Type of the command function. Find() returns FuncType() for an unknown command.
+ */
+template <typename FuncType>
+class ClientCommandTable
+{
+public:
+    enum
+    {
+        NUM_SLOTS = 32,
+        COMMAND_LEN_MAX = 15
+    };
+
+    FORCEINLINE ClientCommandTable()
+        : mNumCommands(0)
+        , mNumCollisions(0)
+    {
+        for (size_t slot = 0; slot < NUM_SLOTS; slot++)
+        {
+            mSlots[slot].Name = NULL;
+            mSlots[slot].NameLen = 0;
+            mSlots[slot].Func = FuncType();
+        }
+    }
+
+    /** Add a command of the upper case name. */
+    void Add(const char* name, FuncType func)
+    {
+        const size_t nameLen = std::strlen(name);
+        Assert(nameLen > 0 && nameLen <= COMMAND_LEN_MAX);
+        Assert(mNumCommands < NUM_SLOTS / 2);
+
+        size_t slot = getSlotIdx(hashName(name, nameLen));
+        for (; mSlots[slot].Name != NULL; slot = (slot + 1) % NUM_SLOTS)
+        {
+            Assert(std::strcmp(mSlots[slot].Name, name) != 0);
+            mNumCollisions++;
+        }
+        mSlots[slot].Name = name;
+        mSlots[slot].NameLen = nameLen;
+        mSlots[slot].Func = func;
+        mNumCommands++;
+    }
+
+    /** Find the function of the command case-insensitively, or FuncType() if it is unknown. */
+    FORCEINLINE FuncType Find(const char* command) const
+    {
+        char upperCommand[COMMAND_LEN_MAX];
+        uint32_t hash = 0;
+        size_t commandLen = 0;
+        for (; command[commandLen] != '\0'; commandLen++)
+        {
+            if (UNLIKELY(commandLen == COMMAND_LEN_MAX))
+            {
+                return FuncType();
+            }
+            const char c = command[commandLen];
+            upperCommand[commandLen] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : c;
+            hash = hash * HASH_MULTIPLIER + static_cast<unsigned char>(upperCommand[commandLen]);
+        }
+
+        for (size_t slot = getSlotIdx(hash); mSlots[slot].Name != NULL; slot = (slot + 1) % NUM_SLOTS)
+        {
+            if (mSlots[slot].NameLen == commandLen && std::memcmp(mSlots[slot].Name, upperCommand, commandLen) == 0)
+            {
+                return mSlots[slot].Func;
+            }
+        }
+        return FuncType();
+    }
 
-/** 
+    /** Commands placed after a probe. 0 with the IRC_CLIENT_COMMAND_LIST. */
+    FORCEINLINE size_t GetNumCollisions() const { return mNumCollisions; }
+
+private:
+    enum { HASH_MULTIPLIER = 11 };
+
+    struct Slot
+    {
+        const char* Name;
+        size_t NameLen;
+        FuncType Func;
+    };
+
+    static FORCEINLINE uint32_t hashName(const char* name, const size_t nameLen)
+    {
+        uint32_t hash = 0;
+        for (size_t i = 0; i < nameLen; i++)
+        {
+            hash = hash * HASH_MULTIPLIER + static_cast<unsigned char>(name[i]);
+        }
+        return hash;
+    }
+
+    static FORCEINLINE size_t getSlotIdx(const uint32_t hash)
+    {
+        return (hash ^ (hash >> 3)) % NUM_SLOTS;
+    }
+
+private:
+    Slot mSlots[NUM_SLOTS];
+    size_t mNumCommands;
+    size_t mNumCollisions;
+};
+
+} // namespace IRC
+
+/**
  * @def IRC_CLIENT_COMMAND_X
  * @brief Macro for defining a client command.
  */
@@ -20,9 +136,11 @@ namespace IRC
     IRC_CLIENT_COMMAND_X(KICK)      \
     IRC_CLIENT_COMMAND_X(INVITE)    \
     IRC_CLIENT_COMMAND_X(QUIT)      \
-    IRC_CLIENT_COMMAND_X(PART)
+    IRC_CLIENT_COMMAND_X(PART)      \
+    IRC_CLIENT_COMMAND_X(PING)      \
+    IRC_CLIENT_COMMAND_X(PONG)      \
+    IRC_CLIENT_COMMAND_X(CAP)
 
     // IRC_CLIENT_COMMAND_X(QUIT)
     // IRC_CLIENT_COMMAND_X(TOPIC)
 
-
@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: INVITE <nickname> <channel>
-EIrcErrorCode Server::executeClientCommand_INVITE(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_INVITE(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("INVITE");
 
@@ -20,14 +20,14 @@ EIrcErrorCode Server::executeClientCommand_INVITE(SharedPtr<ClientControlBlock>
     }
 
     // Need more arguments
-    if (arguments.size() < 2)
+    if (msg.NumParams < 2)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
     // Find the channel
-    const std::string channelName = arguments[1];
+    const std::string channelName = msg.Params[1];
     SharedPtr< ChannelControlBlock > channel = findChannelGlobal(channelName);
     if (channel == NULL)
     {
@@ -50,7 +50,7 @@ EIrcErrorCode Server::executeClientCommand_INVITE(SharedPtr<ClientControlBlock>
     }
 
     // Find the target user
-    const std::string nickname = arguments[0];
+    const std::string nickname = msg.Params[0];
     SharedPtr< ClientControlBlock > target = findClientGlobal(nickname);
     if (target == NULL)
     {
@@ -1,11 +1,10 @@
-#include <cctype>
 #include "Server/Server.hpp"
 
 namespace IRC
 {
 
 // Syntax: JOIN <channel>{,<channel>} [<key>{,<key>}]
-EIrcErrorCode Server::executeClientCommand_JOIN(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_JOIN(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("JOIN");
 
@@ -21,59 +20,27 @@ EIrcErrorCode Server::executeClientCommand_JOIN(SharedPtr<ClientControlBlock> cl
     }
 
     // No channel given
-    if (arguments.size() == 0)
+    if (msg.NumParams == 0)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
-    // Split channels
-    std::vector<const char*> channels;
-    for (char* p = arguments[0]; *p != '\0'; p++)
-    {
-        if (*p != ',')
-        {
-            channels.push_back(p);
-        }
-        for (; *p != '\0' && *p != ','; p++)
-        {
-        }
-        if (*p == '\0')
-        {
-            break;
-        }
-        *p = '\0';
-    }
+    // Split channels and keys (See SplitCommaList())
+    StrView channels[NUM_LIST_ITEMS_MAX];
+    const size_t numChannels = SplitCommaList(msg.Params[0], std::strlen(msg.Params[0]), channels, NUM_LIST_ITEMS_MAX);
 
-    // Split keys
-    std::vector<const char*> keys;
-    if (arguments.size() > 1)
-    {
-        for (char* p = arguments[1]; *p != '\0'; p++)
-        {
-            if (*p != ',')
-            {
-                keys.push_back(p);
-            }
-            for (; *p != '\0' && *p != ','; p++)
-            {
-            }
-            if (*p == '\0')
-            {
-                break;
-            }
-            *p = '\0';            
-        }
-    }
+    StrView keys[NUM_LIST_ITEMS_MAX];
+    const size_t numKeys = (msg.NumParams > 1) ? SplitCommaList(msg.Params[1], std::strlen(msg.Params[1]), keys, NUM_LIST_ITEMS_MAX) : 0;
 
     // Try to join the channels
-    for (size_t i = 0; i < channels.size(); i++)
+    for (size_t i = 0; i < numChannels; i++)
     {
-        const std::string channelName(channels[i]);
-        const std::string channelKey = (i < keys.size()) ? keys[i] : "";
+        const std::string channelName(channels[i].Str, channels[i].Len);
+        const std::string channelKey = (i < numKeys) ? std::string(keys[i].Str, keys[i].Len) : "";
 
-        // Invalid channel name
-        if (channelName[0] != '#' || channelName[0] == '&')
+        // Invalid channel name (See GetChannelCharClass())
+        if (channelName[0] != '#' || !GetChannelCharClass().IsValid(channels[i].Str, channels[i].Len))
         {
             sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NOSUCHCHANNEL(mServerName, channelName)));
             continue;
@@ -181,7 +148,7 @@ EIrcErrorCode Server::executeClientCommand_JOIN(SharedPtr<ClientControlBlock> cl
         // Reply NAMESEND message to the client
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_RPL_ENDOFNAMES(mServerName, channelName)));
 
-    } // for (size_t i = 0; i < channels.size(); i++)
+    } // for (size_t i = 0; i < numChannels; i++)
         
     return IRC_SUCCESS;
 }
@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: KICK <channel> <user> [<comment>]
-EIrcErrorCode Server::executeClientCommand_KICK(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_KICK(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("KICK");
 
@@ -20,14 +20,14 @@ EIrcErrorCode Server::executeClientCommand_KICK(SharedPtr<ClientControlBlock> cl
     }
 
     // Need more arguments
-    if (arguments.size() < 2)
+    if (msg.NumParams < 2)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
     // Find the channel
-    const std::string channelName = arguments[0];
+    const std::string channelName = msg.Params[0];
     SharedPtr< ChannelControlBlock > channel = findChannelGlobal(channelName);
     if (channel == NULL)
     {
@@ -50,7 +50,7 @@ EIrcErrorCode Server::executeClientCommand_KICK(SharedPtr<ClientControlBlock> cl
     }
 
     // Find the target user
-    const std::string nickname = arguments[1];
+    const std::string nickname = msg.Params[1];
     SharedPtr< ClientControlBlock > target = findClientGlobal(nickname);
     if (target == NULL)
     {
@@ -71,9 +71,9 @@ EIrcErrorCode Server::executeClientCommand_KICK(SharedPtr<ClientControlBlock> cl
     // Send KICK message to the target user and the channel
     // Additioanlly, append the comment if it exists
     std::string kickMsg = ":" + client->Nickname + " " + "KICK" + " " + channelName + " " + target->Nickname;
-    if (arguments.size() > 2)
+    if (msg.NumParams > 2)
     {
-        kickMsg += " :" + std::string(arguments[2]);
+        kickMsg += " :" + std::string(msg.Params[2]);
     }
     sendMsgToClient(target, MakeShared<MsgBlock>(kickMsg));
     sendMsgToChannel(channel, MakeShared<MsgBlock>(kickMsg));
@@ -8,7 +8,7 @@ namespace IRC
 // Syntax: MODE
 // 1. <channel> {[+|-]|o|p|s|i|t|n|b|v} [<limit>] [<user>] [<ban mask>]
 // 2. <nickname> {[+|-]|i|w|s|o}
-EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("MODE");
 
@@ -24,17 +24,17 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
     }
 
     // Need more arguments
-    if (arguments.size() < 2)
+    if (msg.NumParams < 2)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
     // Channel mode
-    if (arguments[0][0] == '#')
+    if (msg.Params[0][0] == '#')
     {
         // Find the channel
-        const std::string channelName = arguments[0];
+        const std::string channelName = msg.Params[0];
         SharedPtr<ChannelControlBlock> channel = findChannelGlobal(channelName);
         if (channel == NULL)
         {
@@ -43,7 +43,7 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
         }
 
         // <Mode>
-        const std::string modeStr = arguments[1];
+        const std::string modeStr = msg.Params[1];
         if (modeStr.size() == 0 || (modeStr[0] != '+' && modeStr[0] != '-'))
         {
             sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
@@ -64,7 +64,7 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
             // Give/take channel operator privileges
             case 'o':
                 {
-                    if (arguments.size() < 3)
+                    if (msg.NumParams < 3)
                     {
                         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
                         continue;
@@ -78,7 +78,7 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
                     }
 
                     // Find the target client
-                    const std::string nickname = arguments[modeIndex++];
+                    const std::string nickname = msg.Params[modeIndex++];
                     SharedPtr< ClientControlBlock > targetClient = findClientGlobal(nickname);
                     if (targetClient == NULL)
                     {
@@ -142,12 +142,20 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
                     // Enable password
                     if (bAddMode)
                     {
-                        if (arguments.size() - modeIndex < 1)
+                        if (msg.NumParams - modeIndex < 1)
                         {
                             sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
                             continue;
                         }
-                        channel->Password = arguments[modeIndex++];
+                        // A key that can not be given to the JOIN (See GetKeyCharClass())
+                        const char* key = msg.Params[modeIndex++];
+                        const size_t keyLen = std::strlen(key);
+                        if (keyLen == 0 || !GetKeyCharClass().IsValid(key, keyLen))
+                        {
+                            sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_INVALIDKEY(mServerName, channelName)));
+                            continue;
+                        }
+                        channel->Password = key;
                         channel->bPrivate = true;
                     }
                     // Disable password
@@ -174,14 +182,14 @@ EIrcErrorCode Server::executeClientCommand_MODE(SharedPtr<ClientControlBlock> cl
                     // Enable limit
                     if (bAddMode)
                     {
-                        if (arguments.size() - modeIndex < 1)
+                        if (msg.NumParams - modeIndex < 1)
                         {
                             sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
                             continue;
                         }
 
                         // Invalid limit value
-                        const int limit = std::atoi(arguments[modeIndex++]);
+                        const int limit = std::atoi(msg.Params[modeIndex++]);
                         if (limit <= 0)
                         {
                             sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
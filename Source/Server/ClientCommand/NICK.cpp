@@ -1,11 +1,10 @@
-#include <cctype>
 #include "Server/Server.hpp"
 
 namespace IRC
 {
 
 // Syntax: NICK <nickname>
-EIrcErrorCode Server::executeClientCommand_NICK(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_NICK(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("NICK");
 
@@ -14,44 +13,35 @@ EIrcErrorCode Server::executeClientCommand_NICK(SharedPtr<ClientControlBlock> cl
         return IRC_SUCCESS;
     }
 
-    // No nickname given
-    if (arguments.size() == 0)
+    // No nickname given (An empty trailing parameter too)
+    if (msg.NumParams == 0 || msg.Params[0][0] == '\0')
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NONICKNAMEGIVEN(mServerName)));
         return IRC_SUCCESS;
     }
 
-    // Validate nickname
-    for (const char* p = arguments[0]; *p != '\0'; p++)
+    // Too long nickname, or invalid characters (See GetNicknameCharClass())
+    const size_t nicknameLen = std::strlen(msg.Params[0]);
+    if (nicknameLen > MAX_NICKNAME_LENGTH || !GetNicknameCharClass().IsValid(msg.Params[0], nicknameLen))
     {
-        if (isalnum(*p) == 0 && *p != '_')
-        {
-            sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_ERRONEUSNICKNAME(mServerName, arguments[0])));
-            return IRC_SUCCESS;
-        }
-    }
-
-    // Too long nickname
-    if (strlen(arguments[0]) > MAX_NICKNAME_LENGTH)
-    {
-        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_ERRONEUSNICKNAME(mServerName, arguments[0])));
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_ERRONEUSNICKNAME(mServerName, msg.Params[0])));
         return IRC_SUCCESS;
     }
     
     // Empty nickname
-    Assert(arguments[0][0] != '\0');
+    Assert(msg.Params[0][0] != '\0');
 
     // Nickname is already in use
-    if (findClientGlobal(arguments[0]) != NULL)
+    if (findClientGlobal(msg.Params[0]) != NULL)
     {
-        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NICKNAMEINUSE(mServerName, arguments[0])));
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NICKNAMEINUSE(mServerName, msg.Params[0])));
         return IRC_SUCCESS;
     }
 
     // Try to register the client
     if (!client->bRegistered)
     {
-        client->Nickname = arguments[0];
+        client->Nickname = msg.Params[0];
         registerClient(client);
 
         return IRC_SUCCESS;
@@ -60,7 +50,7 @@ EIrcErrorCode Server::executeClientCommand_NICK(SharedPtr<ClientControlBlock> cl
     else
     {
         const std::string oldNickname = client->Nickname;
-        const std::string newNickname = arguments[0];
+        const std::string newNickname = msg.Params[0];
         client->Nickname = newNickname;
         mClients.erase(oldNickname);
         mClients[newNickname] = client;
@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: PART <channel>{,<channel>}
-EIrcErrorCode Server::executeClientCommand_PART(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_PART(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("PART");
 
@@ -20,35 +20,21 @@ EIrcErrorCode Server::executeClientCommand_PART(SharedPtr<ClientControlBlock> cl
     }
 
     // Need more arguments
-    if (arguments.size() == 0)
+    if (msg.NumParams == 0)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
-    // Split channels
-    std::vector<const char*> channels;
-    for (char* p = arguments[0]; *p != '\0'; p++)
-    {
-        if (*p != ',')
-        {
-            channels.push_back(p);
-        }
-        for (; *p != '\0' && *p != ','; p++)
-        {
-        }
-        if (*p == '\0')
-        {
-            break;
-        }
-        *p = '\0';
-    }
+    // Split channels (See SplitCommaList())
+    StrView channels[NUM_LIST_ITEMS_MAX];
+    const size_t numChannels = SplitCommaList(msg.Params[0], std::strlen(msg.Params[0]), channels, NUM_LIST_ITEMS_MAX);
 
     // Part from the channels
-    for (size_t i = 0; i < channels.size(); i++)
+    for (size_t i = 0; i < numChannels; i++)
     {
         // Find the channel
-        const std::string channelName = channels[i];
+        const std::string channelName(channels[i].Str, channels[i].Len);
         SharedPtr< ChannelControlBlock > channel = findChannelGlobal(channelName);
         if (channel == NULL)
         {
@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: PASS <password>
-EIrcErrorCode Server::executeClientCommand_PASS(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_PASS(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("PASS");
 
@@ -19,13 +19,13 @@ EIrcErrorCode Server::executeClientCommand_PASS(SharedPtr<ClientControlBlock> cl
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_ALREADYREGISTRED(mServerName)));
     }
     // Need more parameters
-    else if (arguments.size() == 0)
+    else if (msg.NumParams == 0)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
     }
     else
     {
-        client->ServerPass = arguments[0];
+        client->ServerPass = msg.Params[0];
 
         // Try to register the client
         registerClient(client);
@@ -0,0 +1,30 @@
+#include "Server/Server.hpp"
+
+namespace IRC
+{
+
+// Syntax: PING <server1> [<server2>]
+// Usually answered by the fast path of processClientMsg(). This is for the messages with a prefix or without a parameter.
+EIrcErrorCode Server::executeClientCommand_PING(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
+{
+    const std::string   commandName("PING");
+
+    if (client->bExpired)
+    {
+        return IRC_SUCCESS;
+    }
+
+    // No origin
+    if (msg.NumParams == 0 || msg.Params[0][0] == '\0')
+    {
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NOORIGIN(mServerName)));
+    }
+    else
+    {
+        replyPing(client, msg.Params[0]);
+    }
+
+    return IRC_SUCCESS;
+}
+
+}
@@ -0,0 +1,30 @@
+#include "Server/Server.hpp"
+
+namespace IRC
+{
+
+// Syntax: PONG <daemon> [<daemon2>]
+// Usually handled by the fast path of processClientMsg(). This is for the messages with a prefix or without a parameter.
+EIrcErrorCode Server::executeClientCommand_PONG(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
+{
+    const std::string   commandName("PONG");
+
+    if (client->bExpired)
+    {
+        return IRC_SUCCESS;
+    }
+
+    // No origin
+    if (msg.NumParams == 0 || msg.Params[0][0] == '\0')
+    {
+        sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NOORIGIN(mServerName)));
+    }
+    else
+    {
+        receivePong(client);
+    }
+
+    return IRC_SUCCESS;
+}
+
+}
@@ -3,8 +3,21 @@
 namespace IRC
 {
 
+namespace
+{
+
+// Append the string to the relayed line, truncated to the max length of a message without the CR-LF.
+FORCEINLINE size_t appendToLine(char* line, const size_t lineLen, const char* str, const size_t strLen)
+{
+    const size_t copyLen = std::min(strLen, (MESSAGE_LEN_MAX - CRLF_LEN_2) - lineLen);
+    std::memcpy(line + lineLen, str, copyLen);
+    return lineLen + copyLen;
+}
+
+} // namespace
+
 // Syntax: PRIVMSG <receiver>{,<receiver>} <text to be sent>
-EIrcErrorCode Server::executeClientCommand_PRIVMSG(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_PRIVMSG(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("PRIVMSG");
 
@@ -20,40 +33,45 @@ EIrcErrorCode Server::executeClientCommand_PRIVMSG(SharedPtr<ClientControlBlock>
     }
 
     // No receipients given
-    if (arguments.size() <= 0)
+    if (msg.NumParams <= 0)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NORECIPIENT(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
     // No text to send
-    if (arguments.size() <= 1)
+    if (msg.NumParams <= 1)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NOTEXTTOSEND(mServerName)));
         return IRC_SUCCESS;
     }
 
-    // Split receivers
-    std::vector<const char*> receivers;
-    for (char* p = arguments[0]; *p != '\0'; p++)
+    // The client-only tags are relayed if the client enabled the message-tags (See [ \ref irc_server_message_tags ])
+    char clientTags[CLIENT_TAGS_LEN_MAX + 1];
+    if (!client->IsCapEnabled(CAP_MESSAGE_TAGS) || msg.CopyClientOnlyTags(clientTags, sizeof(clientTags)) == 0)
     {
-        if (*p != ',')
-        {
-            receivers.push_back(p);
-        }
-        for (; *p != '\0' && *p != ','; p++)
-        {
-        }
-        if (*p == '\0')
-        {
-            break;
-        }
-        *p = '\0';            
+        clientTags[0] = '\0';
     }
 
-    for (size_t i = 0; i < receivers.size(); i++)
+    // Split receivers (See SplitCommaList())
+    StrView receivers[NUM_LIST_ITEMS_MAX];
+    const size_t numReceivers = SplitCommaList(msg.Params[0], std::strlen(msg.Params[0]), receivers, NUM_LIST_ITEMS_MAX);
+
+    // The relayed line ":<nick> PRIVMSG <receiver> :<text>" is made on the stack. Only the receiver differs.
+    static const char COMMAND_PART[] = " PRIVMSG ";
+    static const char TEXT_PART[] = " :";
+    char privMsg[MESSAGE_LEN_MAX];
+    privMsg[0] = ':';
+    size_t prefixLen = appendToLine(privMsg, 1, client->Nickname.data(), client->Nickname.size());
+    prefixLen = appendToLine(privMsg, prefixLen, COMMAND_PART, sizeof(COMMAND_PART) - 1);
+    const size_t textLen = std::strlen(msg.Params[1]);
+
+    for (size_t i = 0; i < numReceivers; i++)
     {
-        const std::string receiver = receivers[i];
+        const std::string receiver(receivers[i].Str, receivers[i].Len);
+        size_t privMsgLen = appendToLine(privMsg, prefixLen, receivers[i].Str, receivers[i].Len);
+        privMsgLen = appendToLine(privMsg, privMsgLen, TEXT_PART, sizeof(TEXT_PART) - 1);
+        privMsgLen = appendToLine(privMsg, privMsgLen, msg.Params[1], textLen);
 
         // Channel
         if (receiver[0] == '#')
@@ -74,9 +92,8 @@ EIrcErrorCode Server::executeClientCommand_PRIVMSG(SharedPtr<ClientControlBlock>
             }
 
             // Send the message to the channel
-            const std::string content = arguments[1];
-            const std::string msg = ":" + client->Nickname + " PRIVMSG " + receiver + " :" + content;
-            sendMsgToChannel(channel, MakeShared<MsgBlock>(msg), client);
+            // The channel messages are the first to drop for a slow consumer. (See ServerConfig::SendQueuePolicy)
+            sendTaggedMsgToChannel(channel, privMsg, privMsgLen, clientTags, client, true);
         }
 
         // User
@@ -91,9 +108,7 @@ EIrcErrorCode Server::executeClientCommand_PRIVMSG(SharedPtr<ClientControlBlock>
             }
 
             // Send the message to the user
-            const std::string content = arguments[1];
-            const std::string msg = ":" + client->Nickname + " PRIVMSG " + receiver + " :" + content;
-            sendMsgToClient(user, MakeShared<MsgBlock>(msg));
+            sendTaggedMsgToClient(user, privMsg, privMsgLen, clientTags);
         }
     }
 
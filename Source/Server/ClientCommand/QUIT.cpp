@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: QUIT [<quit message>]
-EIrcErrorCode Server::executeClientCommand_QUIT(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_QUIT(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("QUIT");
 
@@ -13,16 +13,11 @@ EIrcErrorCode Server::executeClientCommand_QUIT(SharedPtr<ClientControlBlock> cl
         return IRC_SUCCESS;
     }
 
-    if (arguments.size() >= 1)
+    if (msg.NumParams >= 1)
     {
-        disconnectClient(client, arguments[0]);
+        return disconnectClient(client, msg.Params[0]);
     }
-    else
-    {
-        disconnectClient(client);
-    }
-
-    return IRC_SUCCESS;
+    return disconnectClient(client);
 }
 
 }
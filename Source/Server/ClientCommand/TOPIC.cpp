@@ -4,7 +4,7 @@ namespace IRC
 {
 
 // Syntax: TOPIC <channel> [<topic>]
-EIrcErrorCode Server::executeClientCommand_TOPIC(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_TOPIC(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("TOPIC");
 
@@ -20,16 +20,16 @@ EIrcErrorCode Server::executeClientCommand_TOPIC(SharedPtr<ClientControlBlock> c
     }
 
     // Need more arguments
-    if (arguments.size() == 0)
+    if (msg.NumParams == 0)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
     // Show topic
-    if (arguments.size() == 1)
+    if (msg.NumParams == 1)
     {
-        const std::string channelName = arguments[0];
+        const std::string channelName = msg.Params[0];
 
         // Check if the client is on the the channel
         SharedPtr<ChannelControlBlock> channel = client->FindChannel(channelName);
@@ -53,8 +53,8 @@ EIrcErrorCode Server::executeClientCommand_TOPIC(SharedPtr<ClientControlBlock> c
     // Set topic
     else
     {
-        const std::string channelName = arguments[0];
-        const std::string topic = arguments[1];
+        const std::string channelName = msg.Params[0];
+        const std::string topic = msg.Params[1];
 
         // Check if the client is on the the channel
         SharedPtr<ChannelControlBlock> channel = client->FindChannel(channelName);
@@ -1,11 +1,10 @@
-#include <cctype>
 #include "Server/Server.hpp"
 
 namespace IRC
 {
 
 // Syntax: USER <username> <hostname> <servername> <realname>
-EIrcErrorCode Server::executeClientCommand_USER(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments)
+EIrcErrorCode Server::executeClientCommand_USER(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg)
 {
     const std::string   commandName("USER");
 
@@ -22,33 +21,29 @@ EIrcErrorCode Server::executeClientCommand_USER(SharedPtr<ClientControlBlock> cl
     }
 
     // Need more parameters
-    if (arguments.size() < 4)
+    if (msg.NumParams < 4)
     {
         sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_ERR_NEEDMOREPARAMS(mServerName, commandName)));
         return IRC_SUCCESS;
     }
 
-    // Validate names
+    // Validate names (See GetUserParamCharClass())
     for (size_t i = 0; i < 4; i++)
     {
-        for (const char* p = arguments[i]; *p != '\0'; p++)
+        const size_t paramLen = std::strlen(msg.Params[i]);
+
+        // An empty trailing parameter is an invalid name too.
+        if (paramLen == 0 || !GetUserParamCharClass().IsValid(msg.Params[i], paramLen))
         {
-            if (isalnum(*p) == 0 && *p != '_' && *p != '*')
-            {
-                sendMsgToClient(client, MakeShared<MsgBlock>("ERROR :Invalid USER arguments"));
-                
-                return IRC_SUCCESS;
-            }
+            sendMsgToClient(client, MakeShared<MsgBlock>("ERROR :Invalid USER arguments"));
+            return IRC_SUCCESS;
         }
-
-        // Empty name
-        Assert(arguments[i][0] != '\0');
     }
 
     // Set user information
     // (Hostname and Servername are ignored)
-    client->Username = arguments[0];
-    client->Realname = arguments[3];
+    client->Username = msg.Params[0];
+    client->Realname = msg.Params[3];
 
     // Register the client
     registerClient(client);
@@ -2,14 +2,15 @@
 
 #include <string>
 #include <vector>
-#include <ctime>
-#include <queue>
+#include <deque>
 #include <map>
 
 #include "Core/FlexibleMemoryPoolingBase.hpp"
+#include "Core/TimerWheel.hpp"
 using namespace IRCCore;
 
 #include "Network/SocketTypedef.hpp"
+#include "Network/ZeroCopy.hpp"
 #include "Server/MsgBlock.hpp"
 
 #include "Server/ChannelControlBlock.hpp"
@@ -17,6 +18,55 @@ using namespace IRCCore;
 namespace IRC
 {    
 
+/** Lane of a message sent to a client. (See [ \ref irc_server_send_lanes ]) */
+enum ESendLane
+{
+    /** Replies, numerics and the other messages. Added to the end of the MsgSendingQueue. */
+    SEND_LANE_CONTROL,
+
+    /** Channel messages relayed to the client. Wait in the BulkMsgQueue while the MsgSendingQueue is long. */
+    SEND_LANE_BULK,
+
+    NUM_SEND_LANES
+};
+
+/**
+ *  @def    IRC_CAPABILITY_LIST
+ *  @brief  Tuple of the IRCv3 capabilities of the server | IRC_CAPABILITY_X(capability, capability_name) (See [ \ref irc_server_message_tags ])
+ */
+#define IRC_CAPABILITY_LIST                                 \
+    IRC_CAPABILITY_X(CAP_MESSAGE_TAGS, "message-tags")      \
+    IRC_CAPABILITY_X(CAP_SERVER_TIME , "server-time")
+
+/** Bit index of the capability in the ClientControlBlock::EnabledCaps */
+enum ECapability
+{
+#define IRC_CAPABILITY_X(capability, capability_name) capability,
+    IRC_CAPABILITY_LIST
+#undef  IRC_CAPABILITY_X
+    NUM_CAPABILITIES
+};
+
+/** Capabilities that add the tags to the messages relayed to the client. A relayed message is made for each set of them. */
+enum
+{
+    TAG_CAPS_MASK = (1u << CAP_MESSAGE_TAGS) | (1u << CAP_SERVER_TIME),
+    NUM_TAG_CAP_SETS = TAG_CAPS_MASK + 1
+};
+
+/** Name of the capability in the CAP messages. */
+FORCEINLINE const char* GetCapabilityName(const ECapability capability)
+{
+    switch (capability)
+    {
+#define IRC_CAPABILITY_X(capability, capability_name) case capability: return capability_name;
+        IRC_CAPABILITY_LIST
+#undef  IRC_CAPABILITY_X
+        default:
+            return "";
+    }
+}
+
 /** Control block for management of a client connection and its information.
  * 
  * @details    new/delete overrided with memory pool.
@@ -24,8 +74,14 @@ namespace IRC
 class ClientControlBlock : public FlexibleMemoryPoolingBase<ClientControlBlock>
 {
 public: 
+    /** Value of an index that is not in the container. */
+    static const size_t INVALID_INDEX = static_cast<size_t>(-1);
+
     int hSocket;
 
+    /** Index of the reactor that accepted the client. Only the reactor does the I/O of the client. (See ReactorControlBlock) */
+    unsigned int ReactorIdx;
+
     sockaddr_in_t Addr;
 
     std::string Nickname;
@@ -34,13 +90,52 @@ public:
     
     std::string ServerPass;
 
-    time_t LastActiveTime;
+    /** Monotonic time (microseconds) of the tick that the client's messages are received last. (See ReactorControlBlock::TickTime) */
+    uint64_t LastActiveTime;
+
+    /** Registration, idle, PING and disconnection deadline of the client in ReactorControlBlock::ClientTimers.
+     *  The Owner is the control block of the client. (See [ \ref irc_server_client_timer ])
+     */
+    TimerWheel::Timer DeadlineTimer;
+
+    /** Monotonic time (microseconds) when the PING is sent, or 0 if there is no PING to be replied. */
+    uint64_t PingSentTime;
+
+    /** @name Round-trip time of the PING sent by the server, 0 before the first PONG. (See [ \ref irc_server_keepalive ]) */
+    ///@{
+    uint64_t RttMicrosec;
+    uint64_t SmoothedRttMicrosec;
+    ///@}
 
     bool bRegistered;
 
-    /** Flag that indicate whether the client is expired, and expired client will be released after the remaining messages are sent. */
+    /** @name IRCv3 capabilities (See [ \ref irc_server_message_tags ]) */
+    ///@{
+    /** Bits of the capabilities enabled by the CAP REQ. (1 << ECapability) */
+    unsigned int EnabledCaps;
+
+    /** The CAP negotiation is started before the registration. The registration waits for the CAP END. */
+    bool bCapNegotiating;
+    ///@}
+
+    /** Index in the Server::mUnregistedClients until the client is registered, for O(1) removal. */
+    size_t UnregisteredClientIdx;
+
+    /** @name Pending registrations (See [ \ref irc_server_registration_coalescing ]) */
+    ///@{
+    /** ReactorControlBlock::NumTicks when the QueuedEventIdx is set. The indices of an older tick are not valid. */
+    uint64_t QueuedEventTick;
+
+    /** Index of the pending READ[0] and WRITE[1] registration in the ReactorControlBlock::EventRegistrationQueue. */
+    size_t QueuedEventIdx[2];
+    ///@}
+
+    /** Flag that indicate whether the client is expired, and expired client will be released after the remaining messages are sent.
+     *  @note   Can be set by any reactor with the lock. (e.g. A slow consumer) Not read without the lock.
+     */
     bool bExpired;
 
+    /** @note   Modified only by the reactor of the client, and read by it without the lock. (See [ \ref irc_server_multi_reactor ]) */
     bool bSocketClosed;
 
     /** Received messages from the client.
@@ -53,35 +148,182 @@ public:
     /** A cursor to indicate the next offset to receive in the message block at the front of the RecvMsgBlocks */
     size_t RecvMsgBlockCursor;
 
+    /** The message at the RecvMsgBlockCursor is too long, and skipped until the "\r\n". (See [ \ref irc_server_line_split ])
+     *  @note   The skipped bytes are consumed as they are scanned, so that they do not keep the receive paused.
+     */
+    bool bSkippingRecvMsg;
+
+    /** The last skipped character, to find the "\r\n" across the received blocks. */
+    char LastSkippedRecvChar;
+
+    /** The READ event filter is disabled until the received messages are processed. (See [ \ref irc_server_recv_backpressure ])
+     *  @note   Modified only by the reactor of the client, and read by it without the lock. Same for the RecvMsgBlocks.
+     */
+    bool bRecvPaused;
+
+    /** The client is in the message processing queue of the reactor. (See [ \ref irc_server_msg_process_scheduling ]) */
+    bool bMsgProcessQueued;
+
+    /** Monotonic time (microseconds) when the client is added to the message processing queue. */
+    uint64_t MsgProcessQueuedTime;
+
     /** Queue of messages to send.
      * 
-     *  @note Do not modify the message block in the queue.
+     *  @note Do not modify the message block in the queue, except appending to the tail page owned by the client.
      **/
-    std::queue< SharedPtr< MsgBlock > > MsgSendingQueue;
+    std::deque< SharedPtr< MsgBlock > > MsgSendingQueue;
+
+    /** The block at the tail of the MsgSendingQueue is a page of this client that the short replies are appended to. (See [ \ref irc_server_reply_coalescing ]) */
+    bool bSendQueueTailOwned;
 
     /** A cursor to indicate the next offset to send in the message block at the front of the MsgSendingQueue */
     size_t SendMsgBlockCursor;
 
+    /** @name Send queue limit (See [ \ref irc_server_send_queue_limit ]) */
+    ///@{
+    /** Unsent bytes of the MsgSendingQueue and the BulkMsgQueue. */
+    size_t NumSendingQueueBytes;
+
+    /** High-water mark of the NumSendingQueueBytes. */
+    size_t MaxSendingQueueBytes;
+
+    /** Number of the channel messages dropped by the SENDQ_POLICY_DROP_CHANNEL_MSG. */
+    size_t NumDroppedMsgs;
+    ///@}
+
+    /** @name Send lanes (See [ \ref irc_server_send_lanes ]) */
+    ///@{
+    /** A channel message waiting for the MsgSendingQueue, and the monotonic time (microseconds) when it is queued. */
+    struct BulkMsg
+    {
+        SharedPtr<MsgBlock> Msg;
+        uint64_t QueuedTime;
+    };
+
+    /** The bulk lane, from the BulkMsgQueueHead. Not empty only if the MsgSendingQueue is not empty.
+     *  @note   A vector does not allocate until the first deferred message, unlike a deque.
+     */
+    std::vector<BulkMsg> BulkMsgQueue;
+
+    /** Index of the front of the BulkMsgQueue. The entries before it are sent and erased when it passes the half. */
+    size_t BulkMsgQueueHead;
+
+    /** Bytes added to the MsgSendingQueue and sent from it since the connection. */
+    uint64_t NumTotalQueuedBytes;
+    uint64_t NumTotalSentBytes;
+
+    /** A sampled message of each lane. Its wait is measured when the NumTotalSentBytes reaches its end offset. (0 if none) */
+    uint64_t LaneSampleEndOffset[NUM_SEND_LANES];
+    uint64_t LaneSampleQueuedTime[NUM_SEND_LANES];
+    ///@}
+
+    /** The WRITE event filter is armed for the unsent messages. (See [ \ref irc_server_inline_send ]) */
+    bool bWriteFilterArmed;
+
+    /** The sending queue is in the PendingSends of the reactor in this tick. */
+    bool bSendScheduled;
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    /** @name MSG_ZEROCOPY sends (See [ \ref irc_server_zerocopy ]) */
+    ///@{
+    /** A MSG_ZEROCOPY send not notified by the kernel yet, and the number of the message blocks it sent from. */
+    struct ZeroCopySend
+    {
+        uint32_t Seq;
+        size_t NumMsgBlocks;
+    };
+
+    /** SO_ZEROCOPY is set on the socket. */
+    bool bZeroCopyEnabled;
+
+    /** Sequence number of the next MSG_ZEROCOPY send. Same as the counter of the socket in the kernel. */
+    uint32_t NextZeroCopySeq;
+
+    std::deque<ZeroCopySend> InFlightZeroCopySends;
+
+    /** Message blocks of the InFlightZeroCopySends in order. The kernel reads them until the send is notified. */
+    std::deque< SharedPtr< MsgBlock > > ZeroCopyMsgBlocks;
+    ///@}
+#endif
+
     /** Map of channel name to the channel control block that the client is connected. */
     std::map< std::string, SharedPtr< ChannelControlBlock > > Channels;
 
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    /** Number of the io_uring requests that have this client as udata. The client must not be released until it becomes 0. */
+    size_t NumPendingIoRequests;
+
+    /** Number of the send requests in flight. The sending queue is submitted again when it becomes 0. */
+    size_t NumInFlightSends;
+
+    /** The socket is corked while the linked send requests are in flight, and uncorked when the sending queue is empty. (See [ \ref irc_server_output_batching ]) */
+    bool bSendCorked;
+#endif
+
     FORCEINLINE ClientControlBlock()
         : hSocket(-1)
+        , ReactorIdx(0)
         , Addr()
         , Nickname()
         , Realname()
         , Username()
         , ServerPass()
         , LastActiveTime(0)
+        , DeadlineTimer()
+        , PingSentTime(0)
+        , RttMicrosec(0)
+        , SmoothedRttMicrosec(0)
         , bRegistered(false)
+        , EnabledCaps(0)
+        , bCapNegotiating(false)
+        , UnregisteredClientIdx(INVALID_INDEX)
+        , QueuedEventTick(0)
         , bExpired(false)
         , bSocketClosed(false)
         , RecvMsgBlocks()
         , RecvMsgBlockCursor(0)
+        , bSkippingRecvMsg(false)
+        , LastSkippedRecvChar('\0')
+        , bRecvPaused(false)
+        , bMsgProcessQueued(false)
+        , MsgProcessQueuedTime(0)
         , MsgSendingQueue()
+        , bSendQueueTailOwned(false)
         , SendMsgBlockCursor(0)
+        , NumSendingQueueBytes(0)
+        , MaxSendingQueueBytes(0)
+        , NumDroppedMsgs(0)
+        , BulkMsgQueue()
+        , BulkMsgQueueHead(0)
+        , NumTotalQueuedBytes(0)
+        , NumTotalSentBytes(0)
+        , bWriteFilterArmed(false)
+        , bSendScheduled(false)
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        , bZeroCopyEnabled(false)
+        , NextZeroCopySeq(0)
+        , InFlightZeroCopySends()
+        , ZeroCopyMsgBlocks()
+#endif
         , Channels()
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+        , NumPendingIoRequests(0)
+        , NumInFlightSends(0)
+        , bSendCorked(false)
+#endif
+    {
+        QueuedEventIdx[0] = INVALID_INDEX;
+        QueuedEventIdx[1] = INVALID_INDEX;
+        for (int lane = 0; lane < NUM_SEND_LANES; lane++)
+        {
+            LaneSampleEndOffset[lane] = 0;
+            LaneSampleQueuedTime[lane] = 0;
+        }
+    }
+
+    FORCEINLINE bool IsCapEnabled(const ECapability capability) const
     {
+        return (EnabledCaps & (1u << capability)) != 0;
     }
 
     FORCEINLINE SharedPtr<ChannelControlBlock> FindChannel(const std::string& ChannelName)
@@ -0,0 +1,742 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "Server/Server.hpp"
+
+namespace IRC
+{
+
+volatile sig_atomic_t Server::mbUpgradeRequested = 0;
+volatile int Server::mhUpgradeWakeupSockets[REACTOR_MAX];
+volatile sig_atomic_t Server::mNumUpgradeWakeupSockets = 0;
+
+namespace
+{
+
+/** Sent first to the new process. The descriptors and the state follow it. */
+struct UpgradeHeader
+{
+    uint64_t Magic;
+
+    /** The state is restored only by the binary of the same format. */
+    uint64_t Version;
+
+    uint64_t NumListenSockets;
+    uint64_t NumFds;
+    uint64_t StateLen;
+};
+
+enum
+{
+    UPGRADE_MAGIC   = 0x49524355, //< "IRCU"
+    UPGRADE_VERSION = 5,
+    UPGRADE_ACK     = 'A'
+};
+
+enum
+{
+    CHANNEL_FLAG_INVITE_ONLY     = 1 << 0,
+    CHANNEL_FLAG_TOPIC_PROTECTED = 1 << 1,
+    CHANNEL_FLAG_PRIVATE         = 1 << 2
+};
+
+/** @name State writer
+ *  The values are in the byte order of the host, because the state is only read by the process on the same host.
+ */
+///@{
+void appendU64(std::vector<char>& state, const uint64_t value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    state.insert(state.end(), bytes, bytes + sizeof(value));
+}
+
+void appendBytes(std::vector<char>& state, const char* bytes, const size_t numBytes)
+{
+    appendU64(state, numBytes);
+    state.insert(state.end(), bytes, bytes + numBytes);
+}
+
+void appendString(std::vector<char>& state, const std::string& str)
+{
+    appendBytes(state, str.data(), str.size());
+}
+///@}
+
+/** Reads the state written by the functions above. A read out of the state fails the reader instead of the bounds check of each read. */
+class UpgradeStateReader
+{
+public:
+    explicit UpgradeStateReader(const std::vector<char>& state)
+        : mState(state)
+        , mCursor(0)
+        , mbFailed(false)
+    {
+    }
+
+    uint64_t ReadU64()
+    {
+        uint64_t value = 0;
+        if (!canRead(sizeof(value)))
+        {
+            return 0;
+        }
+        std::memcpy(&value, &mState[mCursor], sizeof(value));
+        mCursor += sizeof(value);
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        const uint64_t numBytes = ReadU64();
+        if (!canRead(numBytes))
+        {
+            return std::string();
+        }
+        const std::string str(&mState[0] + mCursor, static_cast<size_t>(numBytes));
+        mCursor += static_cast<size_t>(numBytes);
+        return str;
+    }
+
+    /** Count of the entries to read. An entry is at least 8 bytes, so a larger count is failed before it is reserved. */
+    size_t ReadCount()
+    {
+        const uint64_t count = ReadU64();
+        if (count > (mState.size() - mCursor) / sizeof(uint64_t))
+        {
+            mbFailed = true;
+            return 0;
+        }
+        return static_cast<size_t>(count);
+    }
+
+    bool IsFailed() const { return mbFailed; }
+
+private:
+    bool canRead(const uint64_t numBytes)
+    {
+        if (mbFailed || numBytes > mState.size() - mCursor)
+        {
+            mbFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::vector<char>& mState;
+    size_t mCursor;
+    bool mbFailed;
+};
+
+/** @name Blocking I/O of the upgrade socket */
+///@{
+bool sendAll(const int hSocket, const char* bytes, size_t numBytes)
+{
+    int flags = 0;
+#if defined(MSG_NOSIGNAL)
+    flags |= MSG_NOSIGNAL; //< The new process can exit while sending.
+#endif
+    while (numBytes > 0)
+    {
+        const ssize_t nSent = send(hSocket, bytes, numBytes, flags);
+        if (nSent == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes += nSent;
+        numBytes -= static_cast<size_t>(nSent);
+    }
+    return true;
+}
+
+bool recvAll(const int hSocket, char* bytes, size_t numBytes)
+{
+    while (numBytes > 0)
+    {
+        const ssize_t nRecv = recv(hSocket, bytes, numBytes, 0);
+        if (nRecv == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (nRecv <= 0)
+        {
+            return false;
+        }
+        bytes += nRecv;
+        numBytes -= static_cast<size_t>(nRecv);
+    }
+    return true;
+}
+
+/** Control message buffer of a batch of descriptors, aligned for the cmsghdr. */
+union UpgradeFdControl
+{
+    char Buffer[CMSG_SPACE(sizeof(int) * NUM_UPGRADE_FDS_PER_MSG_MAX)];
+    struct cmsghdr Align;
+};
+
+/** Send the descriptors with SCM_RIGHTS. The number of them is sent as the data, so that a recvmsg() of its size receives exactly a batch. */
+bool sendFds(const int hSocket, const int* fds, const size_t numFds)
+{
+    Assert(numFds > 0 && numFds <= NUM_UPGRADE_FDS_PER_MSG_MAX);
+
+    uint32_t count = static_cast<uint32_t>(numFds);
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len  = sizeof(count);
+
+    UpgradeFdControl control;
+    std::memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.Buffer;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * numFds);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * numFds);
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * numFds);
+
+    int flags = 0;
+#if defined(MSG_NOSIGNAL)
+    flags |= MSG_NOSIGNAL;
+#endif
+    ssize_t nSent;
+    do
+    {
+        nSent = sendmsg(hSocket, &msg, flags);
+    } while (nSent == -1 && errno == EINTR);
+    return nSent == static_cast<ssize_t>(sizeof(count));
+}
+
+/** Receive a batch of the descriptors sent by sendFds(), and append them. */
+bool recvFds(const int hSocket, std::vector<int>& outFds)
+{
+    uint32_t count = 0;
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len  = sizeof(count);
+
+    UpgradeFdControl control;
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.Buffer;
+    msg.msg_controllen = sizeof(control.Buffer);
+
+    ssize_t nRecv;
+    do
+    {
+        nRecv = recvmsg(hSocket, &msg, MSG_WAITALL);
+    } while (nRecv == -1 && errno == EINTR);
+
+    // The received descriptors are kept to be closed even if the batch is broken.
+    size_t numReceived = 0;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); nRecv > 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            const size_t numFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < numFds; i++)
+            {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                outFds.push_back(fd);
+            }
+            numReceived += numFds;
+        }
+    }
+
+    // Truncated if the descriptors of this process run out.
+    return nRecv == static_cast<ssize_t>(sizeof(count)) && (msg.msg_flags & MSG_CTRUNC) == 0 && numReceived == count;
+}
+///@}
+
+} // namespace
+
+void Server::closeUpgradeFds(const std::vector<int>& fds, const size_t fromIdx)
+{
+    for (size_t i = fromIdx; i < fds.size(); i++)
+    {
+        close(fds[i]);
+    }
+}
+
+void Server::serializeUpgradeState(std::vector<int>& outFds, std::vector<char>& outState) const
+{
+    for (size_t reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        outFds.push_back(mReactors[reactorIdx]->hListenSocket);
+    }
+
+    // The clients disconnecting are not handed over. Their sockets are closed by this process.
+    std::vector< SharedPtr< ClientControlBlock > > clients;
+    clients.reserve(mNumClients);
+    for (size_t i = 0; i < mUnregistedClients.size(); i++)
+    {
+        if (!mUnregistedClients[i]->bExpired && !mUnregistedClients[i]->bSocketClosed)
+        {
+            clients.push_back(mUnregistedClients[i]);
+        }
+    }
+    for (std::map< std::string, SharedPtr< ClientControlBlock > >::const_iterator it = mClients.begin(); it != mClients.end(); ++it)
+    {
+        if (!it->second->bExpired && !it->second->bSocketClosed)
+        {
+            clients.push_back(it->second);
+        }
+    }
+
+    appendU64(outState, clients.size());
+    for (size_t clientIdx = 0; clientIdx < clients.size(); clientIdx++)
+    {
+        const SharedPtr<ClientControlBlock>& client = clients[clientIdx];
+        outFds.push_back(client->hSocket);
+
+        appendU64(outState, client->ReactorIdx);
+        appendBytes(outState, reinterpret_cast<const char*>(&client->Addr), sizeof(client->Addr));
+        appendString(outState, client->Nickname);
+        appendString(outState, client->Realname);
+        appendString(outState, client->Username);
+        appendString(outState, client->ServerPass);
+        appendU64(outState, client->bRegistered ? 1 : 0);
+        appendU64(outState, client->EnabledCaps);
+        appendU64(outState, client->bCapNegotiating ? 1 : 0);
+
+        // The monotonic clock is the same in the new process.
+        appendU64(outState, client->LastActiveTime);
+        appendU64(outState, client->DeadlineTimer.IsScheduled() ? client->DeadlineTimer.ExpireTick * CLIENT_TIMER_TICK_MICROSEC : 0);
+        appendU64(outState, client->PingSentTime);
+        appendU64(outState, client->RttMicrosec);
+        appendU64(outState, client->SmoothedRttMicrosec);
+        appendU64(outState, client->MaxSendingQueueBytes);
+        appendU64(outState, client->NumDroppedMsgs);
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        // The sequence numbers of the MSG_ZEROCOPY sends continue in the socket.
+        appendU64(outState, client->NextZeroCopySeq);
+#else
+        appendU64(outState, 0);
+#endif
+
+        // The bytes received but not processed, from the cursor of the front block.
+        std::string pendingBytes;
+        for (size_t i = 0; i < client->RecvMsgBlocks.size(); i++)
+        {
+            const MsgBlock& recvMsgBlock = *client->RecvMsgBlocks[i];
+            const size_t offset = (i == 0) ? std::min(client->RecvMsgBlockCursor, recvMsgBlock.MsgLen) : 0;
+            pendingBytes.append(recvMsgBlock.Msg + offset, recvMsgBlock.MsgLen - offset);
+        }
+        appendString(outState, pendingBytes);
+        appendU64(outState, client->bSkippingRecvMsg ? 1 : 0);
+        appendU64(outState, static_cast<unsigned char>(client->LastSkippedRecvChar));
+
+        // The bytes not sent, from the cursor of the front block, and then the bulk lane.
+        pendingBytes.clear();
+        for (size_t i = 0; i < client->MsgSendingQueue.size(); i++)
+        {
+            const MsgBlock& sendMsgBlock = *client->MsgSendingQueue[i];
+            const size_t offset = (i == 0) ? std::min(client->SendMsgBlockCursor, sendMsgBlock.MsgLen) : 0;
+            pendingBytes.append(sendMsgBlock.Msg + offset, sendMsgBlock.MsgLen - offset);
+        }
+        for (size_t i = client->BulkMsgQueueHead; i < client->BulkMsgQueue.size(); i++)
+        {
+            const MsgBlock& bulkMsgBlock = *client->BulkMsgQueue[i].Msg;
+            pendingBytes.append(bulkMsgBlock.Msg, bulkMsgBlock.MsgLen);
+        }
+        appendString(outState, pendingBytes);
+    }
+
+    // The channels are written with the nicknames of the members, and linked to the restored clients by them.
+    uint64_t numChannels = 0;
+    const size_t numChannelsIdx = outState.size();
+    appendU64(outState, 0);
+    for (std::map< std::string, WeakPtr< ChannelControlBlock > >::const_iterator it = mChannels.begin(); it != mChannels.end(); ++it)
+    {
+        // The channel destroyed by the last member leaving is still in the map until it is looked up. (See findChannelGlobal())
+        // Its control block is marked expired without clearing the strong count, so Lock() is checked instead of Expired().
+        SharedPtr<ChannelControlBlock> channel = it->second.Lock();
+        if (channel == NULL)
+        {
+            continue;
+        }
+        const std::map<std::string, WeakPtr< ClientControlBlock > >* nicknameMaps[3] = { &channel->Clients, &channel->Operators, &channel->InvitedClients };
+
+        appendString(outState, channel->Name);
+        appendString(outState, channel->Topic);
+        appendString(outState, channel->Password);
+        appendU64(outState, channel->MaxClients);
+        appendU64(outState, (channel->bInviteOnly ? CHANNEL_FLAG_INVITE_ONLY : 0)
+                            | (channel->bTopicProtected ? CHANNEL_FLAG_TOPIC_PROTECTED : 0)
+                            | (channel->bPrivate ? CHANNEL_FLAG_PRIVATE : 0));
+        for (size_t mapIdx = 0; mapIdx < 3; mapIdx++)
+        {
+            appendU64(outState, nicknameMaps[mapIdx]->size());
+            for (std::map<std::string, WeakPtr< ClientControlBlock > >::const_iterator nickIt = nicknameMaps[mapIdx]->begin(); nickIt != nicknameMaps[mapIdx]->end(); ++nickIt)
+            {
+                appendString(outState, nickIt->first);
+            }
+        }
+        numChannels++;
+    }
+    std::memcpy(&outState[numChannelsIdx], &numChannels, sizeof(numChannels));
+}
+
+void Server::RequestUpgrade()
+{
+    mbUpgradeRequested = 1;
+
+    // The signal interrupts the Wait() of only one thread, and a reactor without a timer blocks until an event.
+    // write() is async-signal-safe. A full wakeup socket already has a wakeup pending.
+    const int savedErrno = errno;
+    for (sig_atomic_t reactorIdx = 0; reactorIdx < mNumUpgradeWakeupSockets; reactorIdx++)
+    {
+        const char wakeupByte = 0;
+        const ssize_t nWritten = write(mhUpgradeWakeupSockets[reactorIdx], &wakeupByte, sizeof(wakeupByte));
+        (void)nWritten;
+    }
+    errno = savedErrno;
+}
+
+EIrcErrorCode Server::handOverToNewProcess()
+{
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    // The requests in flight can not be handed over. (Not requested by the event loop)
+    return IRC_FAILED_TO_UPGRADE;
+#endif
+    Assert(!mConfig.CommandLine.empty());
+
+    std::vector<int> fds;
+    std::vector<char> state;
+    serializeUpgradeState(fds, state);
+
+    logMessage("Hot upgrade. Handing over " + ValToString(fds.size() - mReactors.size()) + " clients and " + ValToString(state.size()) + " bytes of the state to " + mConfig.CommandLine[0]);
+
+    int hSockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, hSockets) == -1)
+    {
+        return IRC_FAILED_TO_UPGRADE;
+    }
+
+    // The options of the new process are the same, with the socket to receive the state.
+    std::vector<std::string> args(mConfig.CommandLine);
+    args.push_back("--upgrade-fd=" + ValToString(hSockets[1]));
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+    const long maxFd = sysconf(_SC_OPEN_MAX);
+
+    const pid_t pid = fork();
+    if (pid == -1)
+    {
+        close(hSockets[0]);
+        close(hSockets[1]);
+        return IRC_FAILED_TO_UPGRADE;
+    }
+    if (pid == 0)
+    {
+        // Only the descriptors passed by the socket are used. The other ones of this process are not inherited.
+        for (int fd = STDERR_FILENO + 1; fd < maxFd; fd++)
+        {
+            if (fd != hSockets[1])
+            {
+                close(fd);
+            }
+        }
+        execvp(argv[0], &argv[0]);
+        _exit(EXIT_FAILURE);
+    }
+    close(hSockets[1]);
+
+    // A new process stuck before the restore must not block this one.
+    struct timeval sendTimeout;
+    sendTimeout.tv_sec  = UPGRADE_HANDOVER_TIMEOUT;
+    sendTimeout.tv_usec = 0;
+    setsockopt(hSockets[0], SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+    UpgradeHeader header;
+    header.Magic            = UPGRADE_MAGIC;
+    header.Version          = UPGRADE_VERSION;
+    header.NumListenSockets = mReactors.size();
+    header.NumFds           = fds.size();
+    header.StateLen         = state.size();
+    bool bHandedOver = sendAll(hSockets[0], reinterpret_cast<const char*>(&header), sizeof(header));
+    for (size_t fdIdx = 0; bHandedOver && fdIdx < fds.size(); fdIdx += NUM_UPGRADE_FDS_PER_MSG_MAX)
+    {
+        bHandedOver = sendFds(hSockets[0], &fds[fdIdx], std::min(fds.size() - fdIdx, static_cast<size_t>(NUM_UPGRADE_FDS_PER_MSG_MAX)));
+    }
+    bHandedOver = bHandedOver && sendAll(hSockets[0], &state[0], state.size());
+
+    // The new process owns the sockets from the ACK.
+    if (bHandedOver)
+    {
+        struct pollfd ackPoll;
+        ackPoll.fd      = hSockets[0];
+        ackPoll.events  = POLLIN;
+        ackPoll.revents = 0;
+        char ack = 0;
+        bHandedOver = poll(&ackPoll, 1, UPGRADE_HANDOVER_TIMEOUT * 1000) == 1 && recv(hSockets[0], &ack, sizeof(ack), 0) == 1 && ack == UPGRADE_ACK;
+    }
+    close(hSockets[0]);
+
+    if (!bHandedOver)
+    {
+        // The sockets are still served by this process.
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        logMessage("Hot upgrade failed. Keep serving with this process.");
+        return IRC_FAILED_TO_UPGRADE;
+    }
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    // The kernel reads the MSG_ZEROCOPY sends of the handed over sockets until they are acknowledged, even after this process exits.
+    // Their message blocks must not be reused, so they are kept until the server is deleted, after which no message block is allocated.
+    for (size_t i = 0; i < mUnregistedClients.size(); i++)
+    {
+        mHandedOverZeroCopyMsgBlocks.insert(mHandedOverZeroCopyMsgBlocks.end(), mUnregistedClients[i]->ZeroCopyMsgBlocks.begin(), mUnregistedClients[i]->ZeroCopyMsgBlocks.end());
+    }
+    for (std::map< std::string, SharedPtr< ClientControlBlock > >::const_iterator it = mClients.begin(); it != mClients.end(); ++it)
+    {
+        mHandedOverZeroCopyMsgBlocks.insert(mHandedOverZeroCopyMsgBlocks.end(), it->second->ZeroCopyMsgBlocks.begin(), it->second->ZeroCopyMsgBlocks.end());
+    }
+    for (size_t reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            mHandedOverZeroCopyMsgBlocks.insert(mHandedOverZeroCopyMsgBlocks.end(), mReactors[reactorIdx]->LingeringZeroCopyMsgBlocks[i].begin(), mReactors[reactorIdx]->LingeringZeroCopyMsgBlocks[i].end());
+        }
+    }
+#endif
+
+    logMessage("Hot upgrade done. New process: " + ValToString(pid));
+    return IRC_SUCCESS;
+}
+
+EIrcErrorCode Server::receiveUpgradeState(std::vector<int>& outFds, std::vector<char>& outState)
+{
+    const int hSocket = mConfig.hUpgradeSocket;
+    bool bReceived = true;
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    logMessage("Hot upgrade is not supported by the io_uring backend.");
+    bReceived = false;
+#endif
+
+    UpgradeHeader header;
+    bReceived = bReceived && recvAll(hSocket, reinterpret_cast<char*>(&header), sizeof(header))
+                && header.Magic == UPGRADE_MAGIC && header.Version == UPGRADE_VERSION;
+    while (bReceived && outFds.size() < header.NumFds)
+    {
+        bReceived = recvFds(hSocket, outFds);
+    }
+
+    // The reactors of this process take the listen sockets in order.
+    bReceived = bReceived && outFds.size() == header.NumFds && header.NumListenSockets == mConfig.NumReactors && header.NumFds >= header.NumListenSockets;
+    if (bReceived)
+    {
+        outState.resize(static_cast<size_t>(header.StateLen));
+        bReceived = recvAll(hSocket, &outState[0], outState.size());
+    }
+
+    if (!bReceived)
+    {
+        logErrorCode(IRC_FAILED_TO_RESTORE_UPGRADE);
+        closeUpgradeFds(outFds, 0);
+        outFds.clear();
+        close(hSocket);
+        return IRC_FAILED_TO_RESTORE_UPGRADE;
+    }
+    return IRC_SUCCESS;
+}
+
+EIrcErrorCode Server::restoreUpgradeState(const std::vector<int>& fds, const std::vector<char>& state)
+{
+    UpgradeStateReader reader(state);
+    size_t fdIdx = mReactors.size();
+
+    const size_t numClients = reader.ReadCount();
+    for (size_t clientIdx = 0; clientIdx < numClients && fdIdx < fds.size() && !reader.IsFailed(); clientIdx++)
+    {
+        SharedPtr<ClientControlBlock> client = MakeShared<ClientControlBlock>();
+        client->hSocket = fds[fdIdx++];
+        client->ReactorIdx = static_cast<unsigned int>(reader.ReadU64() % mReactors.size());
+        ReactorControlBlock& reactor = *mReactors[client->ReactorIdx];
+
+        const std::string addr = reader.ReadString();
+        if (addr.size() == sizeof(client->Addr))
+        {
+            std::memcpy(&client->Addr, addr.data(), sizeof(client->Addr));
+        }
+        client->Nickname   = reader.ReadString();
+        client->Realname   = reader.ReadString();
+        client->Username   = reader.ReadString();
+        client->ServerPass = reader.ReadString();
+        client->bRegistered = (reader.ReadU64() != 0);
+        client->EnabledCaps     = static_cast<unsigned int>(reader.ReadU64());
+        client->bCapNegotiating = (reader.ReadU64() != 0);
+
+        client->LastActiveTime = reader.ReadU64();
+        const uint64_t deadline = reader.ReadU64();
+        client->PingSentTime        = reader.ReadU64();
+        client->RttMicrosec         = reader.ReadU64();
+        client->SmoothedRttMicrosec = reader.ReadU64();
+        client->MaxSendingQueueBytes = static_cast<size_t>(reader.ReadU64());
+        client->NumDroppedMsgs       = static_cast<size_t>(reader.ReadU64());
+        const uint64_t nextZeroCopySeq = reader.ReadU64();
+        const std::string recvBytes = reader.ReadString();
+        client->bSkippingRecvMsg    = (reader.ReadU64() != 0);
+        client->LastSkippedRecvChar = static_cast<char>(reader.ReadU64());
+        const std::string sendBytes = reader.ReadString();
+
+        // The socket is closed with the client from here.
+        if (client->bRegistered)
+        {
+            mClients[client->Nickname] = client;
+        }
+        else
+        {
+            client->UnregisteredClientIdx = mUnregistedClients.size();
+            mUnregistedClients.push_back(client);
+        }
+        mNumClients++;
+
+        client->DeadlineTimer.Owner = reinterpret_cast<void*>(client.GetControlBlock());
+        scheduleClientTimer(reactor, client, (deadline != 0) ? deadline : reactor.TickTime);
+        setupClientSocket(reactor, client);
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        client->NextZeroCopySeq = static_cast<uint32_t>(nextZeroCopySeq);
+#else
+        (void)nextZeroCopySeq;
+#endif
+
+        // Sent at the end of the first tick.
+        for (size_t offset = 0; offset < sendBytes.size(); offset += MESSAGE_LEN_MAX)
+        {
+            SharedPtr<MsgBlock> sendMsgBlock = MakeShared<MsgBlock>();
+            sendMsgBlock->MsgLen = std::min(sendBytes.size() - offset, static_cast<size_t>(MESSAGE_LEN_MAX));
+            std::memcpy(sendMsgBlock->Msg, sendBytes.data() + offset, sendMsgBlock->MsgLen);
+            client->MsgSendingQueue.push_back(sendMsgBlock);
+        }
+        client->NumSendingQueueBytes = sendBytes.size();
+        client->NumTotalQueuedBytes = sendBytes.size();
+        client->MaxSendingQueueBytes = std::max(client->MaxSendingQueueBytes, client->NumSendingQueueBytes);
+        if (!client->MsgSendingQueue.empty())
+        {
+            reactor.InlineSendClients.push_back(client);
+        }
+
+        // Processed at the first tick.
+        if (!recvBytes.empty())
+        {
+            appendRecvBytesToClient(client, recvBytes.data(), recvBytes.size());
+            client->bMsgProcessQueued = true;
+            client->MsgProcessQueuedTime = reactor.TickTime;
+            reactor.SuspendedMsgProcessQueue.push_back(client);
+            if (client->RecvMsgBlocks.size() >= NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD)
+            {
+                setClientRecvPaused(reactor, client, true);
+            }
+        }
+    }
+
+    // The channels are alive while a member is. (See ClientControlBlock::Channels)
+    const size_t numChannels = reader.ReadCount();
+    for (size_t channelIdx = 0; channelIdx < numChannels && !reader.IsFailed(); channelIdx++)
+    {
+        const std::string name     = reader.ReadString();
+        const std::string topic    = reader.ReadString();
+        const std::string password = reader.ReadString();
+        const size_t maxClients    = static_cast<size_t>(reader.ReadU64());
+        const uint64_t flags       = reader.ReadU64();
+
+        std::vector<std::string> nicknames[3]; //< Members, operators and invited clients
+        for (size_t listIdx = 0; listIdx < 3; listIdx++)
+        {
+            const size_t numNicknames = reader.ReadCount();
+            for (size_t i = 0; i < numNicknames && !reader.IsFailed(); i++)
+            {
+                nicknames[listIdx].push_back(reader.ReadString());
+            }
+        }
+
+        SharedPtr<ChannelControlBlock> channel;
+        for (size_t i = 0; i < nicknames[0].size(); i++)
+        {
+            SharedPtr<ClientControlBlock> member = findClientGlobal(nicknames[0][i]);
+            if (member == NULL)
+            {
+                continue;
+            }
+            if (channel == NULL)
+            {
+                channel = MakeShared<ChannelControlBlock>(name, member, member->Nickname);
+                channel->Operators.clear();
+            }
+            joinClientToChannel(member, channel);
+        }
+        if (channel == NULL)
+        {
+            continue;
+        }
+
+        channel->Topic           = topic;
+        channel->Password        = password;
+        channel->MaxClients      = maxClients;
+        channel->bInviteOnly     = (flags & CHANNEL_FLAG_INVITE_ONLY) != 0;
+        channel->bTopicProtected = (flags & CHANNEL_FLAG_TOPIC_PROTECTED) != 0;
+        channel->bPrivate        = (flags & CHANNEL_FLAG_PRIVATE) != 0;
+        for (size_t i = 0; i < nicknames[1].size(); i++)
+        {
+            SharedPtr<ClientControlBlock> channelOperator = channel->FindClient(nicknames[1][i]);
+            if (channelOperator != NULL)
+            {
+                channel->Operators[nicknames[1][i]] = channelOperator;
+            }
+        }
+        for (size_t i = 0; i < nicknames[2].size(); i++)
+        {
+            SharedPtr<ClientControlBlock> invitedClient = findClientGlobal(nicknames[2][i]);
+            if (invitedClient != NULL)
+            {
+                channel->InvitedClients[nicknames[2][i]] = invitedClient;
+            }
+        }
+        mChannels[name] = channel;
+    }
+
+    const int hSocket = mConfig.hUpgradeSocket;
+    if (reader.IsFailed() || fdIdx != fds.size())
+    {
+        logErrorCode(IRC_FAILED_TO_RESTORE_UPGRADE);
+        closeUpgradeFds(fds, fdIdx);
+        close(hSocket);
+        return IRC_FAILED_TO_RESTORE_UPGRADE;
+    }
+
+    // The old process closes its descriptors from the ACK.
+    const char ack = UPGRADE_ACK;
+    const bool bAcked = sendAll(hSocket, &ack, sizeof(ack));
+    close(hSocket);
+    if (!bAcked)
+    {
+        logErrorCode(IRC_FAILED_TO_RESTORE_UPGRADE);
+        return IRC_FAILED_TO_RESTORE_UPGRADE;
+    }
+
+    logMessage("Hot upgrade restored. Clients: " + ValToString(mNumClients) + ", Channels: " + ValToString(mChannels.size()));
+    return IRC_SUCCESS;
+}
+
+} // namespace IRC
@@ -10,9 +10,31 @@ enum Constants {
     SVR_PASS_MAX = 32,
     
     CLIENT_MAX = 65535,
+
+    /** @name Client deadlines in seconds (See [ \ref irc_server_client_timer ]) */
+    ///@{
+    /** A client is sent a PING after this idle time. */
     CLIENT_TIMEOUT = 60,
 
+    /** A client is disconnected if nothing is received for this after the PING. */
+    CLIENT_PING_TIMEOUT = 30,
+
+    /** A client is disconnected if it is not registered for this after the connection. */
+    CLIENT_REGISTRATION_TIMEOUT = 30,
+
+    /** An expired client is closed if it can not send the remaining messages for this. (See Server::disconnectClient()) */
+    CLIENT_DISCONNECT_TIMEOUT = 10,
+    ///@}
+
+    /** Resolution of the client timers */
+    CLIENT_TIMER_TICK_MICROSEC = 1000000,
+    MICROSEC_PER_SEC = 1000000,
+
     KEVENT_OBSERVE_MAX = 1024,
+
+    /** Max number of the clients accepted by a reactor in a tick (See [ \ref irc_server_accept ]) */
+    NUM_ACCEPT_PER_TICK_MAX = 64,
+    REACTOR_MAX = 64,
     CLIENT_RESERVE_MIN = 1024,
 
     MESSAGE_LEN_MAX = 512,
@@ -20,7 +42,59 @@ enum Constants {
     MAX_CHANNEL_NAME_LENGTH = 200,
     CRLF_LEN_2 = 2,
 
-    NUM_CLIENT_MSGBLOCK_RECV_IGNORE_THRESHOLD = 8
+    /** Max number of the items of a comma separated list in a message. Every item has a comma after it but the last. (See SplitCommaList()) */
+    NUM_LIST_ITEMS_MAX = MESSAGE_LEN_MAX / 2,
+
+    /** Max length of the client-only tags relayed with a message. The tags that do not fit are not relayed. (See ParsedMsg::CopyClientOnlyTags()) */
+    CLIENT_TAGS_LEN_MAX = 256,
+
+    /** The READ filter of a client is disabled when the received message blocks are more than this, until they are processed. */
+    NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD = 8,
+
+    /** The paused READ filter is enabled again when the received message blocks are less than or equal to this. */
+    NUM_CLIENT_MSGBLOCK_RECV_RESUME_THRESHOLD = 2,
+
+    /** @name Received message processing (See [ \ref irc_server_msg_process_scheduling ]) */
+    ///@{
+    /** Max number of the messages of a client processed in a round */
+    NUM_CLIENT_MSG_PROCESS_BUDGET = 16,
+
+    /** The messages are processed even if there are observed events, when more clients than this are waiting */
+    NUM_MSG_PROCESS_QUEUE_FORCE_THRESHOLD = 64,
+
+    /** The messages are processed even if there are observed events, when the oldest client waited longer than this */
+    MSG_PROCESS_QUEUE_DELAY_MAX_MICROSEC = 2000,
+    ///@}
+
+    /** Max number of the message blocks gathered into a writev() of a client */
+    NUM_CLIENT_SEND_IOVEC_MAX = 64,
+
+    /** The bulk lane waits while the MsgSendingQueue of the client has this or more blocks, so that a reply waits behind at most this many blocks of it. (See [ \ref irc_server_send_lanes ]) */
+    NUM_CLIENT_SEND_BULK_WINDOW = 64,
+
+    /** Max length of a reply copied into the page at the tail of the sending queue. The longer ones are queued by reference. (See [ \ref irc_server_reply_coalescing ]) */
+    COALESCED_REPLY_LEN_MAX = 256,
+
+    /** Max number of the linked send requests of a client in flight (io_uring backend) */
+    NUM_CLIENT_SEND_REQUEST_CHAIN_MAX = 16,
+
+    /** Max number of the MSG_ZEROCOPY sends of a client not notified yet. The later ones are copied. (See [ \ref irc_server_zerocopy ]) */
+    NUM_CLIENT_ZEROCOPY_SEND_MAX = 32,
+
+    /** Max of the ServerConfig::BusyPollMicrosec */
+    BUSY_POLL_MICROSEC_MAX = 100000,
+
+    /** The dispatch latency histogram of a reactor is logged and cleared every this seconds. (See [ \ref irc_server_dispatch_latency ]) */
+    LATENCY_REPORT_INTERVAL = 10,
+
+    /** @name Hot upgrade (See [ \ref irc_server_hot_upgrade ]) */
+    ///@{
+    /** The old process keeps serving if the new process does not restore the state in this seconds. */
+    UPGRADE_HANDOVER_TIMEOUT = 10,
+
+    /** Max number of the descriptors passed by a message. (Under SCM_MAX_FD of Linux) */
+    NUM_UPGRADE_FDS_PER_MSG_MAX = 200
+    ///@}
 
 };
 } // namespace IRC
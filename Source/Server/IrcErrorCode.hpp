@@ -7,6 +7,7 @@
     IRC_ERROR_CODE_X(IRC_SUCCESS                , 0, "Success")                                              \
     IRC_ERROR_CODE_X(IRC_FAILED_UNREACHABLE_CODE, 5, "Failed to reach the unreachable code")                 \
     IRC_ERROR_CODE_X(IRC_SHUTDOWN               , 6, "Shutdown")                                             \
+    IRC_ERROR_CODE_X(IRC_UPGRADE                , 7, "Hot upgrade")                                          \
                                                                                                              \
     /** @name Related CreateServer() */                                                                      \
     /**@{*/                                                                                                  \
@@ -14,6 +15,7 @@
     IRC_ERROR_CODE_X(IRC_PASSWORD_TOO_SHORT, 101, "Password is too short")                                   \
     IRC_ERROR_CODE_X(IRC_PASSWORD_TOO_LONG , 102, "Password is too long")                                    \
     IRC_ERROR_CODE_X(IRC_INVALID_PASSWORD  , 103, "Invalid password")                                        \
+    IRC_ERROR_CODE_X(IRC_INVALID_CONFIG    , 104, "Invalid server config")                                   \
     /**@}*/                                                                                                  \
                                                                                                              \
     /** @name Related SocketAPI */                                                                           \
@@ -40,6 +42,18 @@
     IRC_ERROR_CODE_X(IRC_FAILED_TO_OBSERVE_KEVENT , 304, "Failed to observe kevent")                         \
     IRC_ERROR_CODE_X(IRC_ERROR_LISTEN_SOCKET_EVENT, 305, "Listen socket event error")                        \
     IRC_ERROR_CODE_X(IRC_ERROR_CLIENT_SOCKET_EVENT, 306, "Client socket event error")                        \
+    /**@}*/                                                                                                  \
+                                                                                                             \
+    /** @name Related reactor threads */                                                                     \
+    /**@{*/                                                                                                  \
+    IRC_ERROR_CODE_X(IRC_FAILED_TO_CREATE_THREAD  , 400, "Failed to create reactor thread")                  \
+    IRC_ERROR_CODE_X(IRC_FAILED_TO_CREATE_WAKEUP  , 401, "Failed to create reactor wakeup socket")           \
+    /**@}*/                                                                                                  \
+                                                                                                             \
+    /** @name Related hot upgrade */                                                                         \
+    /**@{*/                                                                                                  \
+    IRC_ERROR_CODE_X(IRC_FAILED_TO_UPGRADE        , 500, "Failed to hand over to the new process")           \
+    IRC_ERROR_CODE_X(IRC_FAILED_TO_RESTORE_UPGRADE, 501, "Failed to restore from the old process")           \
     /**@}*/
 
 namespace IRC
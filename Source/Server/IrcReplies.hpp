@@ -24,6 +24,8 @@ namespace IRC
     IRC_REPLY_X(ERR_TOOMANYCHANNELS , 405, (PARM_X, const std::string channel_name), (channel_name + " :You have joined too many channels"))                                                                                \
     IRC_REPLY_X(ERR_WASNOSUCHNICK   , 406, (PARM_X, const std::string nickname), (nickname + " :There was no such nickname"))                                                                                               \
     IRC_REPLY_X(ERR_TOOMANYTARGETS  , 407, (PARM_X, const std::string target), (target + " :Duplicate recipients. No message delivered"))                                                                                   \
+    IRC_REPLY_X(ERR_NOORIGIN        , 409, (PARM_X), (":No origin specified"))                                                                                                                                              \
+    IRC_REPLY_X(ERR_INVALIDCAPCMD   , 410, (PARM_X, const std::string subcommand), (subcommand + " :Invalid CAP command"))                                                                                                  \
     IRC_REPLY_X(ERR_UNKNOWNCOMMAND  , 421, (PARM_X, const std::string command), (command + " :Unknown command"))                                                                                                            \
     IRC_REPLY_X(ERR_NONICKNAMEGIVEN , 431, (PARM_X), (":No nickname given"))                                                                                                                                                \
     IRC_REPLY_X(ERR_NICKNAMEINUSE   , 433, (PARM_X, const std::string nickname), (nickname + " :Nickname is already in use"))                                                                                               \
@@ -38,6 +40,7 @@ namespace IRC
     IRC_REPLY_X(ERR_BADCHANMASK     , 476, (PARM_X, const std::string channel_name), (channel_name + " :Bad Channel Mask"))                                                                                                 \
     IRC_REPLY_X(ERR_UNKNOWNMODE     , 472, (PARM_X, const char mode), (std::string(1, mode) + " :is unknown mode char to me"))                                                                                              \
     IRC_REPLY_X(ERR_CHANOPRIVSNEEDED, 482, (PARM_X, const std::string channel_name), (channel_name + " :You're not channel operator"))                                                                                      \
+    IRC_REPLY_X(ERR_INVALIDKEY      , 525, (PARM_X, const std::string channel_name), (channel_name + " :Key is not well-formed"))                                                                                           \
     IRC_REPLY_X(ERR_NORECIPIENT     , 411, (PARM_X, const std::string command), (":No recipient given (" + command + ")"))                                                                                                  \
     IRC_REPLY_X(ERR_NOTEXTTOSEND    , 412, (PARM_X), (":No text to send"))                                                                                                                                                  \
     IRC_REPLY_X(ERR_NOTONCHANNEL    , 442, (PARM_X, const std::string channel_name), (channel_name + " :You're not on that channel"))                                                                                       \
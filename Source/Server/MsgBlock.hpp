@@ -53,4 +53,37 @@ public:
     }
 };
 
+/** A received message in a message block, without the CR-LF. (See [ \ref irc_server_line_split ])
+ *
+ * @details The Block is the receive block of the client that contains the whole message, or a copy if the message straddles two blocks.
+ *          The message is already consumed from the receive queue, so it can be tokenized in place.
+ *          The CR-LF follows the message in the same block, so there is a room for the NULL terminator at GetMsg()[Len].
+ */
+struct MsgView
+{
+public:
+    SharedPtr<MsgBlock> Block;
+    size_t Offset;
+    size_t Len;
+
+    FORCEINLINE MsgView()
+        : Block()
+        , Offset(0)
+        , Len(0)
+    {
+    }
+
+    FORCEINLINE MsgView(SharedPtr<MsgBlock> block, const size_t offset, const size_t len)
+        : Block(block)
+        , Offset(offset)
+        , Len(len)
+    {
+    }
+
+    FORCEINLINE char* GetMsg() const
+    {
+        return Block->Msg + Offset;
+    }
+};
+
 } // namespace IRC
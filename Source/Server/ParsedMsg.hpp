@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstring>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+namespace IRC
+{
+
+/** A client message split into its parts in place. (See [ \ref irc_server_parsed_msg ])
+ *
+ *  @details    Every part is a NULL terminated view into the received message, so the parsing does not allocate.
+ *              Syntax: ['@' <tags> ' '] [':' <source> ' '] <command> {' ' <middle>} [' ' ':' <trailing>]
+ *              The tags are the IRCv3 message tags, "key[=value]" separated by ';' and still escaped.
+ *              As in RFC 2812, the 15th parameter takes the rest of the message even if it does not start with ':'.
+ */
+struct ParsedMsg
+{
+public:
+    enum { NUM_PARAMS_MAX = 15 };
+
+    /** The tags without the '@', or NULL. */
+    char* Tags;
+
+    /** The source(prefix) without the ':', or NULL. */
+    char* Source;
+
+    char* Command;
+
+    /** Parameters, and the trailing parameter without the ':' at the last if bHasTrailing. */
+    char* Params[NUM_PARAMS_MAX];
+    size_t NumParams;
+
+    /** The last parameter is a trailing parameter. It can be empty or contain spaces. */
+    bool bHasTrailing;
+
+    /** Parse the message in place.
+     *
+     *  @param msgStr   The message without CR-LF. The spaces between the parts are replaced with NULL characters.
+     *  @param msgLen   Length of the message. msgStr[msgLen] is set to the NULL character, so it must be writable.
+     *  @return         false if there is no command in the message.
+     */
+    bool Parse(char* msgStr, const size_t msgLen)
+    {
+        Tags = NULL;
+        Source = NULL;
+        Command = NULL;
+        NumParams = 0;
+        bHasTrailing = false;
+
+        msgStr[msgLen] = '\0';
+        char* p = skipSpaces(msgStr);
+        if (*p == '@')
+        {
+            Tags = p + 1;
+            p = skipSpaces(terminateToken(p));
+        }
+        if (*p == ':')
+        {
+            Source = p + 1;
+            p = skipSpaces(terminateToken(p));
+        }
+        if (*p == '\0')
+        {
+            return false;
+        }
+        Command = p;
+        p = terminateToken(p);
+
+        for (p = skipSpaces(p); *p != '\0'; p = skipSpaces(p))
+        {
+            if (*p == ':')
+            {
+                Params[NumParams++] = p + 1;
+                bHasTrailing = true;
+                break;
+            }
+            else if (NumParams == NUM_PARAMS_MAX - 1)
+            {
+                Params[NumParams++] = p;
+                bHasTrailing = true;
+                break;
+            }
+            Params[NumParams++] = p;
+            p = terminateToken(p);
+        }
+        return true;
+    }
+
+    /** Copy the client-only tags, the tags of the key starting with '+', to relay them.
+     *
+     *  @param outTags      [out] Buffer to receive the NULL terminated tags separated by ';'.
+     *  @param outTagsSize  Size of the buffer. The tags that do not fit are not copied.
+     *  @return             Length of the copied tags, 0 if there is none.
+     */
+    size_t CopyClientOnlyTags(char* outTags, const size_t outTagsSize) const
+    {
+        Assert(outTagsSize > 0);
+        size_t outTagsLen = 0;
+        outTags[0] = '\0';
+        if (Tags == NULL)
+        {
+            return 0;
+        }
+
+        const char* tag = Tags;
+        while (*tag != '\0')
+        {
+            size_t tagLen = 0;
+            for (; tag[tagLen] != '\0' && tag[tagLen] != ';'; tagLen++)
+            {
+            }
+
+            const size_t separatorLen = (outTagsLen > 0) ? 1 : 0;
+            if (tag[0] == '+' && tagLen > 1 && outTagsLen + separatorLen + tagLen < outTagsSize)
+            {
+                if (separatorLen > 0)
+                {
+                    outTags[outTagsLen++] = ';';
+                }
+                std::memcpy(outTags + outTagsLen, tag, tagLen);
+                outTagsLen += tagLen;
+                outTags[outTagsLen] = '\0';
+            }
+
+            tag += (tag[tagLen] == ';') ? tagLen + 1 : tagLen;
+        }
+        return outTagsLen;
+    }
+
+private:
+    static FORCEINLINE char* skipSpaces(char* p)
+    {
+        for (; *p == ' '; p++)
+        {
+        }
+        return p;
+    }
+
+    /** Terminate the token at p, and return the next of it. */
+    static FORCEINLINE char* terminateToken(char* p)
+    {
+        for (; *p != ' ' && *p != '\0'; p++)
+        {
+        }
+        if (*p == ' ')
+        {
+            *p++ = '\0';
+        }
+        return p;
+    }
+};
+
+} // namespace IRC
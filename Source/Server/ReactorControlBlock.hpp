@@ -0,0 +1,345 @@
+#pragma once
+
+#include <vector>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+#include "Network/EventQueue.hpp"
+#include "Network/TcpOption.hpp"
+#include "Server/IrcConstants.hpp"
+#include "Server/IrcErrorCode.hpp"
+#include "Server/MsgBlock.hpp"
+#include "Server/ClientControlBlock.hpp"
+
+namespace IRC
+{
+
+class Server;
+
+/** Control block of an event loop thread. (Reactor)
+ *
+ * @details Each reactor has its own listen socket, event queue and the clients accepted by it.
+ *          Only the reactor of a client does the I/O and modifies the receive/send state of the client. (See ClientControlBlock::ReactorIdx)
+ *          The other reactors can only add messages to the sending queue of the client.
+ *
+ *          The fields are accessed with the Server::mStateLock, except the ones noted as reactor-only.
+ *
+ * @see     [ \ref irc_server_multi_reactor ]
+ */
+class ReactorControlBlock
+{
+public:
+    /** A writev() to do without the lock. The iovecs are SendIovecs[IovecIdx, IovecIdx + NumIovecs). */
+    struct PendingSend
+    {
+        SharedPtr<ClientControlBlock> Client;
+        size_t IovecIdx;
+        size_t NumIovecs;
+        size_t NumBytes;
+        ssize_t nSentBytes;
+
+        /** Send with MSG_ZEROCOPY instead of writev(). Cleared if the kernel could not. (See [ \ref irc_server_zerocopy ]) */
+        bool bZeroCopy;
+    };
+
+    unsigned int Idx;
+
+    Server* OwnerServer;
+
+    /** Thread running the event loop. The first reactor runs on the thread called Server::Startup(). */
+    pthread_t hThread;
+
+    int hListenSocket;
+
+    /** The listen socket is disabled at the client limit or out of descriptors. (See Server::suspendListening()) */
+    bool bListenSuspended;
+
+    /** @name Event queue
+     *  @see  Server::getClientFromEventUdata()
+     */
+    ///@{
+    EventQueue Events;
+
+    /** Registrations to apply at the next Wait(). The other reactors add to it when they send a message to the client of this reactor.
+     *  The registrations of a client are added by Server::queueClientEvent(), and a canceled one is left with the flags 0 until the Wait().
+     */
+    std::vector<EventQueue::Event> EventRegistrationQueue;
+
+    /** Number of the canceled registrations in the EventRegistrationQueue. */
+    size_t NumCanceledRegistrations;
+
+    /** Registrations passed to the running Wait(). Swapped with the EventRegistrationQueue before the Wait(). (reactor-only) */
+    std::vector<EventQueue::Event> EventChangeList;
+
+    /** (reactor-only) */
+    std::vector<EventQueue::Event> ObservedEvents;
+    ///@}
+
+    /** Monotonic time (microseconds) read once after each Wait(). The clock of the tick instead of reading the time for each use. */
+    uint64_t TickTime;
+
+    /** @name Client timers
+     *  @see [ \ref irc_server_client_timer ]
+     */
+    ///@{
+    /** Deadlines of the clients of this reactor in CLIENT_TIMER_TICK_MICROSEC ticks. */
+    TimerWheel ClientTimers;
+
+    /** Owners of the timers expired in a tick. (reactor-only) */
+    std::vector<void*> ExpiredClientTimers;
+    ///@}
+
+    /** Socket pair to wake up the reactor blocking in Wait(). [0] is registered to the event queue, [1] is written by the other reactors.
+     *  @see Server::wakeupReactor()
+     */
+    int hWakeupSockets[2];
+    bool bWakeupPending;
+
+    /** Clients of this reactor whose sending queue became non-empty in this tick. They are sent at the end of the tick.
+     *  The other reactors add to it when they send a message to the client of this reactor.
+     *  @see Server::sendMsgToClient()
+     */
+    std::vector< SharedPtr< ClientControlBlock > > InlineSendClients;
+
+    /** Queue to release the expired clients of this reactor.
+     *  @see ClientDisconnection section in IRC::Server class
+     */
+    std::vector< SharedPtr< ClientControlBlock > > ClientReleaseQueue;
+
+    /** Message processing queue kept while the event loop is stopped for the hot upgrade, and taken back when it starts.
+     *  The restored clients with the received messages are added to it by the new process. (See [ \ref irc_server_hot_upgrade ])
+     */
+    std::vector< SharedPtr< ClientControlBlock > > SuspendedMsgProcessQueue;
+
+    /** @name I/O without the lock (reactor-only) */
+    ///@{
+    /** Bytes received for the observed events of a tick, except the ones received into the last block of the client. Grows to the receive budgets of the events. */
+    std::vector<char> RecvScratch;
+
+    /** Offset in the RecvScratch of each observed event. */
+    std::vector<size_t> RecvScratchOffset;
+
+    /** Received bytes of each observed event, 0 on close, -1 on error, or RECV_SKIPPED. */
+    std::vector<ssize_t> RecvScratchLen;
+
+    /** Leading bytes of the RecvScratchLen received in place into the free space of the last receive block of the client. The rest is in the RecvScratch. */
+    std::vector<size_t> RecvTailLen;
+
+    std::vector<PendingSend> PendingSends;
+
+    /** Gathered message blocks of the PendingSends. */
+    std::vector<struct iovec> SendIovecs;
+
+    /** Keep the gathered message blocks alive until the result is committed. */
+    std::vector< SharedPtr<MsgBlock> > SendMsgBlockRefs;
+
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+    /** Kernel receive time (system time nanoseconds) of each observed event, or 0. Only with ServerConfig::bLatencyHistogram. */
+    std::vector<uint64_t> RecvTimestamps;
+#endif
+    ///@}
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    /** Message blocks of the MSG_ZEROCOPY sends of the closed clients. The kernel can still read them for the data not acknowledged.
+     *  [0] is moved to [1] and [1] is released every CLIENT_DISCONNECT_TIMEOUT seconds. (See [ \ref irc_server_zerocopy ])
+     */
+    std::vector< SharedPtr<MsgBlock> > LingeringZeroCopyMsgBlocks[2];
+    uint64_t LingeringZeroCopyRotateTime;
+#endif
+
+    /** @name Send statistics
+     *  The number of the send calls saved by gathering is NumSentMsgBlocks - NumSendCalls. (Logged when the reactor stops)
+     */
+    ///@{
+    uint64_t NumSendCalls;
+    uint64_t NumSentMsgBlocks;
+
+    /** Send calls with MSG_ZEROCOPY, the ones the kernel copied anyway, and the ones copied by ENOBUFS. */
+    uint64_t NumZeroCopySends;
+    uint64_t NumZeroCopyCopiedSends;
+    uint64_t NumZeroCopyFallbacks;
+    ///@}
+
+    /** @name Send lane statistics
+     *  The wait time is from when a sampled message is queued to when its last byte is sent. (Logged when the reactor stops)
+     *  @see [ \ref irc_server_send_lanes ]
+     */
+    ///@{
+    uint64_t NumLaneMsgs[NUM_SEND_LANES];
+
+    /** Channel messages that waited in the ClientControlBlock::BulkMsgQueue behind the long MsgSendingQueue. */
+    uint64_t NumDeferredBulkMsgs;
+
+    /** High-water mark of the MsgSendingQueue blocks, and of the BulkMsgQueue messages, of a client. */
+    size_t LaneDepthMax[NUM_SEND_LANES];
+
+    /** Messages sampled for the wait time. At most one of each lane of a client is sampled at a time. */
+    uint64_t NumLaneWaitSamples[NUM_SEND_LANES];
+
+    uint64_t LaneWaitSumMicrosec[NUM_SEND_LANES];
+    uint64_t LaneWaitMaxMicrosec[NUM_SEND_LANES];
+    ///@}
+
+    /** @name Event statistics
+     *  Entries of the EventRegistrationQueue passed to Wait(), and the number of Wait(). (Logged when the reactor stops)
+     */
+    ///@{
+    uint64_t NumTicks;
+    uint64_t NumRegistrations;
+
+    /** Registrations that are not passed to Wait() by the coalescing. (See [ \ref irc_server_registration_coalescing ]) */
+    uint64_t NumCoalescedRegistrations;
+    ///@}
+
+    /** @name Accept statistics (Logged when the reactor stops) */
+    ///@{
+    uint64_t NumAcceptedClients;
+
+    /** Connections closed right after the accept, at the client limit or out of descriptors. */
+    uint64_t NumShedConnections;
+    uint64_t NumListenSuspensions;
+    ///@}
+
+    /** @name Timer statistics (Logged when the reactor stops) */
+    ///@{
+    uint64_t NumExpiredTimers;
+    uint64_t NumSentPings;
+
+    /** Clients disconnected by the registration, PING or disconnection deadline. */
+    uint64_t NumTimedOutClients;
+    ///@}
+
+    /** @name Wakeup latency (See [ \ref irc_server_dispatch_latency ]) */
+    ///@{
+    /** Microseconds from the kernel receive time to the dispatch of the READ events. Logged and cleared every LATENCY_REPORT_INTERVAL. */
+    LatencyHistogram DispatchLatency;
+    uint64_t LatencyReportTime;
+
+    /** Ticks that spun before blocking, and the ones that observed the events while spinning. */
+    uint64_t NumBusyPolls;
+    uint64_t NumBusyPollHits;
+    ///@}
+
+    /** @name Receive statistics (Logged when the reactor stops) */
+    ///@{
+    /** Number of the times the READ filter of a client is paused by the receive backpressure or the disconnection. */
+    uint64_t NumRecvPauses;
+
+    /** readv() calls of the epoll/kqueue backends, and the bytes received by them. (See [ \ref irc_server_recv_readv ]) */
+    uint64_t NumRecvCalls;
+    uint64_t NumRecvBytes;
+    ///@}
+
+    /** @name Message processing statistics
+     *  The queueing delay is from when a client is added to the message processing queue to when it is processed. (Logged when the reactor stops)
+     *  @see [ \ref irc_server_msg_process_scheduling ]
+     */
+    ///@{
+    uint64_t NumProcessedMsgs;
+
+    /** Processed messages copied into a new block, because they straddle two receive blocks. The others are processed in place. (See [ \ref irc_server_line_split ]) */
+    uint64_t NumCopiedMsgs;
+
+    uint64_t NumMsgProcessRounds;
+
+    /** Rounds processed before the observed events are all handled, by the queue size or delay limit. */
+    uint64_t NumForcedMsgProcessRounds;
+
+    uint64_t MsgProcessDelaySumMicrosec;
+    uint64_t MsgProcessDelayMaxMicrosec;
+    ///@}
+
+    /** Result of the event loop. Read by Server::Startup() after the thread is joined. */
+    EIrcErrorCode Result;
+
+    enum { RECV_SKIPPED = -2 };
+
+    FORCEINLINE ReactorControlBlock(const unsigned int idx, Server* ownerServer)
+        : Idx(idx)
+        , OwnerServer(ownerServer)
+        , hThread()
+        , hListenSocket(-1)
+        , bListenSuspended(false)
+        , Events()
+        , EventRegistrationQueue()
+        , NumCanceledRegistrations(0)
+        , EventChangeList()
+        , ObservedEvents(KEVENT_OBSERVE_MAX)
+        , TickTime(GetMonotonicMicrosec())
+        , ClientTimers(TickTime / CLIENT_TIMER_TICK_MICROSEC)
+        , ExpiredClientTimers()
+        , bWakeupPending(false)
+        , InlineSendClients()
+        , ClientReleaseQueue()
+        , SuspendedMsgProcessQueue()
+        , RecvScratch(KEVENT_OBSERVE_MAX * MESSAGE_LEN_MAX)
+        , RecvScratchOffset(KEVENT_OBSERVE_MAX)
+        , RecvScratchLen(KEVENT_OBSERVE_MAX)
+        , RecvTailLen(KEVENT_OBSERVE_MAX)
+        , PendingSends()
+        , SendIovecs()
+        , SendMsgBlockRefs()
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+        , RecvTimestamps(KEVENT_OBSERVE_MAX)
+#endif
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        , LingeringZeroCopyRotateTime(0)
+#endif
+        , NumSendCalls(0)
+        , NumSentMsgBlocks(0)
+        , NumZeroCopySends(0)
+        , NumZeroCopyCopiedSends(0)
+        , NumZeroCopyFallbacks(0)
+        , NumDeferredBulkMsgs(0)
+        , NumTicks(0)
+        , NumRegistrations(0)
+        , NumCoalescedRegistrations(0)
+        , NumAcceptedClients(0)
+        , NumShedConnections(0)
+        , NumListenSuspensions(0)
+        , NumExpiredTimers(0)
+        , NumSentPings(0)
+        , NumTimedOutClients(0)
+        , DispatchLatency()
+        , LatencyReportTime(TickTime + LATENCY_REPORT_INTERVAL * static_cast<uint64_t>(MICROSEC_PER_SEC))
+        , NumBusyPolls(0)
+        , NumBusyPollHits(0)
+        , NumRecvPauses(0)
+        , NumRecvCalls(0)
+        , NumRecvBytes(0)
+        , NumProcessedMsgs(0)
+        , NumCopiedMsgs(0)
+        , NumMsgProcessRounds(0)
+        , NumForcedMsgProcessRounds(0)
+        , MsgProcessDelaySumMicrosec(0)
+        , MsgProcessDelayMaxMicrosec(0)
+        , Result(IRC_SUCCESS)
+    {
+        hWakeupSockets[0] = -1;
+        hWakeupSockets[1] = -1;
+        for (int lane = 0; lane < NUM_SEND_LANES; lane++)
+        {
+            NumLaneMsgs[lane] = 0;
+            LaneDepthMax[lane] = 0;
+            NumLaneWaitSamples[lane] = 0;
+            LaneWaitSumMicrosec[lane] = 0;
+            LaneWaitMaxMicrosec[lane] = 0;
+        }
+        EventRegistrationQueue.reserve(CLIENT_RESERVE_MIN);
+        EventChangeList.reserve(CLIENT_RESERVE_MIN);
+        PendingSends.reserve(KEVENT_OBSERVE_MAX);
+        SendIovecs.reserve(KEVENT_OBSERVE_MAX);
+        SendMsgBlockRefs.reserve(KEVENT_OBSERVE_MAX);
+        ExpiredClientTimers.reserve(CLIENT_RESERVE_MIN);
+    }
+
+private:
+    /** @warning Copy is not allowed. */
+    ReactorControlBlock(const ReactorControlBlock& rhs);
+    ReactorControlBlock& operator=(const ReactorControlBlock& rhs);
+};
+
+} // namespace IRC
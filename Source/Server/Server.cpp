@@ -1,15 +1,30 @@
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 
 #include "Server/Server.hpp"
 #include "Network/TcpIpDefines.hpp"
 #include "Network/Utils.hpp"
+#include "Network/TcpOption.hpp"
 #include "Server.hpp"
 
 namespace IRC
 {
+const ClientCommandTable<Server::ClientCommandFuncPtr> Server::mClientCommandTable = Server::makeClientCommandTable();
+
+ClientCommandTable<Server::ClientCommandFuncPtr> Server::makeClientCommandTable()
+{
+    ClientCommandTable<ClientCommandFuncPtr> table;
+#define IRC_CLIENT_COMMAND_X(command_name) table.Add(#command_name, &Server::executeClientCommand_##command_name);
+    IRC_CLIENT_COMMAND_LIST
+#undef  IRC_CLIENT_COMMAND_X
+    return table;
+}
+
 Server::~Server()
 {
     destroyResources();
+    pthread_mutex_destroy(&mStateLock);
 }
 
 Server& Server::operator=(UNUSED const Server& rhs)
@@ -18,7 +33,7 @@ Server& Server::operator=(UNUSED const Server& rhs)
     return *this;
 }
 
-EIrcErrorCode Server::CreateServer(Server** outPtrServer, const std::string& serverName, const unsigned short port, const std::string& password)
+EIrcErrorCode Server::CreateServer(Server** outPtrServer, const std::string& serverName, const unsigned short port, const std::string& password, const ServerConfig& config)
 {
     Assert(outPtrServer != NULL);
     *outPtrServer = NULL;
@@ -36,143 +51,627 @@ EIrcErrorCode Server::CreateServer(Server** outPtrServer, const std::string& ser
     {
         return IRC_PASSWORD_TOO_LONG;
     }
+    else if (config.NumReactors < 1 || config.NumReactors > IRC::REACTOR_MAX)
+    {
+        return IRC_INVALID_CONFIG;
+    }
+    else if (config.MaxClients < 1 || config.MaxClients > IRC::CLIENT_MAX)
+    {
+        return IRC_INVALID_CONFIG;
+    }
+    else if (config.SendQueueLimit != 0 && config.SendQueueLimit < IRC::MESSAGE_LEN_MAX)
+    {
+        return IRC_INVALID_CONFIG;
+    }
+    else if (config.ZeroCopyThreshold != 0 && config.ZeroCopyThreshold < IRC::MESSAGE_LEN_MAX)
+    {
+        return IRC_INVALID_CONFIG;
+    }
+    else if (config.BusyPollMicrosec > IRC::BUSY_POLL_MICROSEC_MAX)
+    {
+        return IRC_INVALID_CONFIG;
+    }
 
-    *outPtrServer = new Server(serverName, port, password);
+    *outPtrServer = new Server(serverName, port, password, config);
     return IRC_SUCCESS;
 }
 
-Server::Server(const std::string& serverName, const unsigned short port, const std::string& password)
+Server::Server(const std::string& serverName, const unsigned short port, const std::string& password, const ServerConfig& config)
     : mServerName(serverName)
     , mServerPort(port)
     , mServerPassword(password)
-    , mhListenSocket(-1)
-    , mhKqueue(-1)
+    , mConfig(config)
+    , mReactors()
+    , mLockedTickTime(0)
+    , mbShutdown(false)
+    , mNumClients(0)
+    , mhReserveFd(-1)
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    , mHandedOverZeroCopyMsgBlocks()
+#endif
 {
-    mEventRegistrationQueue.reserve(CLIENT_MAX);
+    pthread_mutex_init(&mStateLock, NULL);
+    mReactors.reserve(mConfig.NumReactors);
 }
 
 EIrcErrorCode Server::Startup()
 {
-    logMessage("Server started. Port: " + ValToString(mServerPort) + ", Password: " + mServerPassword);
+    logMessage("Server started. Port: " + ValToString(mServerPort) + ", Password: " + mServerPassword + ", Event backend: " + EventQueue::GetBackendName() + ", Reactors: " + ValToString(mConfig.NumReactors) + ", Max clients: " + ValToString(mConfig.MaxClients)
+               + ", Trigger: " + (mConfig.bEdgeTriggered ? "edge" : "level") + ", SendQ: " + ValToString(mConfig.SendQueueLimit)
+               + (mConfig.SendQueuePolicy == SENDQ_POLICY_DROP_CHANNEL_MSG ? " (drop-channel)" : " (disconnect)")
+               + ", Zero-copy threshold: " + ValToString(mConfig.ZeroCopyThreshold) + ", TCP_NODELAY: " + (mConfig.bTcpNoDelay ? "on" : "off")
+               + ", Busy poll(us): " + ValToString(mConfig.BusyPollMicrosec) + ", Reply coalescing: " + (mConfig.bCoalesceReplies ? "on" : "off"));
+#if !defined(IRC_ZEROCOPY_SUPPORTED)
+    if (mConfig.ZeroCopyThreshold != 0)
+    {
+        logMessage("MSG_ZEROCOPY is not supported by this build. The sends are copied.");
+    }
+#endif
+#if !defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+    if (mConfig.bLatencyHistogram)
+    {
+        logMessage("Receive timestamps are not supported by this build. The latency histogram is empty.");
+    }
+#endif
+
+    mbShutdown = false;
+
+    // Reserve a descriptor to shed a connection when the descriptors run out. (See shedPendingConnection())
+    mhReserveFd = open("/dev/null", O_RDONLY);
+
+    // The listen sockets and the clients of the old process. (See [ \ref irc_server_hot_upgrade ])
+    std::vector<int> upgradeFds;
+    std::vector<char> upgradeState;
+    if (mConfig.hUpgradeSocket != -1)
+    {
+        EIrcErrorCode err = receiveUpgradeState(upgradeFds, upgradeState);
+        if (UNLIKELY(err != IRC_SUCCESS))
+        {
+            destroyResources();
+            return err;
+        }
+    }
+
+    for (unsigned int reactorIdx = 0; reactorIdx < mConfig.NumReactors; reactorIdx++)
+    {
+        mReactors.push_back(new ReactorControlBlock(reactorIdx, this));
+        if (!upgradeFds.empty())
+        {
+            mReactors.back()->hListenSocket = upgradeFds[reactorIdx];
+        }
+        EIrcErrorCode err = createReactorResources(*mReactors.back());
+        if (UNLIKELY(err != IRC_SUCCESS))
+        {
+            closeUpgradeFds(upgradeFds, reactorIdx + 1);
+            destroyResources();
+            return err;
+        }
+    }
+
+    if (mConfig.hUpgradeSocket != -1)
+    {
+        EIrcErrorCode err = restoreUpgradeState(upgradeFds, upgradeState);
+        if (UNLIKELY(err != IRC_SUCCESS))
+        {
+            destroyResources();
+            return err;
+        }
+    }
+
+    EIrcErrorCode result = runReactors();
+
+    // Hand over to the new process, or keep serving if it failed.
+    while (result == IRC_UPGRADE)
+    {
+        mbUpgradeRequested = 0;
+        result = handOverToNewProcess();
+        if (result == IRC_SUCCESS)
+        {
+            break;
+        }
+
+        logErrorCode(result);
+        mbShutdown = false;
+        result = runReactors();
+    }
+
+    // Destroy resources even after the event loop is successfully, so that a server can be restarted.
+    // if (UNLIKELY(result != IRC_SUCCESS))
+    {
+        destroyResources();
+    }
+
+    return result;
+}
+
+EIrcErrorCode Server::runReactors()
+{
+    // Start the event loops. The first reactor runs on this thread.
+    // The reactor threads wait for the lock until all threads are created, so that hThread of every reactor is valid in the event loops.
+    EIrcErrorCode result = IRC_SUCCESS;
+    unsigned int numStartedThreads = 0;
+    pthread_mutex_lock(&mStateLock);
+    mReactors[0]->hThread = pthread_self();
+
+    // The signal handler wakes up the reactors from here. (See RequestUpgrade())
+    for (unsigned int reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        mhUpgradeWakeupSockets[reactorIdx] = mReactors[reactorIdx]->hWakeupSockets[1];
+    }
+    mNumUpgradeWakeupSockets = static_cast<sig_atomic_t>(mReactors.size());
+
+    for (unsigned int reactorIdx = 1; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        if (UNLIKELY(pthread_create(&mReactors[reactorIdx]->hThread, NULL, reactorThreadMain, mReactors[reactorIdx]) != 0))
+        {
+            logErrorCode(IRC_FAILED_TO_CREATE_THREAD);
+            result = IRC_FAILED_TO_CREATE_THREAD;
+            mbShutdown = true;
+            break;
+        }
+        numStartedThreads++;
+    }
+    pthread_mutex_unlock(&mStateLock);
+
+    if (result == IRC_SUCCESS)
+    {
+        result = runReactor(*mReactors[0]);
+    }
+
+    for (unsigned int reactorIdx = 1; reactorIdx <= numStartedThreads; reactorIdx++)
+    {
+        pthread_join(mReactors[reactorIdx]->hThread, NULL);
+
+        // Report the first error that terminated the server.
+        if (result == IRC_SHUTDOWN)
+        {
+            result = mReactors[reactorIdx]->Result;
+        }
+    }
+    mNumUpgradeWakeupSockets = 0;
+
+    return result;
+}
+
+EIrcErrorCode Server::createReactorResources(ReactorControlBlock& reactor)
+{
+    // The listen socket handed over by the old process is already bound and listening. (See [ \ref irc_server_hot_upgrade ])
+    if (reactor.hListenSocket != -1)
+    {
+        return createReactorEvents(reactor);
+    }
 
     // Create listen socket as non-blocking and bind to the port
-    mhListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (mhListenSocket == -1)
+    reactor.hListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (reactor.hListenSocket == -1)
     {
         return IRC_FAILED_TO_CREATE_SOCKET;
     }
 
+    // Each reactor listens to the same port, and the kernel distributes the connections.
+    if (mConfig.NumReactors > 1)
+    {
+        const int optReusePort = 1;
+        if (setsockopt(reactor.hListenSocket, SOL_SOCKET, SO_REUSEPORT, &optReusePort, sizeof(optReusePort)) == -1)
+        {
+            return IRC_FAILED_TO_SETSOCKOPT_SOCKET;
+        }
+    }
+
     struct sockaddr_in severAddr;
     std::memset(&severAddr, 0, sizeof(severAddr));
     severAddr.sin_family      = AF_INET;
     severAddr.sin_addr.s_addr = htonl(INADDR_ANY);
     severAddr.sin_port        = htons(mServerPort);
-    if (bind(mhListenSocket, reinterpret_cast<struct sockaddr*>(&severAddr), sizeof(severAddr)) == -1)
+    if (bind(reactor.hListenSocket, reinterpret_cast<struct sockaddr*>(&severAddr), sizeof(severAddr)) == -1)
     {
-        destroyResources();
         return IRC_FAILED_TO_BIND_SOCKET;
     }
 
-    if (listen(mhListenSocket, SOMAXCONN) == -1)
+    if (listen(reactor.hListenSocket, SOMAXCONN) == -1)
     {
-        destroyResources();
         return IRC_FAILED_TO_LISTEN_SOCKET;
     }
 
-    if (fcntl(mhListenSocket, F_SETFL, O_NONBLOCK) == -1)
+    if (fcntl(reactor.hListenSocket, F_SETFL, O_NONBLOCK) == -1)
     {
-        destroyResources();
         return IRC_FAILED_TO_SETSOCKOPT_SOCKET;
     }
-    
-    // Init kqueue and register listen socket
-    mhKqueue = kqueue();
-    if (mhKqueue == -1)
+
+    return createReactorEvents(reactor);
+}
+
+EIrcErrorCode Server::createReactorEvents(ReactorControlBlock& reactor)
+{
+    // Wakeup sockets to interrupt the Wait() of the reactor
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, reactor.hWakeupSockets) == -1)
+    {
+        return IRC_FAILED_TO_CREATE_WAKEUP;
+    }
+    if (fcntl(reactor.hWakeupSockets[0], F_SETFL, O_NONBLOCK) == -1 || fcntl(reactor.hWakeupSockets[1], F_SETFL, O_NONBLOCK) == -1)
+    {
+        return IRC_FAILED_TO_SETSOCKOPT_SOCKET;
+    }
+
+    // Init event queue and register listen socket and wakeup socket
+    if (reactor.Events.Create() == false)
     {
-        destroyResources();
         return IRC_FAILED_TO_CREATE_KQUEUE;
     }
 
-    kevent_t evListen;
-    std::memset(&evListen, 0, sizeof(evListen));
-    evListen.ident  = mhListenSocket;
-    evListen.filter = EVFILT_READ;
-    evListen.flags  = EV_ADD;
-    if (kevent(mhKqueue, &evListen, 1, NULL, 0, NULL) == -1)
+    EventQueue::Event evReactor[2];
+    EventQueue::SetEvent(evReactor[0], reactor.hListenSocket, EventQueue::FILTER_ACCEPT, EventQueue::FLAG_ADD, NULL);
+    EventQueue::SetEvent(evReactor[1], reactor.hWakeupSockets[0], EventQueue::FILTER_READ, EventQueue::FLAG_ADD, NULL);
+    if (reactor.Events.Wait(evReactor, 2, NULL, 0, NULL) == -1)
     {
-        destroyResources();
         return IRC_FAILED_TO_ADD_KEVENT;
     }
 
-    // Start the event loop
-    EIrcErrorCode result = eventLoop();
+    return IRC_SUCCESS;
+}
+
+void* Server::reactorThreadMain(void* reactor)
+{
+    ReactorControlBlock* currReactor = static_cast<ReactorControlBlock*>(reactor);
+    currReactor->Result = currReactor->OwnerServer->runReactor(*currReactor);
+    return NULL;
+}
 
-    // Destroy resources even after the event loop is successfully, so that a server can be restarted.
-    // if (UNLIKELY(result != IRC_SUCCESS))
+EIrcErrorCode Server::runReactor(ReactorControlBlock& reactor)
+{
+    pthread_mutex_lock(&mStateLock);
+    mLockedTickTime = reactor.TickTime;
+
+    EIrcErrorCode result = eventLoop(reactor);
+
+    logMessage("Reactor " + ValToString(reactor.Idx) + " stopped. Sent message blocks: " + ValToString(reactor.NumSentMsgBlocks)
+               + ", Send calls: " + ValToString(reactor.NumSendCalls) + ", Saved send calls: " + ValToString(reactor.NumSentMsgBlocks - reactor.NumSendCalls)
+               + ", Ticks: " + ValToString(reactor.NumTicks) + ", Registrations: " + ValToString(reactor.NumRegistrations) + ", Coalesced registrations: " + ValToString(reactor.NumCoalescedRegistrations)
+               + ", Receive pauses: " + ValToString(reactor.NumRecvPauses) + ", Receive calls: " + ValToString(reactor.NumRecvCalls) + ", Received bytes: " + ValToString(reactor.NumRecvBytes));
+    logMessage("Reactor " + ValToString(reactor.Idx) + " accepted clients: " + ValToString(reactor.NumAcceptedClients)
+               + ", Shed connections: " + ValToString(reactor.NumShedConnections) + ", Listen suspensions: " + ValToString(reactor.NumListenSuspensions));
+    logMessage("Reactor " + ValToString(reactor.Idx) + " processed messages: " + ValToString(reactor.NumProcessedMsgs) + ", Copied: " + ValToString(reactor.NumCopiedMsgs)
+               + ", Rounds: " + ValToString(reactor.NumMsgProcessRounds) + ", Forced rounds: " + ValToString(reactor.NumForcedMsgProcessRounds)
+               + ", Queueing delay sum(us): " + ValToString(reactor.MsgProcessDelaySumMicrosec) + ", max(us): " + ValToString(reactor.MsgProcessDelayMaxMicrosec));
+    logMessage("Reactor " + ValToString(reactor.Idx) + " control lane messages: " + ValToString(reactor.NumLaneMsgs[SEND_LANE_CONTROL])
+               + ", Max depth: " + ValToString(reactor.LaneDepthMax[SEND_LANE_CONTROL]) + ", Wait samples: " + ValToString(reactor.NumLaneWaitSamples[SEND_LANE_CONTROL])
+               + ", Wait sum(us): " + ValToString(reactor.LaneWaitSumMicrosec[SEND_LANE_CONTROL]) + ", max(us): " + ValToString(reactor.LaneWaitMaxMicrosec[SEND_LANE_CONTROL])
+               + ", Bulk lane messages: " + ValToString(reactor.NumLaneMsgs[SEND_LANE_BULK]) + ", Deferred: " + ValToString(reactor.NumDeferredBulkMsgs)
+               + ", Max depth: " + ValToString(reactor.LaneDepthMax[SEND_LANE_BULK]) + ", Wait samples: " + ValToString(reactor.NumLaneWaitSamples[SEND_LANE_BULK])
+               + ", Wait sum(us): " + ValToString(reactor.LaneWaitSumMicrosec[SEND_LANE_BULK]) + ", max(us): " + ValToString(reactor.LaneWaitMaxMicrosec[SEND_LANE_BULK]));
+    logMessage("Reactor " + ValToString(reactor.Idx) + " expired timers: " + ValToString(reactor.NumExpiredTimers)
+               + ", Sent PINGs: " + ValToString(reactor.NumSentPings) + ", Timed out clients: " + ValToString(reactor.NumTimedOutClients));
+    if (mConfig.ZeroCopyThreshold != 0)
     {
-        destroyResources();
+        logMessage("Reactor " + ValToString(reactor.Idx) + " zero-copy sends: " + ValToString(reactor.NumZeroCopySends)
+                   + ", Copied by kernel: " + ValToString(reactor.NumZeroCopyCopiedSends) + ", Fallbacks: " + ValToString(reactor.NumZeroCopyFallbacks));
+    }
+    if (mConfig.BusyPollMicrosec != 0 || mConfig.bLatencyHistogram)
+    {
+        logLatencyReport(reactor);
+    }
+
+    // Stop the other reactors
+    if (!mbShutdown)
+    {
+        mbShutdown = true;
+        for (size_t i = 0; i < mReactors.size(); i++)
+        {
+            if (mReactors[i] != &reactor)
+            {
+                wakeupReactor(*mReactors[i]);
+            }
+        }
     }
 
+    pthread_mutex_unlock(&mStateLock);
     return result;
 }
 
-EIrcErrorCode Server::eventLoop()
+void Server::wakeupReactor(ReactorControlBlock& reactor)
+{
+    if (reactor.bWakeupPending)
+    {
+        return;
+    }
+    reactor.bWakeupPending = true;
+
+    const char wakeupByte = 0;
+    const ssize_t nWritten = write(reactor.hWakeupSockets[1], &wakeupByte, sizeof(wakeupByte));
+    (void)nWritten;
+}
+
+EIrcErrorCode Server::eventLoop(ReactorControlBlock& reactor)
 {
     struct timespec timeoutZero;
     memset(&timeoutZero, 0, sizeof(timeoutZero));
+    struct timespec timeoutTimer;
+    memset(&timeoutTimer, 0, sizeof(timeoutTimer));
 
-    ALIGNAS(PAGE_SIZE) static kevent_t observedEvents[KEVENT_OBSERVE_MAX];
+    EventQueue::Event* observedEvents = &reactor.ObservedEvents[0];
     int observedEventNum = 0;
 
-    // The list of clients with receive messages to process
-    // Duplicate is allowed.
+    // The list of clients with receive messages to process, in the order of ClientControlBlock::MsgProcessQueuedTime.
+    // A client is added once until it is processed. (See ClientControlBlock::bMsgProcessQueued)
     std::vector< SharedPtr< ClientControlBlock > > receivedClientMsgProcessQueue;
-    receivedClientMsgProcessQueue.reserve(CLIENT_MAX);
+    receivedClientMsgProcessQueue.reserve(CLIENT_RESERVE_MIN);
+
+    // The clients that used up the budget of a round. Processed in the next round after the others.
+    std::vector< SharedPtr< ClientControlBlock > > nextMsgProcessQueue;
+    nextMsgProcessQueue.reserve(CLIENT_RESERVE_MIN);
+
+    std::vector<MsgView> separatedMsgs;
+
+    // Resumed after a failed hot upgrade, or restored from the old process. (See [ \ref irc_server_hot_upgrade ])
+    receivedClientMsgProcessQueue.swap(reactor.SuspendedMsgProcessQueue);
+    reactor.SuspendedMsgProcessQueue.clear();
 
     while (true)
     {
         // Release the clients that are deferred to release. (See forceDisconnectClient() for details)
-        mClientReleaseQueue.clear();
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+        // The requests in flight still refer to the client and its socket.
+        // So the client is kept until all of them are done, and the socket is closed at the release.
+        for (size_t i = 0; i < reactor.ClientReleaseQueue.size(); )
+        {
+            if (reactor.ClientReleaseQueue[i]->NumPendingIoRequests > 0)
+            {
+                i++;
+                continue;
+            }
+
+            close(reactor.ClientReleaseQueue[i]->hSocket);
+
+            // Fast remove (unordered)
+            reactor.ClientReleaseQueue[i] = reactor.ClientReleaseQueue.back();
+            reactor.ClientReleaseQueue.pop_back();
+        }
+
+        // The received buffers of the last tick are not used anymore.
+        reactor.Events.RecycleRecvBuffers();
+#else
+        reactor.ClientReleaseQueue.clear();
+#endif
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        // The message blocks of the closed clients are released after they lingered at least CLIENT_DISCONNECT_TIMEOUT. (See [ \ref irc_server_zerocopy ])
+        if (reactor.TickTime >= reactor.LingeringZeroCopyRotateTime)
+        {
+            reactor.LingeringZeroCopyMsgBlocks[1].clear();
+            reactor.LingeringZeroCopyMsgBlocks[1].swap(reactor.LingeringZeroCopyMsgBlocks[0]);
+            reactor.LingeringZeroCopyRotateTime = reactor.TickTime + CLIENT_DISCONNECT_TIMEOUT * static_cast<uint64_t>(MICROSEC_PER_SEC);
+        }
+#endif
+
+        if (mbShutdown)
+        {
+            reactor.SuspendedMsgProcessQueue.swap(receivedClientMsgProcessQueue);
+            return IRC_SHUTDOWN;
+        }
+
+        // Stop all reactors at the top of the tick, where the sends of the last tick are committed. (See [ \ref irc_server_hot_upgrade ])
+        if (UNLIKELY(mbUpgradeRequested))
+        {
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+            // The requests in flight can not be handed over.
+            mbUpgradeRequested = 0;
+            logMessage("Hot upgrade is not supported by the io_uring backend.");
+#else
+            reactor.SuspendedMsgProcessQueue.swap(receivedClientMsgProcessQueue);
+            return IRC_UPGRADE;
+#endif
+        }
 
         // Set the timeout of kevent.
-        // If there is no message to process, the timeout is NULL to wait indefinitely.
+        // If there is no message to process, the timeout is until the next client timer, or NULL to wait indefinitely without a timer.
         // Else, the timeout is zero to process the received messages from the clients.
         struct timespec* timeout = NULL;
         if (!receivedClientMsgProcessQueue.empty())
         {
             timeout = &timeoutZero;
         }
+        else if (reactor.ClientTimers.GetNumTimers() != 0)
+        {
+            const uint64_t nextTimerTime = reactor.ClientTimers.GetNextEventTick() * CLIENT_TIMER_TICK_MICROSEC;
+            const uint64_t timerDelay = (nextTimerTime > reactor.TickTime) ? nextTimerTime - reactor.TickTime : 0;
+            timeoutTimer.tv_sec = static_cast<time_t>(timerDelay / MICROSEC_PER_SEC);
+            timeoutTimer.tv_nsec = static_cast<long>(timerDelay % MICROSEC_PER_SEC) * 1000;
+            timeout = &timeoutTimer;
+        }
+
+        // Remove the registrations canceled in this tick. (See [ \ref irc_server_registration_coalescing ])
+        if (reactor.NumCanceledRegistrations != 0)
+        {
+            std::vector<EventQueue::Event>& eventRegistrationQueue = reactor.EventRegistrationQueue;
+            size_t numKept = 0;
+            for (size_t i = 0; i < eventRegistrationQueue.size(); i++)
+            {
+                if (eventRegistrationQueue[i].flags != 0)
+                {
+                    eventRegistrationQueue[numKept++] = eventRegistrationQueue[i];
+                }
+            }
+            Assert(eventRegistrationQueue.size() - numKept == reactor.NumCanceledRegistrations);
+            eventRegistrationQueue.resize(numKept);
+            reactor.NumCanceledRegistrations = 0;
+        }
+
+        // Take the registrations, so that the other reactors can add registrations during the Wait().
+        // The ClientControlBlock::QueuedEventIdx of the taken registrations are not valid after the NumTicks is increased.
+        reactor.EventChangeList.swap(reactor.EventRegistrationQueue);
+        reactor.bWakeupPending = false;
+        reactor.NumTicks++;
+        reactor.NumRegistrations += reactor.EventChangeList.size();
+        pthread_mutex_unlock(&mStateLock);
+
+        // Receive observed events from the event queue
+        // In the busy-poll mode, spin with the zero timeout before blocking. (See [ \ref irc_server_busy_poll ])
+        const EventQueue::Event* eventChanges = reactor.EventChangeList.data();
+        int numEventChanges = static_cast<int>(reactor.EventChangeList.size());
+        observedEventNum = 0;
+        if (mConfig.BusyPollMicrosec != 0 && timeout != &timeoutZero)
+        {
+            reactor.NumBusyPolls++;
+            const uint64_t spinEndTime = GetMonotonicMicrosec() + mConfig.BusyPollMicrosec;
+            do
+            {
+                observedEventNum = reactor.Events.Wait(eventChanges, numEventChanges, observedEvents, reactor.ObservedEvents.size(), &timeoutZero);
+                eventChanges = NULL;
+                numEventChanges = 0;
+            } while (observedEventNum == 0 && GetMonotonicMicrosec() < spinEndTime);
+
+            if (observedEventNum != 0)
+            {
+                reactor.NumBusyPollHits++;
+            }
+        }
+        if (observedEventNum == 0)
+        {
+            observedEventNum = reactor.Events.Wait(eventChanges, numEventChanges, observedEvents, reactor.ObservedEvents.size(), timeout);
+        }
+        reactor.EventChangeList.clear();
+
+#if !defined(IRC_EVENT_BACKEND_IO_URING)
+        // Receive the messages of the observed READ events without the lock. (See [ \ref irc_server_multi_reactor ])
+        size_t recvScratchUsed = 0;
+        for (int eventIdx = 0; eventIdx < observedEventNum; eventIdx++)
+        {
+            const EventQueue::Event& currEvent = observedEvents[eventIdx];
+            reactor.RecvScratchLen[eventIdx] = ReactorControlBlock::RECV_SKIPPED;
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+            reactor.RecvTimestamps[eventIdx] = 0;
+#endif
+
+            if (currEvent.filter != EventQueue::FILTER_READ || currEvent.udata == NULL || (currEvent.flags & (EventQueue::FLAG_ERROR | EventQueue::FLAG_EOF)))
+            {
+                continue;
+            }
+
+            // Only the fields modified by this reactor alone are read here. (See [ \ref irc_server_multi_reactor ])
+            // The bExpired is not one of them, and an expired client is paused under the lock below.
+            const ClientControlBlock* currClient = peekClientFromEventUdata(currEvent);
+            if (currClient->bSocketClosed)
+            {
+                continue;
+            }
+
+            // The READ filter is disabled until the pending messages are processed. (See [ \ref irc_server_recv_backpressure ])
+            if (currClient->bRecvPaused)
+            {
+                continue;
+            }
+
+            // Receive once, or until EAGAIN if edge-triggered, up to the pause threshold.
+            // An edge-triggered socket stops at the pause threshold, and the rest is observed when the filter is enabled again.
+            Assert(currClient->RecvMsgBlocks.size() < NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD);
+            const size_t nRecvBytesBudget = (NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD - currClient->RecvMsgBlocks.size()) * MESSAGE_LEN_MAX;
+            if (reactor.RecvScratch.size() < recvScratchUsed + nRecvBytesBudget)
+            {
+                reactor.RecvScratch.resize(std::max(reactor.RecvScratch.size() * 2, recvScratchUsed + nRecvBytesBudget));
+            }
+
+            // The free space of the last block is filled in place, and the rest goes to the scratch. (See [ \ref irc_server_recv_readv ])
+            MsgBlock* tailMsgBlock = (currClient->RecvMsgBlocks.empty()) ? NULL : currClient->RecvMsgBlocks.back().Get();
+            const size_t nTailFreeBytes = (tailMsgBlock == NULL) ? 0 : MESSAGE_LEN_MAX - tailMsgBlock->MsgLen;
+            reactor.RecvScratchOffset[eventIdx] = recvScratchUsed;
+            size_t nTotalRecvBytes = 0;
+            ssize_t recvResult = 0;
+            while (true)
+            {
+                const size_t nTailRecvBytes = std::min(nTotalRecvBytes, nTailFreeBytes);
+                struct iovec recvIovecs[2];
+                int numRecvIovecs = 0;
+                if (nTailRecvBytes < nTailFreeBytes)
+                {
+                    recvIovecs[numRecvIovecs].iov_base = &tailMsgBlock->Msg[tailMsgBlock->MsgLen + nTailRecvBytes];
+                    recvIovecs[numRecvIovecs].iov_len = nTailFreeBytes - nTailRecvBytes;
+                    numRecvIovecs++;
+                }
+                recvIovecs[numRecvIovecs].iov_base = &reactor.RecvScratch[recvScratchUsed + nTotalRecvBytes - nTailRecvBytes];
+                recvIovecs[numRecvIovecs].iov_len = nRecvBytesBudget - nTotalRecvBytes - (nTailFreeBytes - nTailRecvBytes);
+                numRecvIovecs++;
+
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+                // The first one has the kernel time of the oldest byte of the event.
+                const ssize_t nRecvBytes = (mConfig.bLatencyHistogram && nTotalRecvBytes == 0)
+                                           ? ReadvWithTimestamp(currClient->hSocket, recvIovecs, numRecvIovecs, reactor.RecvTimestamps[eventIdx])
+                                           : readv(currClient->hSocket, recvIovecs, numRecvIovecs);
+#else
+                const ssize_t nRecvBytes = readv(currClient->hSocket, recvIovecs, numRecvIovecs);
+#endif
+                reactor.NumRecvCalls++;
+                if (nRecvBytes > 0)
+                {
+                    reactor.NumRecvBytes += nRecvBytes;
+                    nTotalRecvBytes += nRecvBytes;
+                    recvResult = nTotalRecvBytes;
+                    if (mConfig.bEdgeTriggered && nTotalRecvBytes < nRecvBytesBudget)
+                    {
+                        continue;
+                    }
+                }
+                else if (nRecvBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // Drained, or a spurious event.
+                    if (nTotalRecvBytes == 0)
+                    {
+                        recvResult = ReactorControlBlock::RECV_SKIPPED;
+                    }
+                }
+                else
+                {
+                    // Closed(0) or error(-1). The bytes received before are discarded with the client.
+                    recvResult = nRecvBytes;
+                }
+                break;
+            }
+            reactor.RecvTailLen[eventIdx] = std::min(nTotalRecvBytes, nTailFreeBytes);
+            recvScratchUsed += nTotalRecvBytes - reactor.RecvTailLen[eventIdx];
+            reactor.RecvScratchLen[eventIdx] = recvResult;
+        }
+#endif
 
-        // Receive observed events from kqueue
-        observedEventNum = kevent(mhKqueue, mEventRegistrationQueue.data(), mEventRegistrationQueue.size(), observedEvents, sizeof(observedEvents) / sizeof(kevent_t), timeout);
+        pthread_mutex_lock(&mStateLock);
         if (UNLIKELY(observedEventNum == -1))
         {
             logErrorCode(IRC_FAILED_TO_WAIT_KEVENT);
             return IRC_FAILED_TO_WAIT_KEVENT;
         }
-        mEventRegistrationQueue.clear();
 
         // Process the received messages from the clients when there is no observed event.
-        // However, if there are more messages pending than it can handle, it will exceptionally prioritize processing.
-        const size_t pendingMsgWarningThreshold = 64;
-        if (observedEventNum == 0 || (receivedClientMsgProcessQueue.size() > pendingMsgWarningThreshold))
+        // However, it is forced if too many clients are waiting or the oldest one waited too long. (See [ \ref irc_server_msg_process_scheduling ])
+        reactor.TickTime = GetMonotonicMicrosec();
+        mLockedTickTime = reactor.TickTime;
+        const uint64_t currentTickTime = reactor.TickTime;
+        if (!receivedClientMsgProcessQueue.empty()
+            && (observedEventNum == 0
+                || receivedClientMsgProcessQueue.size() > NUM_MSG_PROCESS_QUEUE_FORCE_THRESHOLD
+                || currentTickTime - receivedClientMsgProcessQueue.front()->MsgProcessQueuedTime > MSG_PROCESS_QUEUE_DELAY_MAX_MICROSEC))
         {
-            if (receivedClientMsgProcessQueue.size() > pendingMsgWarningThreshold)
+            reactor.NumMsgProcessRounds++;
+            if (observedEventNum != 0)
             {
-                logMessage("Too many messages pending. Process the received messages first.");
+                reactor.NumForcedMsgProcessRounds++;
             }
 
             for (size_t queueIdx = 0; queueIdx < receivedClientMsgProcessQueue.size(); queueIdx++)
             {
                 SharedPtr<ClientControlBlock> client = receivedClientMsgProcessQueue[queueIdx];
-                if (client == NULL || client->bExpired)
+                client->bMsgProcessQueued = false;
+                if (client->bExpired)
                 {
                     continue;
                 }
 
-                std::vector< SharedPtr< MsgBlock > > separatedMsgs;
-                EIrcErrorCode err = separateMsgsFromClientRecvMsgs(client, separatedMsgs);
+                const uint64_t queueingDelay = currentTickTime - client->MsgProcessQueuedTime;
+                reactor.MsgProcessDelaySumMicrosec += queueingDelay;
+                reactor.MsgProcessDelayMaxMicrosec = std::max(reactor.MsgProcessDelayMaxMicrosec, queueingDelay);
+
+                // Up to the budget per round, so that a flooding client does not delay the others.
+                separatedMsgs.clear();
+                EIrcErrorCode err = separateMsgsFromClientRecvMsgs(client, separatedMsgs, NUM_CLIENT_MSG_PROCESS_BUDGET);
                 Assert(err == IRC_SUCCESS);
+                reactor.NumProcessedMsgs += separatedMsgs.size();
                 
                 for (size_t msgIdx = 0; msgIdx < separatedMsgs.size(); msgIdx++)
                 {
@@ -182,22 +681,70 @@ EIrcErrorCode Server::eventLoop()
                         return err;
                     }
                 }
+
+                if (client->bExpired)
+                {
+                    continue;
+                }
+
+                // The rest waits for the next round.
+                if (separatedMsgs.size() == NUM_CLIENT_MSG_PROCESS_BUDGET)
+                {
+                    client->bMsgProcessQueued = true;
+                    client->MsgProcessQueuedTime = currentTickTime;
+                    nextMsgProcessQueue.push_back(client);
+                }
+
+                // Receive again. (See [ \ref irc_server_recv_backpressure ])
+                if (client->bRecvPaused && client->RecvMsgBlocks.size() <= NUM_CLIENT_MSGBLOCK_RECV_RESUME_THRESHOLD)
+                {
+                    setClientRecvPaused(reactor, client, false);
+                }
             }
-            receivedClientMsgProcessQueue.clear();
-            continue;
+            receivedClientMsgProcessQueue.swap(nextMsgProcessQueue);
+            nextMsgProcessQueue.clear();
+
+            // The observed events are already received, so they are processed too.
+            // The replies are sent at the end of the tick.
         }
 
         // Process observed events
-        const time_t currentTickServerTime = std::time(NULL);
         for (int eventIdx = 0; eventIdx < observedEventNum; eventIdx++)
         {
-            kevent_t& currEvent = observedEvents[eventIdx];
+            EventQueue::Event& currEvent = observedEvents[eventIdx];
+
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+            // The request of the client is done. (See ClientControlBlock::NumPendingIoRequests)
+            if ((currEvent.flags & EventQueue::FLAG_REQUEST_DONE) && currEvent.udata != NULL)
+            {
+                SharedPtr<ClientControlBlock> client = getClientFromEventUdata(currEvent);
+                Assert(client->NumPendingIoRequests > 0);
+                client->NumPendingIoRequests--;
+                if (currEvent.filter == EventQueue::FILTER_WRITE)
+                {
+                    Assert(client->NumInFlightSends > 0);
+                    client->NumInFlightSends--;
+                }
+            }
+#endif
+
+            // 0. Wakeup by the other reactor. The new registrations are applied at the next Wait().
+            if (static_cast<int>(currEvent.ident) == reactor.hWakeupSockets[0])
+            {
+#if !defined(IRC_EVENT_BACKEND_IO_URING)
+                char wakeupBytes[64];
+                while (recv(reactor.hWakeupSockets[0], wakeupBytes, sizeof(wakeupBytes), 0) > 0)
+                {
+                }
+#endif
+                continue;
+            }
 
             // 1. Error event
-            if (UNLIKELY(currEvent.flags & EV_ERROR || currEvent.flags & EV_EOF))
+            if (UNLIKELY(currEvent.flags & EventQueue::FLAG_ERROR || currEvent.flags & EventQueue::FLAG_EOF))
             {
                 // Listen socket error
-                if (UNLIKELY(static_cast<int>(currEvent.ident) == mhListenSocket))
+                if (UNLIKELY(static_cast<int>(currEvent.ident) == reactor.hListenSocket))
                 {
                     logErrorCode(IRC_ERROR_LISTEN_SOCKET_EVENT);
                     return IRC_ERROR_LISTEN_SOCKET_EVENT;
@@ -206,14 +753,38 @@ EIrcErrorCode Server::eventLoop()
                 // Client socket error
                 else
                 {
-                    SharedPtr<ClientControlBlock> client = getClientFromKeventUdata(currEvent);
+                    SharedPtr<ClientControlBlock> client = getClientFromEventUdata(currEvent);
                     if (client == NULL)
                     {
                         continue;
                     }
 
-                    if (client->bSocketClosed || client->bExpired)
+                    if (client->bSocketClosed)
+                    {
+                        continue;
+                    }
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+                    // The notifications of the MSG_ZEROCOPY sends are observed as an error without EOF. (See [ \ref irc_server_zerocopy ])
+                    if (client->bZeroCopyEnabled && !(currEvent.flags & EventQueue::FLAG_EOF) && reapZeroCopySends(reactor, client))
+                    {
+                        // The readiness to receive observed together is lost, so an edge-triggered filter is re-armed.
+                        if (mConfig.bEdgeTriggered && !client->bRecvPaused)
+                        {
+                            queueClientEvent(reactor, client, EventQueue::FILTER_READ, EventQueue::FLAG_ENABLE | EventQueue::FLAG_CLEAR);
+                        }
+                        continue;
+                    }
+#endif
+
+                    // The remaining messages of the expired client can't be sent anymore.
+                    if (client->bExpired)
                     {
+                        EIrcErrorCode err = forceDisconnectClient(client);
+                        if (UNLIKELY(err != IRC_SUCCESS))
+                        {
+                            return err;
+                        }
                         continue;
                     }
 
@@ -222,7 +793,7 @@ EIrcErrorCode Server::eventLoop()
                     logMessage("[Status] bClosed: " + ValToString(client->bSocketClosed) + ", bExpired: " + ValToString(client->bExpired));
 
                     EIrcErrorCode err;
-                    if (currEvent.flags & EV_EOF)
+                    if (currEvent.flags & EventQueue::FLAG_EOF)
                     {
                         err = forceDisconnectClient(client, "Connection closed by client.");
                     }
@@ -239,50 +810,101 @@ EIrcErrorCode Server::eventLoop()
             } 
 
             // 2. Read event
-            else if (currEvent.filter == EVFILT_READ)
+            else if (currEvent.filter == EventQueue::FILTER_READ)
             {
                 // Request to accept the new client connection.
-                if (static_cast<int>(currEvent.ident) == mhListenSocket)
+                if (static_cast<int>(currEvent.ident) == reactor.hListenSocket)
                 {
-                    // Accept client until there is no client to accept
-                    while (true)
+                    // Accept clients up to the budget, so that a connection storm does not starve the established clients.
+                    // The rest is observed again at the next Wait(), because the listen socket is level-triggered. (See [ \ref irc_server_accept ])
+                    for (size_t numAccepts = 0; numAccepts < NUM_ACCEPT_PER_TICK_MAX; numAccepts++)
                     {
                         // Accept client
                         sockaddr_in_t   clientAddr;
                         socklen_t       clientAddrLen = sizeof(clientAddr);
-                        const int       clientSocket  = accept(mhListenSocket, reinterpret_cast<sockaddr_t*>(&clientAddr), &clientAddrLen);
-                        if (clientSocket == -1)
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+                        // Already accepted by the multishot accept request. (One socket per event)
+                        const int       clientSocket  = static_cast<int>(currEvent.data);
+
+                        // Out of the file descriptors. The accept request is stopped by the event queue until resumeListening().
+                        if (UNLIKELY(clientSocket == -1))
                         {
+                            Assert(currEvent.fflags == EMFILE || currEvent.fflags == ENFILE);
+                            shedPendingConnection(reactor);
+                            suspendListening(reactor);
                             break;
                         }
 
-                        // Set client socket as non-blocking
-                        if (UNLIKELY(fcntl(clientSocket, F_SETFL, O_NONBLOCK) == -1))
+                        if (UNLIKELY(getpeername(clientSocket, reinterpret_cast<sockaddr_t*>(&clientAddr), &clientAddrLen) == -1))
+                        {
+                            close(clientSocket);
+                            break;
+                        }
+
+                        // Already accepted, so the connection over the limit is closed, and the accept stops until a client is disconnected.
+                        if (mNumClients >= mConfig.MaxClients)
+                        {
+                            close(clientSocket);
+                            reactor.NumShedConnections++;
+                            suspendListening(reactor);
+                            break;
+                        }
+#else
+                        // Stop accepting at the limit until a client is disconnected.
+                        if (mNumClients >= mConfig.MaxClients)
+                        {
+                            suspendListening(reactor);
+                            break;
+                        }
+
+#if defined(__linux__)
+                        // Non-blocking without the fcntl() call.
+                        const int       clientSocket  = accept4(reactor.hListenSocket, reinterpret_cast<sockaddr_t*>(&clientAddr), &clientAddrLen, SOCK_NONBLOCK);
+#else
+                        const int       clientSocket  = accept(reactor.hListenSocket, reinterpret_cast<sockaddr_t*>(&clientAddr), &clientAddrLen);
+#endif
+                        if (clientSocket == -1)
+                        {
+                            // Out of the file descriptors. The pending connection would be observed on every Wait().
+                            if (errno == EMFILE || errno == ENFILE)
+                            {
+                                shedPendingConnection(reactor);
+                                suspendListening(reactor);
+                            }
+                            break;
+                        }
+
+#if !defined(__linux__)
+                        // Set client socket as non-blocking
+                        if (UNLIKELY(fcntl(clientSocket, F_SETFL, O_NONBLOCK) == -1))
                         {
                             logErrorCode(IRC_FAILED_TO_SETSOCKOPT_SOCKET);
                             close(clientSocket);
                             continue;
                         }
+#endif
+#endif
 
                         // Add client to the client list
                         SharedPtr<ClientControlBlock> newClient = MakeShared<ClientControlBlock>();
                         newClient->hSocket = clientSocket;
+                        newClient->ReactorIdx = reactor.Idx;
                         newClient->Addr = clientAddr;
-                        newClient->LastActiveTime = currentTickServerTime;
+                        newClient->LastActiveTime = currentTickTime;
+                        newClient->DeadlineTimer.Owner = reinterpret_cast<void*>(newClient.GetControlBlock());
+                        scheduleClientTimer(reactor, newClient, currentTickTime + CLIENT_REGISTRATION_TIMEOUT * static_cast<uint64_t>(MICROSEC_PER_SEC));
+                        newClient->UnregisteredClientIdx = mUnregistedClients.size();
                         mUnregistedClients.push_back(newClient);
+                        mNumClients++;
+                        reactor.NumAcceptedClients++;
+                        setupClientSocket(reactor, newClient);
 
-                        // Add to the kqueue registration queue.
-                        // With pass the controlBlock of SharedPtr to the udata member of kevent.
-                        // See mhKqueue for details.
-                        kevent_t evClient;
-                        std::memset(&evClient, 0, sizeof(evClient));
-                        evClient.ident  = clientSocket;
-                        evClient.filter = EVFILT_READ;
-                        evClient.flags  = EV_ADD;
-                        evClient.udata  = reinterpret_cast<void*>(newClient.GetControlBlock());
-                        mEventRegistrationQueue.push_back(evClient);
-
-                        logMessage("New client connected. IP: " + InetAddrToString(clientAddr));
+#ifdef IRC_VERBOSE_LOG
+                        logVerbose("New client connected. IP: " + InetAddrToString(clientAddr));
+#endif
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+                        break;
+#endif
                     }
                 }
 
@@ -291,34 +913,59 @@ EIrcErrorCode Server::eventLoop()
                 {
                     // Get the Client control block of SharedPtr to the client from udata  
                     // and recover the SharedPtr from the controlBlock.  
-                    // See mhKqueue for details.
-                    SharedPtr<ClientControlBlock> currClient = getClientFromKeventUdata(currEvent);
+                    // See ReactorControlBlock::Events for details.
+                    SharedPtr<ClientControlBlock> currClient = getClientFromEventUdata(currEvent);
                     Assert(currClient != NULL);
                     Assert(currClient->hSocket == static_cast<int>(currEvent.ident));
 
-                    if (currClient->bSocketClosed || currClient->bExpired)
+                    if (currClient->bSocketClosed)
+                    {
+                        continue;
+                    }
+
+                    // Expired by another reactor, which can not pause the receive of this reactor. (See disconnectClient())
+                    if (currClient->bExpired)
                     {
+                        if (!currClient->bRecvPaused)
+                        {
+                            setClientRecvPaused(reactor, currClient, true);
+                        }
                         continue;
                     }
 
-                    // Intentional ignore due to too many messages pending
-                    if (currClient->RecvMsgBlocks.size() >= NUM_CLIENT_MSGBLOCK_RECV_IGNORE_THRESHOLD)
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+                    // The multishot recv request is canceled by the pause. (See setClientRecvPaused())
+                    if (currEvent.data == 0)
                     {
                         continue;
                     }
 
-                    // If there is space left in the last message block of the client, receive as many bytes as possible in that space,
-                    // or if not, in a new message block space.
+                    // The message is already received into a buffer of the event queue.
+                    // Fill the last message block first like recv() below, and take the buffer without copy if it can be a new block as it is.
+                    const MsgBlock& recvBuffer = reactor.Events.GetRecvBuffer(currEvent);
+                    const size_t nRecvBytes = recvBuffer.MsgLen;
+                    Assert(nRecvBytes > 0 && nRecvBytes <= MESSAGE_LEN_MAX);
+
                     if (currClient->RecvMsgBlocks.empty() || currClient->RecvMsgBlocks.back()->MsgLen == MESSAGE_LEN_MAX)
                     {
-                        currClient->RecvMsgBlocks.push_back(MakeShared<MsgBlock>());
+                        currClient->RecvMsgBlocks.push_back(reactor.Events.TakeRecvBuffer(currEvent));
+                    }
+                    else
+                    {
+                        appendRecvBytesToClient(currClient, recvBuffer.Msg, nRecvBytes);
                     }
-                    
-                    SharedPtr<MsgBlock> recvMsgBlock = currClient->RecvMsgBlocks.back();
-                    STATIC_ASSERT(sizeof(recvMsgBlock->Msg) == MESSAGE_LEN_MAX);
-                    Assert(recvMsgBlock->MsgLen < MESSAGE_LEN_MAX);
 
-                    const int nRecvBytes = recv(currClient->hSocket, &recvMsgBlock->Msg[recvMsgBlock->MsgLen], MESSAGE_LEN_MAX - recvMsgBlock->MsgLen, 0);
+#ifdef IRC_VERBOSE_LOG
+                    logVerbose("Received message from client. IP: " + InetAddrToString(currClient->Addr) + ", Nick: " + currClient->Nickname + ", Received bytes: " + ValToString(nRecvBytes));
+#endif
+#else
+                    // Received before the lock. (See the start of the tick)
+                    const ssize_t nRecvBytes = reactor.RecvScratchLen[eventIdx];
+                    if (nRecvBytes == ReactorControlBlock::RECV_SKIPPED)
+                    {
+                        continue;
+                    }
+                    
                     if (UNLIKELY(nRecvBytes == -1))
                     {
                         logErrorCode(IRC_FAILED_TO_RECV_SOCKET);
@@ -341,94 +988,276 @@ EIrcErrorCode Server::eventLoop()
                         continue;
                     }
 
-                    logVerbose("Received message from client. IP: " + InetAddrToString(currClient->Addr) + ", Nick: " + currClient->Nickname + ", Received=[" + (std::string(recvMsgBlock->Msg, recvMsgBlock->MsgLen + nRecvBytes)).substr(recvMsgBlock->MsgLen, nRecvBytes) + "]");
-                    recvMsgBlock->MsgLen += nRecvBytes;
+                    // The leading bytes are already in the last message block of the client, and the rest is copied to the new message blocks.
+                    const size_t nTailRecvBytes = reactor.RecvTailLen[eventIdx];
+                    if (nTailRecvBytes > 0)
+                    {
+                        MsgBlock& tailMsgBlock = *currClient->RecvMsgBlocks.back();
+                        Assert(tailMsgBlock.MsgLen + nTailRecvBytes <= MESSAGE_LEN_MAX);
+                        tailMsgBlock.MsgLen += nTailRecvBytes;
+                    }
+                    const char* recvBytes = &reactor.RecvScratch[reactor.RecvScratchOffset[eventIdx]];
+#ifdef IRC_VERBOSE_LOG
+                    logVerbose("Received message from client. IP: " + InetAddrToString(currClient->Addr) + ", Nick: " + currClient->Nickname + ", Received bytes: " + ValToString(nRecvBytes));
+#endif
+
+                    appendRecvBytesToClient(currClient, recvBytes, nRecvBytes - nTailRecvBytes);
+
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+                    // From the kernel receive time to here. (See [ \ref irc_server_dispatch_latency ])
+                    if (reactor.RecvTimestamps[eventIdx] != 0)
+                    {
+                        const uint64_t dispatchTime = GetRealtimeNanosec();
+                        const uint64_t recvTime = reactor.RecvTimestamps[eventIdx];
+                        reactor.DispatchLatency.Add((dispatchTime > recvTime) ? (dispatchTime - recvTime) / 1000 : 0);
+                    }
+#endif
+#endif
+
+                    // Stop receiving until the messages are processed. (See [ \ref irc_server_recv_backpressure ])
+                    if (!currClient->bRecvPaused && currClient->RecvMsgBlocks.size() >= NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD)
+                    {
+                        setClientRecvPaused(reactor, currClient, true);
+                    }
                     
-                    currClient->LastActiveTime = currentTickServerTime;
-                    receivedClientMsgProcessQueue.push_back(currClient);
+                    currClient->LastActiveTime = currentTickTime;
+                    if (!currClient->bMsgProcessQueued)
+                    {
+                        currClient->bMsgProcessQueued = true;
+                        currClient->MsgProcessQueuedTime = currentTickTime;
+                        receivedClientMsgProcessQueue.push_back(currClient);
+                    }
 
-                } // if (currEvent.ident == mhListenSocket)
+                } // if (currEvent.ident == reactor.hListenSocket)
 
-            } // if (currEvent.filter == EVFILT_READ)
+            } // if (currEvent.filter == EventQueue::FILTER_READ)
 
             // 3. Write event
             // Send messages to the client
-            else if (currEvent.filter == EVFILT_WRITE)
+            else if (currEvent.filter == EventQueue::FILTER_WRITE)
             {
                 // TODO: Can a listen socket raise a write event? I'll check this later.
-                Assert(static_cast<int>(currEvent.ident) != mhListenSocket);
+                Assert(static_cast<int>(currEvent.ident) != reactor.hListenSocket);
 
-                SharedPtr<ClientControlBlock> currClient = getClientFromKeventUdata(currEvent);
+                SharedPtr<ClientControlBlock> currClient = getClientFromEventUdata(currEvent);
                 if (currClient == NULL)
                 {
                     continue;
                 }
 
-                if (currClient->bSocketClosed)
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+                // Sent bytes of a finished send request. Pop the fully sent message blocks.
+                if (currEvent.flags & EventQueue::FLAG_REQUEST_DONE)
                 {
-                    continue;
+                    reactor.NumSendCalls++;
+                    reactor.NumSentMsgBlocks += advanceSendCursor(currClient, static_cast<size_t>(currEvent.data));
                 }
 
-                // Send the messages in the sending queue
-                if (currClient->MsgSendingQueue.empty())
+                // Submit the sending queue after the previous requests are all done, so that the cursor is consistent.
+                if (currClient->bSocketClosed || currClient->NumInFlightSends > 0)
                 {
                     continue;
                 }
-                SharedPtr<MsgBlock> msg = currClient->MsgSendingQueue.front();
-                Assert(msg != NULL);
 
-                const int nSentBytes = send(currClient->hSocket, &msg->Msg[currClient->SendMsgBlockCursor], msg->MsgLen - currClient->SendMsgBlockCursor, 0);
-                if (UNLIKELY(nSentBytes == -1))
+                if (currClient->MsgSendingQueue.empty())
                 {
-                    logErrorCode(IRC_FAILED_TO_SEND_SOCKET);
-                    EIrcErrorCode err = forceDisconnectClient(currClient, "Failed to send message to client.");
-                    if (UNLIKELY(err != IRC_SUCCESS))
+                    // Send the last partial segment held by the cork.
+                    if (currClient->bSendCorked)
                     {
-                        return err;
+                        SetTcpCork(currClient->hSocket, false);
+                        currClient->bSendCorked = false;
+                    }
+
+                    // Close the expired client connection after sending all messages. (See disconnectClient() for details)
+                    if (currClient->bExpired)
+                    {
+                        EIrcErrorCode err = forceDisconnectClient(currClient);
+                        if (UNLIKELY(err != IRC_SUCCESS))
+                        {
+                            return err;
+                        }
                     }
                     continue;
                 }
-                // Maybe the client's receive window is full.
-                if (nSentBytes == 0)
+
+                // Each request is linked to the next one to keep the order. (See IoUringEventQueue::SubmitSend())
+                const size_t numSends = std::min(currClient->MsgSendingQueue.size(), static_cast<size_t>(NUM_CLIENT_SEND_REQUEST_CHAIN_MAX));
+
+                // A request sends a message block, so the blocks would be separate segments. (See [ \ref irc_server_output_batching ])
+                if (numSends > 1 && !currClient->bSendCorked)
                 {
-                    continue;
+                    currClient->bSendCorked = SetTcpCork(currClient->hSocket, true);
+                }
+                for (size_t i = 0; i < numSends; i++)
+                {
+                    const SharedPtr<MsgBlock>& msg = currClient->MsgSendingQueue[i];
+                    const size_t cursor = (i == 0) ? currClient->SendMsgBlockCursor : 0;
+                    reactor.Events.SubmitSend(currClient->hSocket, currEvent.udata, &msg->Msg[cursor], msg->MsgLen - cursor, i + 1 < numSends);
+                }
+
+                // The completion reports the bytes of the submitted length, so the submitted page must not grow. (See [ \ref irc_server_reply_coalescing ])
+                if (numSends == currClient->MsgSendingQueue.size())
+                {
+                    currClient->bSendQueueTailOwned = false;
+                }
+                currClient->NumInFlightSends += numSends;
+                currClient->NumPendingIoRequests += numSends;
+                continue;
+#endif
+
+                // Send the messages in the sending queue
+                schedulePendingSend(reactor, currClient);
+            }
+
+        } // for (int eventIdx = 0; eventIdx < observedEventNum; eventIdx++)
+
+        // Deadlines of the clients. The PINGs are sent with the other messages below.
+        EIrcErrorCode timerErr = processExpiredClientTimers(reactor);
+        if (UNLIKELY(timerErr != IRC_SUCCESS))
+        {
+            return timerErr;
+        }
+
+        // The histogram of the interval. (See [ \ref irc_server_dispatch_latency ])
+        if ((mConfig.BusyPollMicrosec != 0 || mConfig.bLatencyHistogram) && currentTickTime >= reactor.LatencyReportTime)
+        {
+            logLatencyReport(reactor);
+            reactor.DispatchLatency.Reset();
+            reactor.LatencyReportTime = currentTickTime + LATENCY_REPORT_INTERVAL * static_cast<uint64_t>(MICROSEC_PER_SEC);
+        }
+
+#if !defined(IRC_EVENT_BACKEND_IO_URING)
+        // Messages queued to the idle clients of this reactor in this tick.
+        for (size_t i = 0; i < reactor.InlineSendClients.size(); i++)
+        {
+            schedulePendingSend(reactor, reactor.InlineSendClients[i]);
+        }
+        reactor.InlineSendClients.clear();
+#endif
+
+        if (reactor.PendingSends.empty())
+        {
+            continue;
+        }
+
+        // Send the messages without the lock. (See [ \ref irc_server_multi_reactor ])
+        // Only this reactor closes the socket of the client, so it is still valid.
+        pthread_mutex_unlock(&mStateLock);
+        for (size_t sendIdx = 0; sendIdx < reactor.PendingSends.size(); sendIdx++)
+        {
+            ReactorControlBlock::PendingSend& pendingSend = reactor.PendingSends[sendIdx];
+            if (pendingSend.Client->bSocketClosed)
+            {
+                continue;
+            }
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+            if (pendingSend.bZeroCopy)
+            {
+                struct msghdr msg;
+                std::memset(&msg, 0, sizeof(msg));
+                msg.msg_iov    = &reactor.SendIovecs[pendingSend.IovecIdx];
+                msg.msg_iovlen = pendingSend.NumIovecs;
+                pendingSend.nSentBytes = sendmsg(pendingSend.Client->hSocket, &msg, MSG_ZEROCOPY);
+
+                // Out of the socket option memory for the notification. Copy this one.
+                if (pendingSend.nSentBytes == -1 && errno == ENOBUFS)
+                {
+                    pendingSend.bZeroCopy = false;
+                    reactor.NumZeroCopyFallbacks++;
                 }
+            }
+            if (!pendingSend.bZeroCopy)
+            {
+                pendingSend.nSentBytes = writev(pendingSend.Client->hSocket, &reactor.SendIovecs[pendingSend.IovecIdx], static_cast<int>(pendingSend.NumIovecs));
+            }
+#else
+            pendingSend.nSentBytes = writev(pendingSend.Client->hSocket, &reactor.SendIovecs[pendingSend.IovecIdx], static_cast<int>(pendingSend.NumIovecs));
+#endif
+            if (pendingSend.nSentBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                pendingSend.nSentBytes = 0;
+            }
+        }
+        pthread_mutex_lock(&mStateLock);
+        mLockedTickTime = reactor.TickTime;
+
+        for (size_t sendIdx = 0; sendIdx < reactor.PendingSends.size(); sendIdx++)
+        {
+            SharedPtr<ClientControlBlock> currClient = reactor.PendingSends[sendIdx].Client;
+            const ssize_t nSentBytes = reactor.PendingSends[sendIdx].nSentBytes;
+            currClient->bSendScheduled = false;
 
-                logVerbose("Sent message to client. IP: " + InetAddrToString(currClient->Addr) + ", Nick: " + currClient->Nickname + ", Sent bytes: " + ValToString(nSentBytes));
+            if (currClient->bSocketClosed)
+            {
+                continue;
+            }
 
-                // Update send cursor of the client
-                currClient->SendMsgBlockCursor += nSentBytes;
-                if (currClient->SendMsgBlockCursor >= msg->MsgLen)
+            if (UNLIKELY(nSentBytes == -1))
+            {
+                logErrorCode(IRC_FAILED_TO_SEND_SOCKET);
+                EIrcErrorCode err = forceDisconnectClient(currClient, "Failed to send message to client.");
+                if (UNLIKELY(err != IRC_SUCCESS))
                 {
-                    currClient->MsgSendingQueue.pop();
-                    currClient->SendMsgBlockCursor = 0;
+                    return err;
                 }
+                continue;
+            }
 
-                // EVFILTER_WRITE filter should be disabled after sending all messages.
-                if (currClient->MsgSendingQueue.empty())
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+            if (reactor.PendingSends[sendIdx].bZeroCopy && nSentBytes > 0)
+            {
+                holdZeroCopyMsgBlocks(reactor, reactor.PendingSends[sendIdx]);
+            }
+#endif
+
+            // Update send cursor of the client. A partial write can end in the middle of any gathered block.
+            // 0 byte is sent if the client's receive window is full.
+            const size_t nSentMsgBlocks = advanceSendCursor(currClient, static_cast<size_t>(nSentBytes));
+            reactor.NumSendCalls++;
+            reactor.NumSentMsgBlocks += nSentMsgBlocks;
+
+#ifdef IRC_VERBOSE_LOG
+            if (nSentBytes > 0)
+            {
+                logVerbose("Sent message to client. IP: " + InetAddrToString(currClient->Addr) + ", Nick: " + currClient->Nickname + ", Sent bytes: " + ValToString(nSentBytes) + ", Sent blocks: " + ValToString(nSentMsgBlocks));
+            }
+#endif
+
+            if (!currClient->MsgSendingQueue.empty())
+            {
+                // Arm the write event filter for the remainder.
+                // An edge-triggered filter is re-armed after a full write too, because the socket may still be writable.
+                const bool bFullWrite = (static_cast<size_t>(nSentBytes) == reactor.PendingSends[sendIdx].NumBytes);
+                if (!currClient->bWriteFilterArmed || (mConfig.bEdgeTriggered && bFullWrite))
                 {
-                    // Close the expired client connection after sending all messages. (See disconnectClient() for details)
-                    if (currClient->bExpired)
-                    {
-                        forceDisconnectClient(currClient);
-                    }
-                    else
+                    queueClientEvent(reactor, currClient, EventQueue::FILTER_WRITE, mConfig.bEdgeTriggered ? EventQueue::FLAG_ENABLE : EventQueue::FLAG_ADD);
+                    currClient->bWriteFilterArmed = true;
+                }
+            }
+
+            // EVFILTER_WRITE filter should be disabled after sending all messages.
+            else
+            {
+                // Close the expired client connection after sending all messages. (See disconnectClient() for details)
+                if (currClient->bExpired)
+                {
+                    EIrcErrorCode err = forceDisconnectClient(currClient);
+                    if (UNLIKELY(err != IRC_SUCCESS))
                     {
-                        kevent_t kev;
-                        kev.ident = currClient->hSocket;
-                        kev.filter = EVFILT_WRITE;
-                        kev.flags = EV_DELETE;
-                        kev.fflags = 0;
-                        kev.data = 0;
-                        kev.udata = reinterpret_cast<void *>(currClient.GetControlBlock());
-
-                        mEventRegistrationQueue.push_back(kev);
+                        return err;
                     }
                 }
-
+                // An edge-triggered filter is not observed again until it is re-armed, so it is left enabled.
+                else if (currClient->bWriteFilterArmed && !mConfig.bEdgeTriggered)
+                {
+                    queueClientEvent(reactor, currClient, EventQueue::FILTER_WRITE, EventQueue::FLAG_DELETE);
+                    currClient->bWriteFilterArmed = false;
+                }
             }
-
-        } // for (int eventIdx = 0; eventIdx < observedEventNum; eventIdx++)
+        }
+        reactor.PendingSends.clear();
+        reactor.SendIovecs.clear();
+        reactor.SendMsgBlockRefs.clear();
 
     } // while (true)
 
@@ -436,59 +1265,655 @@ EIrcErrorCode Server::eventLoop()
     return IRC_FAILED_UNREACHABLE_CODE;
 }
 
-EIrcErrorCode Server::destroyResources()
+EIrcErrorCode Server::destroyResources()
+{
+    // Server is already crashed with an error, and therefore we can't guarantee the resources are properly released.
+    // So, we don't handle the error of release.
+
+    // Close sockets
+    // Clients and message blocks are will be released automatically by SharedPtr.
+    for (size_t i = 0; i < mUnregistedClients.size(); i++)
+    {
+        if (!mUnregistedClients[i]->bSocketClosed)
+        {
+            close(mUnregistedClients[i]->hSocket);
+            mUnregistedClients[i]->bSocketClosed = true;
+        }
+    }
+    for (std::map< std::string, SharedPtr< ClientControlBlock > >::iterator it = mClients.begin(); it != mClients.end(); ++it)
+    {
+        if (!it->second->bSocketClosed)
+        {
+            close(it->second->hSocket);
+            it->second->bSocketClosed = true;
+        }
+    }
+
+    for (size_t reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        ReactorControlBlock* reactor = mReactors[reactorIdx];
+        reactor->Events.Destroy();
+        if (reactor->hListenSocket != -1)
+        {
+            close(reactor->hListenSocket);
+            reactor->hListenSocket = -1;
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            if (reactor->hWakeupSockets[i] != -1)
+            {
+                close(reactor->hWakeupSockets[i]);
+                reactor->hWakeupSockets[i] = -1;
+            }
+        }
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+        // The sockets of the deferred clients are closed at the release. (See forceDisconnectClient())
+        for (size_t i = 0; i < reactor->ClientReleaseQueue.size(); i++)
+        {
+            close(reactor->ClientReleaseQueue[i]->hSocket);
+        }
+#endif
+    }
+
+    if (mhReserveFd != -1)
+    {
+        close(mhReserveFd);
+        mhReserveFd = -1;
+    }
+
+    // Release clients
+    // The clients and message blocks are will be released automatically by SharedPtr.
+    mUnregistedClients.clear();
+    mClients.clear();
+    mNumClients = 0;
+    for (size_t reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        delete mReactors[reactorIdx];
+    }
+    mReactors.clear();
+
+    // TODO: memory check for memory pool
+
+    return IRC_SUCCESS;
+}
+
+void Server::suspendListening(ReactorControlBlock& reactor)
+{
+    if (reactor.bListenSuspended)
+    {
+        return;
+    }
+
+    EventQueue::Event kev;
+    EventQueue::SetEvent(kev, reactor.hListenSocket, EventQueue::FILTER_ACCEPT, EventQueue::FLAG_DISABLE, NULL);
+    reactor.EventRegistrationQueue.push_back(kev);
+    reactor.bListenSuspended = true;
+    reactor.NumListenSuspensions++;
+
+    logMessage("Stopped accepting. Reactor: " + ValToString(reactor.Idx) + ", Clients: " + ValToString(mNumClients));
+}
+
+void Server::resumeListening()
+{
+    for (size_t reactorIdx = 0; reactorIdx < mReactors.size(); reactorIdx++)
+    {
+        ReactorControlBlock& reactor = *mReactors[reactorIdx];
+        if (!reactor.bListenSuspended)
+        {
+            continue;
+        }
+
+        EventQueue::Event kev;
+        EventQueue::SetEvent(kev, reactor.hListenSocket, EventQueue::FILTER_ACCEPT, EventQueue::FLAG_ENABLE, NULL);
+        reactor.EventRegistrationQueue.push_back(kev);
+        reactor.bListenSuspended = false;
+
+        if (!pthread_equal(reactor.hThread, pthread_self()))
+        {
+            wakeupReactor(reactor);
+        }
+    }
+}
+
+void Server::shedPendingConnection(ReactorControlBlock& reactor)
+{
+    if (mhReserveFd == -1)
+    {
+        return;
+    }
+
+    // Free the reserve descriptor for a moment to accept the connection and close it.
+    close(mhReserveFd);
+    const int hSocket = accept(reactor.hListenSocket, NULL, NULL);
+    if (hSocket != -1)
+    {
+        close(hSocket);
+        reactor.NumShedConnections++;
+    }
+    mhReserveFd = open("/dev/null", O_RDONLY);
+
+    logMessage("Out of file descriptors. Shed a pending connection. Reactor: " + ValToString(reactor.Idx) + ", Clients: " + ValToString(mNumClients));
+}
+
+void Server::setupClientSocket(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
+{
+    Assert(client->ReactorIdx == reactor.Idx);
+
+    const int hSocket = client->hSocket;
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    client->bZeroCopyEnabled = (mConfig.ZeroCopyThreshold != 0 && EnableZeroCopy(hSocket));
+#endif
+    // The replies are batched by the tick instead. (See [ \ref irc_server_output_batching ])
+    if (mConfig.bTcpNoDelay)
+    {
+        SetTcpNoDelay(hSocket, true);
+    }
+    if (mConfig.BusyPollMicrosec != 0)
+    {
+        SetBusyPoll(hSocket, mConfig.BusyPollMicrosec);
+    }
+#if defined(IRC_RECV_TIMESTAMP_SUPPORTED)
+    if (mConfig.bLatencyHistogram)
+    {
+        EnableRecvTimestamp(hSocket);
+    }
+#endif
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    client->NumPendingIoRequests = 1; //< Multishot recv request registered below
+#endif
+
+    // Add to the kqueue registration queue.
+    // With pass the controlBlock of SharedPtr to the udata member of kevent.
+    // See ReactorControlBlock::Events for details.
+    if (mConfig.bEdgeTriggered)
+    {
+        // The WRITE filter stays registered and is re-armed when a message is queued. (See sendMsgToClient())
+        queueClientEvent(reactor, client, EventQueue::FILTER_READ, EventQueue::FLAG_ADD | EventQueue::FLAG_CLEAR);
+        queueClientEvent(reactor, client, EventQueue::FILTER_WRITE, EventQueue::FLAG_ADD | EventQueue::FLAG_CLEAR | EventQueue::FLAG_DISABLE);
+    }
+    else
+    {
+        queueClientEvent(reactor, client, EventQueue::FILTER_READ, EventQueue::FLAG_ADD);
+    }
+}
+
+void Server::appendRecvBytesToClient(SharedPtr<ClientControlBlock> client, const char* bytes, const size_t numBytes)
+{
+    Assert(client != NULL);
+    Assert(bytes != NULL);
+
+    size_t nCopiedBytes = 0;
+    while (nCopiedBytes < numBytes)
+    {
+        if (client->RecvMsgBlocks.empty() || client->RecvMsgBlocks.back()->MsgLen == MESSAGE_LEN_MAX)
+        {
+            client->RecvMsgBlocks.push_back(MakeShared<MsgBlock>());
+        }
+
+        SharedPtr<MsgBlock> recvMsgBlock = client->RecvMsgBlocks.back();
+        const size_t nCopyBytes = std::min(numBytes - nCopiedBytes, static_cast<size_t>(MESSAGE_LEN_MAX - recvMsgBlock->MsgLen));
+        std::memcpy(&recvMsgBlock->Msg[recvMsgBlock->MsgLen], &bytes[nCopiedBytes], nCopyBytes);
+        recvMsgBlock->MsgLen += nCopyBytes;
+        nCopiedBytes += nCopyBytes;
+    }
+}
+
+void Server::scheduleClientTimer(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const uint64_t deadline)
+{
+    Assert(client->DeadlineTimer.Owner == reinterpret_cast<void*>(client.GetControlBlock()));
+
+    // Round up, so that the timer does not expire before the deadline.
+    reactor.ClientTimers.Schedule(client->DeadlineTimer, (deadline + CLIENT_TIMER_TICK_MICROSEC - 1) / CLIENT_TIMER_TICK_MICROSEC);
+}
+
+EIrcErrorCode Server::processExpiredClientTimers(ReactorControlBlock& reactor)
+{
+    reactor.ExpiredClientTimers.clear();
+    reactor.NumExpiredTimers += reactor.ClientTimers.Advance(reactor.TickTime / CLIENT_TIMER_TICK_MICROSEC, reactor.ExpiredClientTimers);
+
+    // The clients are alive until the next tick even if they are disconnected by the handler of another client. (See ClientReleaseQueue)
+    for (size_t i = 0; i < reactor.ExpiredClientTimers.size(); i++)
+    {
+        EIrcErrorCode err = handleClientTimer(reactor, getClientFromTimerOwner(reactor.ExpiredClientTimers[i]));
+        if (UNLIKELY(err != IRC_SUCCESS))
+        {
+            return err;
+        }
+    }
+    return IRC_SUCCESS;
+}
+
+EIrcErrorCode Server::handleClientTimer(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
+{
+    if (client->bSocketClosed)
+    {
+        return IRC_SUCCESS;
+    }
+
+    // The remaining messages are not sent until the deadline. (See disconnectClient())
+    if (client->bExpired)
+    {
+        reactor.NumTimedOutClients++;
+        return forceDisconnectClient(client);
+    }
+
+    // The first deadline of a client is the registration.
+    if (!client->bRegistered)
+    {
+        reactor.NumTimedOutClients++;
+        return forceDisconnectClient(client, "Registration timeout");
+    }
+
+    // Any message received after the PING is the reply.
+    if (client->PingSentTime != 0)
+    {
+        if (client->LastActiveTime <= client->PingSentTime)
+        {
+            reactor.NumTimedOutClients++;
+            return forceDisconnectClient(client, "Ping timeout");
+        }
+        client->PingSentTime = 0;
+    }
+
+    // Received in the idle time. The timer is moved here instead of on every receive.
+    const uint64_t idleDeadline = client->LastActiveTime + CLIENT_TIMEOUT * static_cast<uint64_t>(MICROSEC_PER_SEC);
+    if (reactor.TickTime < idleDeadline)
+    {
+        scheduleClientTimer(reactor, client, idleDeadline);
+        return IRC_SUCCESS;
+    }
+
+    client->PingSentTime = reactor.TickTime;
+    reactor.NumSentPings++;
+    sendMsgToClient(client, MakeShared<MsgBlock>("PING :" + mServerName));
+
+    // A slow link has time to reply. (See [ \ref irc_server_keepalive ])
+    const uint64_t pingTimeout = std::max(CLIENT_PING_TIMEOUT * static_cast<uint64_t>(MICROSEC_PER_SEC), client->SmoothedRttMicrosec * 4);
+    scheduleClientTimer(reactor, client, reactor.TickTime + pingTimeout);
+    return IRC_SUCCESS;
+}
+
+void Server::replyPing(SharedPtr<ClientControlBlock> client, const char* token)
+{
+    sendMsgToClient(client, MakeShared<MsgBlock>(":" + mServerName + " PONG " + mServerName + " :" + token));
+}
+
+void Server::receivePong(SharedPtr<ClientControlBlock> client)
+{
+    // Not a reply of the server's PING.
+    if (client->PingSentTime == 0)
+    {
+        return;
+    }
+
+    // The time of the tick that received the PONG, not the time that it is processed. (See [ \ref irc_server_msg_process_scheduling ])
+    const uint64_t rtt = (client->LastActiveTime > client->PingSentTime) ? client->LastActiveTime - client->PingSentTime : 0;
+    client->RttMicrosec = rtt;
+    client->SmoothedRttMicrosec = (client->SmoothedRttMicrosec == 0) ? rtt : (client->SmoothedRttMicrosec * 7 + rtt) / 8;
+    client->PingSentTime = 0;
+}
+
+bool Server::processKeepaliveMsgFastPath(SharedPtr<ClientControlBlock> client, const MsgView& msg)
+{
+    // Same as the command functions. PING/PONG are accepted before the registration, but not from an expired client.
+    if (client->bExpired)
+    {
+        return true;
+    }
+
+    char* const msgStr = msg.GetMsg();
+    const size_t msgLen = msg.Len;
+
+    // "PING <token>" or "PONG <token>". The command is 4 characters and a blank.
+    const size_t COMMAND_LEN = 4;
+    if (msgLen <= COMMAND_LEN + 1 || msgStr[0] != 'P' || msgStr[COMMAND_LEN] != ' ')
+    {
+        return false;
+    }
+
+    const bool bPing = (std::memcmp(msgStr, "PING", COMMAND_LEN) == 0);
+    if (!bPing && std::memcmp(msgStr, "PONG", COMMAND_LEN) != 0)
+    {
+        return false;
+    }
+
+    size_t tokenIdx = COMMAND_LEN + 1;
+    for (; tokenIdx < msgLen && msgStr[tokenIdx] == ' '; tokenIdx++)
+    {
+    }
+    if (tokenIdx < msgLen && msgStr[tokenIdx] == ':')
+    {
+        tokenIdx++;
+    }
+    if (tokenIdx >= msgLen)
+    {
+        return false;
+    }
+
+    if (bPing)
+    {
+        // The token is the first parameter, or the trailing parameter as is.
+        const bool bTrailing = (msgStr[tokenIdx - 1] == ':');
+        size_t tokenEnd = tokenIdx;
+        for (; tokenEnd < msgLen && (bTrailing || msgStr[tokenEnd] != ' '); tokenEnd++)
+        {
+        }
+
+        // The token is terminated in place at a blank or at the CR, which a view keeps in its block. (See separateMsgsFromClientRecvMsgs())
+        Assert(tokenEnd < msgLen + CRLF_LEN_2);
+        Assert(msgStr[tokenEnd] == ' ' || msgStr[tokenEnd] == '\r');
+        msgStr[tokenEnd] = '\0';
+        replyPing(client, &msgStr[tokenIdx]);
+    }
+    else
+    {
+        receivePong(client);
+    }
+    return true;
+}
+
+void Server::queueClientEvent(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const short filter, const unsigned short flags)
+{
+    Assert(filter == EventQueue::FILTER_READ || filter == EventQueue::FILTER_WRITE);
+    Assert(flags != 0);
+
+    std::vector<EventQueue::Event>& eventRegistrationQueue = reactor.EventRegistrationQueue;
+
+    // The indices of the registrations taken by the last Wait() are not valid.
+    if (client->QueuedEventTick != reactor.NumTicks)
+    {
+        client->QueuedEventTick = reactor.NumTicks;
+        client->QueuedEventIdx[0] = ClientControlBlock::INVALID_INDEX;
+        client->QueuedEventIdx[1] = ClientControlBlock::INVALID_INDEX;
+    }
+
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    // Each READ registration submits or cancels a counted recv request. (See setClientRecvPaused())
+    if (filter == EventQueue::FILTER_READ)
+    {
+        EventQueue::Event kev;
+        EventQueue::SetEvent(kev, client->hSocket, filter, flags, reinterpret_cast<void*>(client.GetControlBlock()));
+        eventRegistrationQueue.push_back(kev);
+        return;
+    }
+#endif
+
+    size_t& queuedIdx = client->QueuedEventIdx[(filter == EventQueue::FILTER_READ) ? 0 : 1];
+    if (queuedIdx != ClientControlBlock::INVALID_INDEX)
+    {
+        EventQueue::Event& queued = eventRegistrationQueue[queuedIdx];
+        Assert(queued.udata == reinterpret_cast<void*>(client.GetControlBlock()) && queued.filter == filter);
+
+        // The opposite registrations leave the filter as it was. Both are canceled.
+        // An edge-triggered enable is not canceled by a previous disable, because it re-arms the filter.
+        const unsigned short queuedFlags = queued.flags;
+        if (((queuedFlags & EventQueue::FLAG_ADD) && flags == EventQueue::FLAG_DELETE)
+            || (queuedFlags == EventQueue::FLAG_DELETE && flags == EventQueue::FLAG_ADD)
+            || ((queuedFlags & ~EventQueue::FLAG_CLEAR) == EventQueue::FLAG_ENABLE && flags == EventQueue::FLAG_DISABLE)
+            || (queuedFlags == EventQueue::FLAG_DISABLE && flags == EventQueue::FLAG_ENABLE))
+        {
+            queued.flags = 0;
+            reactor.NumCanceledRegistrations++;
+            reactor.NumCoalescedRegistrations += 2;
+            queuedIdx = ClientControlBlock::INVALID_INDEX;
+            return;
+        }
+
+        // An enable or a disable after the add is applied to the add.
+        if ((queuedFlags & EventQueue::FLAG_ADD) && (flags & ~EventQueue::FLAG_CLEAR) == EventQueue::FLAG_ENABLE)
+        {
+            queued.flags = queuedFlags & ~EventQueue::FLAG_DISABLE;
+            reactor.NumCoalescedRegistrations++;
+            return;
+        }
+        if ((queuedFlags & EventQueue::FLAG_ADD) && flags == EventQueue::FLAG_DISABLE)
+        {
+            queued.flags = queuedFlags | EventQueue::FLAG_DISABLE;
+            reactor.NumCoalescedRegistrations++;
+            return;
+        }
+
+        // Same one is pending.
+        if (queuedFlags == flags)
+        {
+            reactor.NumCoalescedRegistrations++;
+            return;
+        }
+    }
+
+    EventQueue::Event kev;
+    EventQueue::SetEvent(kev, client->hSocket, filter, flags, reinterpret_cast<void*>(client.GetControlBlock()));
+    eventRegistrationQueue.push_back(kev);
+    queuedIdx = eventRegistrationQueue.size() - 1;
+}
+
+void Server::cancelQueuedClientEvents(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
+{
+    if (client->QueuedEventTick != reactor.NumTicks)
+    {
+        return;
+    }
+
+    // The READ registrations of the io_uring backend are not tracked. The recv request is done right away on the shut down socket.
+    for (size_t filterIdx = 0; filterIdx < 2; filterIdx++)
+    {
+        size_t& queuedIdx = client->QueuedEventIdx[filterIdx];
+        if (queuedIdx != ClientControlBlock::INVALID_INDEX)
+        {
+            reactor.EventRegistrationQueue[queuedIdx].flags = 0;
+            reactor.NumCanceledRegistrations++;
+            queuedIdx = ClientControlBlock::INVALID_INDEX;
+        }
+    }
+}
+
+void Server::setClientRecvPaused(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const bool bPaused)
+{
+    Assert(client->ReactorIdx == reactor.Idx);
+    Assert(client->bRecvPaused != bPaused);
+
+    // An edge-triggered filter is enabled with FLAG_CLEAR to keep the trigger mode, and it is re-armed by the enable.
+    const unsigned short flags = bPaused ? EventQueue::FLAG_DISABLE : (EventQueue::FLAG_ENABLE | (mConfig.bEdgeTriggered ? EventQueue::FLAG_CLEAR : 0));
+    queueClientEvent(reactor, client, EventQueue::FILTER_READ, flags);
+    client->bRecvPaused = bPaused;
+
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    // The multishot recv request is canceled by the disable, and a new one is submitted by the enable.
+    if (!bPaused)
+    {
+        client->NumPendingIoRequests++;
+    }
+#endif
+
+    if (bPaused)
+    {
+        reactor.NumRecvPauses++;
+#ifdef IRC_VERBOSE_LOG
+        logVerbose("Paused receiving from client. IP: " + InetAddrToString(client->Addr) + ", Nick: " + client->Nickname + ", Pending message blocks: " + ValToString(client->RecvMsgBlocks.size()));
+#endif
+    }
+}
+
+void Server::schedulePendingSend(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
 {
-    // Server is already crashed with an error, and therefore we can't guarantee the resources are properly released.
-    // So, we don't handle the error of release.
+    Assert(client != NULL);
+    Assert(client->ReactorIdx == reactor.Idx);
 
-    // Close sockets
-    // Clients and message blocks are will be released automatically by SharedPtr.
-    if (mhKqueue != -1)
+    if (client->bSocketClosed || client->bSendScheduled || client->MsgSendingQueue.empty())
     {
-        close(mhKqueue);
-        mhKqueue = -1;
+        return;
     }
-    if (mhListenSocket != -1)
+    client->bSendScheduled = true;
+
+    // Gather the message blocks in the sending queue to send them with a writev() without the lock.
+    ReactorControlBlock::PendingSend pendingSend;
+    pendingSend.Client     = client;
+    pendingSend.IovecIdx   = reactor.SendIovecs.size();
+    pendingSend.NumIovecs  = std::min(client->MsgSendingQueue.size(), static_cast<size_t>(NUM_CLIENT_SEND_IOVEC_MAX));
+    pendingSend.NumBytes   = 0;
+    pendingSend.nSentBytes = 0;
+    pendingSend.bZeroCopy  = false;
+    for (size_t i = 0; i < pendingSend.NumIovecs; i++)
     {
-        close(mhListenSocket);
-        mhListenSocket = -1;
+        const SharedPtr<MsgBlock>& msg = client->MsgSendingQueue[i];
+        Assert(msg != NULL);
+        const size_t cursor = (i == 0) ? client->SendMsgBlockCursor : 0;
+
+        struct iovec iov;
+        iov.iov_base = &msg->Msg[cursor];
+        iov.iov_len  = msg->MsgLen - cursor;
+        reactor.SendIovecs.push_back(iov);
+        reactor.SendMsgBlockRefs.push_back(msg);
+        pendingSend.NumBytes += iov.iov_len;
     }
-    for (size_t i = 0; i < mUnregistedClients.size(); i++)
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    // Pinning the pages and the notification cost more than a copy of a few blocks. (See [ \ref irc_server_zerocopy ])
+    pendingSend.bZeroCopy = client->bZeroCopyEnabled
+                            && pendingSend.NumBytes >= mConfig.ZeroCopyThreshold
+                            && client->InFlightZeroCopySends.size() < NUM_CLIENT_ZEROCOPY_SEND_MAX;
+#endif
+    reactor.PendingSends.push_back(pendingSend);
+}
+
+size_t Server::advanceSendCursor(SharedPtr<ClientControlBlock> client, size_t nSentBytes)
+{
+    Assert(client != NULL);
+
+    size_t nSentMsgBlocks = 0;
+    client->NumTotalSentBytes += nSentBytes;
+    while (nSentBytes > 0 && !client->MsgSendingQueue.empty())
     {
-        if (!mUnregistedClients[i]->bSocketClosed)
+        const size_t nRemainBytes = client->MsgSendingQueue.front()->MsgLen - client->SendMsgBlockCursor;
+        if (nSentBytes < nRemainBytes)
         {
-            close(mUnregistedClients[i]->hSocket);
-            mUnregistedClients[i]->bSocketClosed = true;
+            client->SendMsgBlockCursor += nSentBytes;
+            client->NumSendingQueueBytes -= nSentBytes;
+            break;
         }
+        nSentBytes -= nRemainBytes;
+        client->NumSendingQueueBytes -= nRemainBytes;
+        client->MsgSendingQueue.pop_front();
+        client->SendMsgBlockCursor = 0;
+        nSentMsgBlocks++;
     }
-    for (std::map< std::string, SharedPtr< ClientControlBlock > >::iterator it = mClients.begin(); it != mClients.end(); ++it)
+
+    // The wait time of the sampled messages whose last byte is sent, in the resolution of a tick. (See [ \ref irc_server_send_lanes ])
+    ReactorControlBlock& reactor = *mReactors[client->ReactorIdx];
+    for (int lane = 0; lane < NUM_SEND_LANES; lane++)
     {
-        if (!it->second->bSocketClosed)
+        if (client->LaneSampleEndOffset[lane] != 0 && client->LaneSampleEndOffset[lane] <= client->NumTotalSentBytes)
         {
-            close(it->second->hSocket);
-            it->second->bSocketClosed = true;
+            const uint64_t waitTime = (reactor.TickTime > client->LaneSampleQueuedTime[lane]) ? reactor.TickTime - client->LaneSampleQueuedTime[lane] : 0;
+            reactor.NumLaneWaitSamples[lane]++;
+            reactor.LaneWaitSumMicrosec[lane] += waitTime;
+            reactor.LaneWaitMaxMicrosec[lane] = std::max(reactor.LaneWaitMaxMicrosec[lane], waitTime);
+            client->LaneSampleEndOffset[lane] = 0;
         }
     }
 
-    // Release clients
-    // The clients and message blocks are will be released automatically by SharedPtr.
-    mUnregistedClients.clear();
-    mClients.clear();
-    mEventRegistrationQueue.clear();
-    mClientReleaseQueue.clear();
+    // Move the bulk lane to the sending queue as it gets short.
+    while (client->BulkMsgQueueHead < client->BulkMsgQueue.size() && client->MsgSendingQueue.size() < NUM_CLIENT_SEND_BULK_WINDOW)
+    {
+        const ClientControlBlock::BulkMsg& bulkMsg = client->BulkMsgQueue[client->BulkMsgQueueHead];
+        pushToSendingQueue(client, bulkMsg.Msg, bulkMsg.QueuedTime, SEND_LANE_BULK);
+        client->BulkMsgQueue[client->BulkMsgQueueHead].Msg = NULL;
+        client->BulkMsgQueueHead++;
+    }
+    if (client->BulkMsgQueueHead == client->BulkMsgQueue.size())
+    {
+        client->BulkMsgQueue.clear();
+        client->BulkMsgQueueHead = 0;
+    }
+    else if (client->BulkMsgQueueHead * 2 > client->BulkMsgQueue.size())
+    {
+        client->BulkMsgQueue.erase(client->BulkMsgQueue.begin(), client->BulkMsgQueue.begin() + client->BulkMsgQueueHead);
+        client->BulkMsgQueueHead = 0;
+    }
+    return nSentMsgBlocks;
+}
 
-    // TODO: memory check for memory pool
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+void Server::holdZeroCopyMsgBlocks(ReactorControlBlock& reactor, const ReactorControlBlock::PendingSend& pendingSend)
+{
+    SharedPtr<ClientControlBlock> client = pendingSend.Client;
+    Assert(pendingSend.bZeroCopy && pendingSend.nSentBytes > 0);
 
-    return IRC_SUCCESS;
+    // The blocks the sent bytes are read from. The last one can be sent partially.
+    size_t numMsgBlocks = 0;
+    size_t nRemainBytes = static_cast<size_t>(pendingSend.nSentBytes);
+    while (nRemainBytes > 0)
+    {
+        Assert(numMsgBlocks < pendingSend.NumIovecs);
+        const struct iovec& iov = reactor.SendIovecs[pendingSend.IovecIdx + numMsgBlocks];
+        client->ZeroCopyMsgBlocks.push_back(reactor.SendMsgBlockRefs[pendingSend.IovecIdx + numMsgBlocks]);
+        nRemainBytes -= std::min(nRemainBytes, iov.iov_len);
+        numMsgBlocks++;
+    }
+
+    // The kernel counts the successful sends only.
+    ClientControlBlock::ZeroCopySend zeroCopySend;
+    zeroCopySend.Seq          = client->NextZeroCopySeq++;
+    zeroCopySend.NumMsgBlocks = numMsgBlocks;
+    client->InFlightZeroCopySends.push_back(zeroCopySend);
+    reactor.NumZeroCopySends++;
+}
+
+bool Server::reapZeroCopySends(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
+{
+    Assert(client->bZeroCopyEnabled && !client->bSocketClosed);
+
+    uint32_t lastDoneSeq = 0;
+    size_t numCopied = 0;
+    const int numDone = ReapZeroCopyCompletions(client->hSocket, lastDoneSeq, numCopied);
+    reactor.NumZeroCopyCopiedSends += numCopied;
+    if (numDone > 0)
+    {
+        // The sequence number wraps around.
+        while (!client->InFlightZeroCopySends.empty() && static_cast<int32_t>(client->InFlightZeroCopySends.front().Seq - lastDoneSeq) <= 0)
+        {
+            for (size_t i = 0; i < client->InFlightZeroCopySends.front().NumMsgBlocks; i++)
+            {
+                client->ZeroCopyMsgBlocks.pop_front();
+            }
+            client->InFlightZeroCopySends.pop_front();
+        }
+    }
+
+    int socketError = 0;
+    socklen_t socketErrorLen = sizeof(socketError);
+    if (numDone == -1 || getsockopt(client->hSocket, SOL_SOCKET, SO_ERROR, &socketError, &socketErrorLen) == -1)
+    {
+        return false;
+    }
+    return socketError == 0;
+}
+
+void Server::lingerZeroCopyMsgBlocks(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client)
+{
+    std::vector< SharedPtr<MsgBlock> >& lingeringMsgBlocks = reactor.LingeringZeroCopyMsgBlocks[0];
+    lingeringMsgBlocks.insert(lingeringMsgBlocks.end(), client->ZeroCopyMsgBlocks.begin(), client->ZeroCopyMsgBlocks.end());
+    client->ZeroCopyMsgBlocks.clear();
+    client->InFlightZeroCopySends.clear();
 }
+#endif
 
-EIrcErrorCode Server::separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBlock> client, std::vector< SharedPtr<MsgBlock> >& outSeparatedMsgs)
+EIrcErrorCode Server::separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBlock> client, std::vector<MsgView>& outSeparatedMsgs, const size_t maxNumMsgs)
 {
+    const size_t numPrevMsgs = outSeparatedMsgs.size();
+
     if (client->bExpired)
     {
         return IRC_SUCCESS;
     }
 
+    // The front message block is full and fully parsed. (The last message ended at the end of the block)
+    if (!client->RecvMsgBlocks.empty() && client->RecvMsgBlocks.front()->MsgLen == MESSAGE_LEN_MAX && client->RecvMsgBlockCursor >= MESSAGE_LEN_MAX)
+    {
+        client->RecvMsgBlocks.erase(client->RecvMsgBlocks.begin());
+        client->RecvMsgBlockCursor = 0;
+    }
+
     // Already processed all messages
     if (client->RecvMsgBlocks.empty() || client->RecvMsgBlockCursor >= client->RecvMsgBlocks.front()->MsgLen)
     {
@@ -502,67 +1927,111 @@ EIrcErrorCode Server::separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBloc
     }
 
     // Separate the messages from the message blocks based on "\r\n" separator
-    SharedPtr<MsgBlock> separatedMsg = MakeShared<MsgBlock>();
+    // The line feeds are found with the vector scanner. A message in a block is passed as a view into the block,
+    // and only a message straddling two blocks is copied. (See [ \ref irc_server_line_split ])
+    SharedPtr<MsgBlock> straddlingMsg;      //< The part of the message in the previous block, if it straddles the blocks
     size_t parseIdx = client->RecvMsgBlockCursor;
     size_t lastParsedRecvQueueBlockIdx = 0; //< For removing the fully parsed message blocks from the receive queue
     for (size_t msgBlockQueueIdx = 0; msgBlockQueueIdx < client->RecvMsgBlocks.size(); msgBlockQueueIdx++, parseIdx = 0)
     {
-        SharedPtr<MsgBlock> currMsgBlock = client->RecvMsgBlocks[msgBlockQueueIdx];
+        const SharedPtr<MsgBlock>& currMsgBlock = client->RecvMsgBlocks[msgBlockQueueIdx];
         Assert(currMsgBlock != NULL);
         Assert(currMsgBlock->MsgLen > 0);
         Assert(parseIdx < currMsgBlock->MsgLen || currMsgBlock->MsgLen == 0);
         Assert(currMsgBlock->MsgLen <= MESSAGE_LEN_MAX);
 
-        for (; parseIdx < currMsgBlock->MsgLen; parseIdx++)
+        size_t msgStartIdx = parseIdx; //< Start of the message in the current block
+        while (parseIdx < currMsgBlock->MsgLen)
         {
-            separatedMsg->Msg[separatedMsg->MsgLen] = currMsgBlock->Msg[parseIdx];
-            separatedMsg->MsgLen++;
+            const char* const segment = currMsgBlock->Msg + parseIdx;
+            const size_t lineFeedIdx = FindLineFeed(segment, currMsgBlock->MsgLen - parseIdx);
+            const bool bLineFeedFound = (parseIdx + lineFeedIdx < currMsgBlock->MsgLen);
+            const size_t segmentLen = bLineFeedFound ? lineFeedIdx + 1 : lineFeedIdx;
 
-            // Check the end of the message ("\r\n")
-            if (separatedMsg->MsgLen >= 2)
+            if (client->bSkippingRecvMsg)
             {
-                if (separatedMsg->Msg[separatedMsg->MsgLen - 2] == '\r' && separatedMsg->Msg[separatedMsg->MsgLen - 1] == '\n')
+                // Skip the invalid message until the separator "\r\n"
+                const char prevChar = (lineFeedIdx > 0) ? segment[lineFeedIdx - 1] : client->LastSkippedRecvChar;
+                if (bLineFeedFound && prevChar == '\r')
                 {
-                    outSeparatedMsgs.push_back(separatedMsg);
-                    separatedMsg = MakeShared<MsgBlock>();
-                    lastParsedRecvQueueBlockIdx = msgBlockQueueIdx;
-                    client->RecvMsgBlockCursor = parseIdx + 1;   
-                    continue;
+                    client->bSkippingRecvMsg = false;
                 }
+                client->LastSkippedRecvChar = segment[segmentLen - 1];
+                parseIdx += segmentLen;
+                msgStartIdx = parseIdx;
+                lastParsedRecvQueueBlockIdx = msgBlockQueueIdx;
+                client->RecvMsgBlockCursor = parseIdx;
+                continue;
             }
 
             // Skip the too long message
-            // The messages must be MESSAGE_LEN_MAX or less
-            if (separatedMsg->MsgLen == MESSAGE_LEN_MAX)
+            // The messages can be MESSAGE_LEN_MAX long with the separator. The NULL terminator is put at the place of the '\r'.
+            const size_t straddlingLen = (straddlingMsg != NULL) ? straddlingMsg->MsgLen : 0;
+            const size_t roomLen = MESSAGE_LEN_MAX - (straddlingLen + (parseIdx - msgStartIdx));
+            if (segmentLen > roomLen)
             {
-                // Skip the invalid message until the separator "\r\n"
-                char lastChar = separatedMsg->Msg[separatedMsg->MsgLen - 1];
-                for (; msgBlockQueueIdx < client->RecvMsgBlocks.size(); msgBlockQueueIdx++)
-                {
-                    currMsgBlock = client->RecvMsgBlocks[msgBlockQueueIdx];
-
-                    for (; parseIdx < currMsgBlock->MsgLen; parseIdx++)
-                    {
-                        if (lastChar == '\r' && currMsgBlock->Msg[parseIdx] == '\n')
-                        {
-                            lastParsedRecvQueueBlockIdx = msgBlockQueueIdx;
-                            client->RecvMsgBlockCursor = parseIdx + 1;
-                            separatedMsg = MakeShared<MsgBlock>();
+                client->bSkippingRecvMsg = true;
+                client->LastSkippedRecvChar = (roomLen > 0) ? segment[roomLen - 1]
+                                            : (parseIdx > msgStartIdx) ? currMsgBlock->Msg[parseIdx - 1]
+                                            : straddlingMsg->Msg[straddlingLen - 1];
+                straddlingMsg = NULL;
+                parseIdx += roomLen;
+                msgStartIdx = parseIdx;
+                lastParsedRecvQueueBlockIdx = msgBlockQueueIdx;
+                client->RecvMsgBlockCursor = parseIdx;
+                continue;
+            }
+            parseIdx += segmentLen;
 
-                            goto BREAK_SKIP_INVALID_MESSAGE;
-                        }
+            // Check the end of the message ("\r\n")
+            if (!bLineFeedFound)
+            {
+                continue;
+            }
+            const char prevChar = (parseIdx - msgStartIdx >= CRLF_LEN_2) ? currMsgBlock->Msg[parseIdx - CRLF_LEN_2]
+                                : (straddlingLen > 0) ? straddlingMsg->Msg[straddlingLen - 1]
+                                : '\0';
+            if (prevChar != '\r')
+            {
+                continue;
+            }
 
-                        lastChar = currMsgBlock->Msg[parseIdx];
-                    }
+            if (straddlingMsg == NULL)
+            {
+                outSeparatedMsgs.push_back(MsgView(currMsgBlock, msgStartIdx, parseIdx - msgStartIdx - CRLF_LEN_2));
+            }
+            else
+            {
+                std::memcpy(straddlingMsg->Msg + straddlingLen, currMsgBlock->Msg + msgStartIdx, parseIdx - msgStartIdx);
+                straddlingMsg->MsgLen += parseIdx - msgStartIdx;
+                outSeparatedMsgs.push_back(MsgView(straddlingMsg, 0, straddlingMsg->MsgLen - CRLF_LEN_2));
+                straddlingMsg = NULL;
+                mReactors[client->ReactorIdx]->NumCopiedMsgs++;
+            }
+            msgStartIdx = parseIdx;
+            lastParsedRecvQueueBlockIdx = msgBlockQueueIdx;
+            client->RecvMsgBlockCursor = parseIdx;
 
-                    parseIdx = 0;
-                }
-            BREAK_SKIP_INVALID_MESSAGE:;
+            // The rest is separated at the next call from the cursor.
+            if (outSeparatedMsgs.size() - numPrevMsgs == maxNumMsgs)
+            {
+                goto BREAK_MAX_NUM_MSGS;
             }
+        } // while (parseIdx < currMsgBlock->MsgLen)
 
-        } // for (; parseIdx < currMsgBlock->MsgLen; parseIdx++)
+        // The message continues in the next block.
+        if (msgStartIdx < currMsgBlock->MsgLen)
+        {
+            if (straddlingMsg == NULL)
+            {
+                straddlingMsg = MakeShared<MsgBlock>();
+            }
+            std::memcpy(straddlingMsg->Msg + straddlingMsg->MsgLen, currMsgBlock->Msg + msgStartIdx, currMsgBlock->MsgLen - msgStartIdx);
+            straddlingMsg->MsgLen += currMsgBlock->MsgLen - msgStartIdx;
+        }
 
-    } // for (size_t msgBlockQueueIdx = 0; msgBlockQueueIdx < client->ReceivedMsgBlockToProcessQueue.size(); msgBlockQueueIdx++)
+    } // for (size_t msgBlockQueueIdx = 0; msgBlockQueueIdx < client->RecvMsgBlocks.size(); msgBlockQueueIdx++)
+BREAK_MAX_NUM_MSGS:
 
     // Remove the fully separated message blocks from the receive queue
     if (lastParsedRecvQueueBlockIdx > 0)
@@ -570,80 +2039,37 @@ EIrcErrorCode Server::separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBloc
         client->RecvMsgBlocks.erase(client->RecvMsgBlocks.begin(), client->RecvMsgBlocks.begin() + lastParsedRecvQueueBlockIdx);
     }
 
-    // Remove the CR-LF from the separated messages
-    for (size_t msgIdx = 0; msgIdx < outSeparatedMsgs.size(); msgIdx++)
-    {
-        outSeparatedMsgs[msgIdx]->MsgLen -= CRLF_LEN_2;
-    }
-
     return IRC_SUCCESS;
 }
 
-EIrcErrorCode Server::processClientMsg(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg)
+EIrcErrorCode Server::processClientMsg(SharedPtr<ClientControlBlock> client, const MsgView& msg)
 {
     if (client->bExpired)
     {
         return IRC_SUCCESS;
     }
 
-    if (msg == NULL)
+    if (msg.Block == NULL)
     {
         return IRC_SUCCESS;
     }
 
-    // There must be at least one blank space in msg to insert NULL.
-    // And msg is a message with CR-LF removed, so there must be at least two blank spaces.
-    Assert(msg->MsgLen < MESSAGE_LEN_MAX - CRLF_LEN_2);
+    // msg is a message with CR-LF removed, and the CR-LF is still in the block to insert NULL.
+    Assert(msg.Len <= MESSAGE_LEN_MAX - CRLF_LEN_2);
+    Assert(msg.Offset + msg.Len + CRLF_LEN_2 <= MESSAGE_LEN_MAX);
+    char* const msgStr = msg.GetMsg();
+    const size_t msgLen = msg.Len;
 
-    // Split the arguments into blank(' ')
-    const char* msgCommandToken = NULL;
-    std::vector<char*> msgArgTokens;
-    msgArgTokens.reserve(MESSAGE_LEN_MAX / 2);
-
-    bool bPrefixIgnored = false;
-    for (size_t i = 0; i < msg->MsgLen; i++)
+    // The most frequent messages are handled without the tokenizing. (See [ \ref irc_server_keepalive ])
+    if (processKeepaliveMsgFastPath(client, msg))
     {
-        // Skip the blanks and set them to NULL('\0') character to separate the arguments
-        for (; i < msg->MsgLen && msg->Msg[i] == ' '; i++)
-        {
-            msg->Msg[i] = '\0';
-        }
-
-        // Ignore the part of prefix
-        if (msg->Msg[i] == ':' && msgArgTokens.size() == 0 && !bPrefixIgnored)
-        {
-            for (; i < msg->MsgLen && msg->Msg[i] != ' '; i++)
-            {
-            }
-            bPrefixIgnored = true;
-        }
-        // <Trail> token
-        else if (msg->Msg[i] == ':' && msgArgTokens.size() > 0)
-        {
-            msg->Msg[i] = '\0';
-            msgArgTokens.push_back(&msg->Msg[i + 1]);
-            break;
-        }
-        // Store the normal argument token
-        else if (i < msg->MsgLen)
-        {
-            if (msgCommandToken == NULL)
-            {
-                msgCommandToken = &msg->Msg[i];
-            }
-            else
-            {
-                msgArgTokens.push_back(&msg->Msg[i]);
-            }
-
-            // skip remaining characters of the token
-            for (; i < msg->MsgLen && msg->Msg[i] != ' ' && msg->Msg[i] != '\0'; i++)
-            {
-            }
-            i -= 1;
-        }
+        return IRC_SUCCESS;
     }
-    msg->Msg[msg->MsgLen] = '\0';
+
+    // Split the message into the parts in place (See [ \ref irc_server_parsed_msg ])
+    ParsedMsg parsedMsg;
+    const bool bCommandFound = parsedMsg.Parse(msgStr, msgLen);
+    const char* msgCommandToken = parsedMsg.Command;
 
     // ! DEBUG
     if (msgCommandToken != NULL && strcmp(msgCommandToken, "SHUTDOWN") == 0)
@@ -653,37 +2079,15 @@ EIrcErrorCode Server::processClientMsg(SharedPtr<ClientControlBlock> client, Sha
 
     // I don't think a message with only a prefix is an error.
     // There is also no reply.
-    if (msgCommandToken == NULL)
+    if (!bCommandFound)
     {
         return IRC_SUCCESS;
     }
 
 
-    // Create a list of client commands with name/function pairs
+    // Find the matching command case-insensitively
     // - See "Client command functions" group in Server class for ClientCommand functions.
-    typedef struct {
-        const char*             command;
-        ClientCommandFuncPtr    func;
-    } ClientCommandFuncPair;
-
-    const ClientCommandFuncPair clientCommandFuncPairs[] = {
-#define IRC_CLIENT_COMMAND_X(command_name) { #command_name, &Server::executeClientCommand_##command_name },
-        IRC_CLIENT_COMMAND_LIST
-#undef  IRC_CLIENT_COMMAND_X 
-    };
-    const size_t numClientCommandFunc = sizeof(clientCommandFuncPairs) / sizeof(clientCommandFuncPairs[0]);
-
-    // Find the matching command
-    ClientCommandFuncPtr pCommandExecFunc = NULL; 
-    for (size_t i = 0; i < numClientCommandFunc; i++)
-    {
-        if (std::strcmp(msgCommandToken, clientCommandFuncPairs[i].command) == 0)
-        {
-            Assert(pCommandExecFunc == NULL);
-            pCommandExecFunc = clientCommandFuncPairs[i].func;
-            break;
-        }
-    }
+    const ClientCommandFuncPtr pCommandExecFunc = mClientCommandTable.Find(msgCommandToken);
 
     // Unknown command name
     if (pCommandExecFunc == NULL)
@@ -693,14 +2097,16 @@ EIrcErrorCode Server::processClientMsg(SharedPtr<ClientControlBlock> client, Sha
     // Execute the command
     else
     {
+#ifdef IRC_VERBOSE_LOG
         // DEBUG
         logVerbose("processClientMsg(): Executing the command. IP: " + InetAddrToString(client->Addr) + ", Nick: " + client->Nickname + ", Command: " + msgCommandToken);
-        for (size_t i = 0; i < msgArgTokens.size(); i++)
+        for (size_t i = 0; i < parsedMsg.NumParams; i++)
         {
-            logVerbose("Args[" + ValToString(i) + "]: " + msgArgTokens[i]);
+            logVerbose("Args[" + ValToString(i) + "]: " + parsedMsg.Params[i]);
         }
+#endif
 
-        EIrcErrorCode err = (this->*pCommandExecFunc)(client, msgArgTokens);
+        EIrcErrorCode err = (this->*pCommandExecFunc)(client, parsedMsg);
         if (UNLIKELY(err != IRC_SUCCESS))
         {
             return err;
@@ -723,6 +2129,9 @@ EIrcErrorCode Server::forceDisconnectClient(SharedPtr<ClientControlBlock> client
         return IRC_SUCCESS;
     }
 
+    // The socket and the receive state are read by the reactor of the client without the lock. (See [ \ref irc_server_multi_reactor ])
+    Assert(pthread_equal(mReactors[client->ReactorIdx]->hThread, pthread_self()));
+
     // Send QUIT message to the channels the client is in
     // (only at the first time when bExpired flag becomes true)
     if (!client->bExpired)
@@ -736,36 +2145,43 @@ EIrcErrorCode Server::forceDisconnectClient(SharedPtr<ClientControlBlock> client
     }
     client->bExpired = true;
 
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+    // The notifications can not be read after the close.
+    if (!client->InFlightZeroCopySends.empty())
+    {
+        reapZeroCopySends(*mReactors[client->ReactorIdx], client);
+        lingerZeroCopyMsgBlocks(*mReactors[client->ReactorIdx], client);
+    }
+#endif
+
     // Close the client socket.
-    // close() on a socket will delete the corresponding kevent from the kqueue.
+    // close() on a socket will delete the corresponding kevent from the kqueue. (Same for epoll)
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+    // A request in flight holds the socket even after close(), so shut it down to finish the requests.
+    // The socket is closed when the client is released.
+    if (UNLIKELY(shutdown(client->hSocket, SHUT_RDWR) == -1 && errno != ENOTCONN))
+#else
     if (UNLIKELY(close(client->hSocket) == -1))
+#endif
     {
         logErrorCode(IRC_FAILED_TO_CLOSE_SOCKET);
         return IRC_FAILED_TO_CLOSE_SOCKET;
     }
     client->bSocketClosed = true;
+    mReactors[client->ReactorIdx]->ClientTimers.Cancel(client->DeadlineTimer);
+    Assert(mNumClients > 0);
+    mNumClients--;
+
+    // A slot for a new client. (See suspendListening())
+    resumeListening();
 
     // Remove reserved event registration of the client
-    for (size_t i = 0; i < mEventRegistrationQueue.size(); i++)
-    {
-        if (static_cast<int>(mEventRegistrationQueue[i].ident) == client->hSocket)
-        {
-            // Fast remove (unordered)
-            mEventRegistrationQueue[i] = mEventRegistrationQueue.back();
-            mEventRegistrationQueue.pop_back();
-        }
-    }
+    cancelQueuedClientEvents(*mReactors[client->ReactorIdx], client);
 
     // Remove the client from client lists
-    for (size_t i = 0; i < mUnregistedClients.size(); i++)
+    if (client->UnregisteredClientIdx != ClientControlBlock::INVALID_INDEX)
     {
-        if (mUnregistedClients[i] == client)
-        {
-            // Fast remove (unordered)
-            mUnregistedClients[i] = mUnregistedClients.back();
-            mUnregistedClients.pop_back();
-            break;
-        }
+        removeUnregisteredClient(client);
     }
     mClients.erase(client->Nickname);
 
@@ -781,9 +2197,11 @@ EIrcErrorCode Server::forceDisconnectClient(SharedPtr<ClientControlBlock> client
     }
 
     // Defer the release of the client.
-    mClientReleaseQueue.push_back(client);
+    mReactors[client->ReactorIdx]->ClientReleaseQueue.push_back(client);
 
-    logMessage("Client disconnected. IP: " + InetAddrToString(client->Addr) + ", Nick: " + client->Nickname);
+    logMessage("Client disconnected. IP: " + InetAddrToString(client->Addr) + ", Nick: " + client->Nickname
+               + ", SendQ high-water mark: " + ValToString(client->MaxSendingQueueBytes) + ", Dropped messages: " + ValToString(client->NumDroppedMsgs)
+               + ", RTT(us): " + ValToString(client->RttMicrosec) + ", Smoothed RTT(us): " + ValToString(client->SmoothedRttMicrosec));
 
     return IRC_SUCCESS;
 }
@@ -800,24 +2218,35 @@ EIrcErrorCode Server::disconnectClient(SharedPtr<ClientControlBlock> client, con
         return IRC_SUCCESS;
     }
 
+    // Only the reactor of the client closes the socket and modifies its receive state. (See [ \ref irc_server_multi_reactor ])
+    // The other reactors (e.g. a slow consumer found by sendMsgToClient()) leave them to the reactor of the client.
+    ReactorControlBlock& ownerReactor = *mReactors[client->ReactorIdx];
+    const bool bOwnerThread = pthread_equal(ownerReactor.hThread, pthread_self());
+
     // If there is no reason to wait remaining messages, force disconnect the client.
-    if (client->MsgSendingQueue.empty())
+    if (client->MsgSendingQueue.empty() && bOwnerThread)
     {
-        forceDisconnectClient(client, quitMessage);
-        return IRC_SUCCESS;
+        return forceDisconnectClient(client, quitMessage);
     }
 
     client->bExpired = true;
 
-    // Block the messages from the client
-    // kevent_t kev;
-    // kev.ident = client->hSocket;
-    // kev.filter = EVFILT_READ;
-    // kev.flags = EV_DELETE;
-    // kev.fflags = 0;
-    // kev.data = 0;
-    // kev.udata = reinterpret_cast<void *>(client.GetControlBlock());
-    // mEventRegistrationQueue.push_back(kev);
+    // Close the socket if the remaining messages can not be sent until the deadline. (See handleClientTimer())
+    // Called by any reactor, so the time is read instead of the ReactorControlBlock::TickTime of the client's reactor.
+    scheduleClientTimer(ownerReactor, client, GetMonotonicMicrosec() + CLIENT_DISCONNECT_TIMEOUT * static_cast<uint64_t>(MICROSEC_PER_SEC));
+
+    // Block the messages from the client.
+    // A level-triggered READ event of the unread messages would be observed until the socket is closed.
+    // If called by another reactor, the reactor of the client pauses it at the next READ event,
+    // and it is woken up to wait with the new deadline.
+    if (!bOwnerThread)
+    {
+        wakeupReactor(ownerReactor);
+    }
+    else if (!client->bRecvPaused)
+    {
+        setClientRecvPaused(ownerReactor, client, true);
+    }
 
     // Send QUIT message to the channels the client is in.
     std::string quitMsgStr = ":" + client->Nickname + " QUIT";
@@ -850,6 +2279,12 @@ bool Server::registerClient(SharedPtr<ClientControlBlock> client)
         return false;
     }
 
+    // Registered by the CAP END (See [ \ref irc_server_message_tags ])
+    if (client->bCapNegotiating)
+    {
+        return false;
+    }
+
     // Nickname is already in use
     if (findClientGlobal(client->Nickname) != NULL)
     {
@@ -861,16 +2296,7 @@ bool Server::registerClient(SharedPtr<ClientControlBlock> client)
     mClients[client->Nickname] = client;
     
     // Remove the client from the unregistered client list
-    for (size_t i = 0; i < mUnregistedClients.size(); i++)
-    {
-        if (mUnregistedClients[i] == client)
-        {
-            // Fast remove (unordered)
-            mUnregistedClients[i] = mUnregistedClients.back();
-            mUnregistedClients.pop_back();
-            break;
-        }
-    }
+    removeUnregisteredClient(client);
 
     // Send the welcome message
     sendMsgToClient(client, MakeShared<MsgBlock>(MakeReplyMsg_RPL_WELCOME(mServerName, client->Nickname)));
@@ -880,6 +2306,21 @@ bool Server::registerClient(SharedPtr<ClientControlBlock> client)
     return true;
 }
 
+void Server::removeUnregisteredClient(SharedPtr<ClientControlBlock> client)
+{
+    const size_t idx = client->UnregisteredClientIdx;
+    Assert(idx < mUnregistedClients.size() && mUnregistedClients[idx] == client);
+
+    // Fast remove (unordered)
+    if (idx != mUnregistedClients.size() - 1)
+    {
+        mUnregistedClients[idx] = mUnregistedClients.back();
+        mUnregistedClients[idx]->UnregisteredClientIdx = idx;
+    }
+    mUnregistedClients.pop_back();
+    client->UnregisteredClientIdx = ClientControlBlock::INVALID_INDEX;
+}
+
 void Server::joinClientToChannel(SharedPtr<ClientControlBlock> client, SharedPtr<ChannelControlBlock> channel)
 {
     client->Channels[channel->Name] = channel;
@@ -926,7 +2367,7 @@ SharedPtr<ChannelControlBlock> Server::findChannelGlobal(const std::string &chan
     return SharedPtr<ChannelControlBlock>();
 }
 
-void Server::sendMsgToClient(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg)
+void Server::sendMsgToClient(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg, const bool bDroppable)
 {
     if (client == NULL || msg == NULL)
     {
@@ -952,25 +2393,97 @@ void Server::sendMsgToClient(SharedPtr<ClientControlBlock> client, SharedPtr<Msg
         msg->MsgLen += CRLF_LEN_2;
     }
 
-    // Enable the write event filter for the client socket.
-    if (client->MsgSendingQueue.empty())
+    // A slow consumer. (See [ \ref irc_server_send_queue_limit ])
+    if (mConfig.SendQueueLimit != 0 && client->NumSendingQueueBytes + msg->MsgLen > mConfig.SendQueueLimit)
     {
-        kevent_t kev;
-        kev.ident = client->hSocket;
-        kev.filter = EVFILT_WRITE;
-        kev.flags = EV_ADD;
-        kev.fflags = 0;
-        kev.data = 0;
-        kev.udata = reinterpret_cast<void *>(client.GetControlBlock());
+        if (bDroppable && mConfig.SendQueuePolicy == SENDQ_POLICY_DROP_CHANNEL_MSG)
+        {
+            client->NumDroppedMsgs++;
+            return;
+        }
 
-        mEventRegistrationQueue.push_back(kev);
+        // The queue is not empty because the limit is larger than a message, so the client is not released here.
+        Assert(!client->MsgSendingQueue.empty());
+        logMessage("SendQ exceeded. IP: " + InetAddrToString(client->Addr) + ", Nick: " + client->Nickname + ", Queued bytes: " + ValToString(client->NumSendingQueueBytes));
+        disconnectClient(client, "SendQ exceeded");
+        return;
+    }
+
+    ReactorControlBlock& ownerReactor = *mReactors[client->ReactorIdx];
+    if (client->MsgSendingQueue.empty())
+    {
         client->SendMsgBlockCursor = 0;
+
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+        // Enable the write event filter for the client socket.
+        queueClientEvent(ownerReactor, client, EventQueue::FILTER_WRITE, EventQueue::FLAG_ADD);
+#else
+        // Try to send it at the end of the tick without the write event filter.
+        // The filter is armed only if it is not sent at once. (See [ \ref irc_server_inline_send ])
+        ownerReactor.InlineSendClients.push_back(client);
+#endif
+
+        // The owner reactor may be blocked in Wait().
+        if (!pthread_equal(ownerReactor.hThread, pthread_self()))
+        {
+            wakeupReactor(ownerReactor);
+        }
+    }
+
+    // A channel message waits behind the long sending queue, so that the replies are not delayed by it. (See [ \ref irc_server_send_lanes ])
+    const ESendLane lane = bDroppable ? SEND_LANE_BULK : SEND_LANE_CONTROL;
+    if (lane == SEND_LANE_BULK && (client->BulkMsgQueueHead < client->BulkMsgQueue.size() || client->MsgSendingQueue.size() >= NUM_CLIENT_SEND_BULK_WINDOW))
+    {
+        ClientControlBlock::BulkMsg bulkMsg;
+        bulkMsg.Msg = msg;
+        bulkMsg.QueuedTime = mLockedTickTime;
+        client->BulkMsgQueue.push_back(bulkMsg);
+        ownerReactor.NumDeferredBulkMsgs++;
+        ownerReactor.LaneDepthMax[SEND_LANE_BULK] = std::max(ownerReactor.LaneDepthMax[SEND_LANE_BULK], client->BulkMsgQueue.size() - client->BulkMsgQueueHead);
+    }
+    else
+    {
+        pushToSendingQueue(client, msg, mLockedTickTime, lane);
+        ownerReactor.LaneDepthMax[SEND_LANE_CONTROL] = std::max(ownerReactor.LaneDepthMax[SEND_LANE_CONTROL], client->MsgSendingQueue.size());
+    }
+
+    client->NumSendingQueueBytes += msg->MsgLen;
+    if (client->NumSendingQueueBytes > client->MaxSendingQueueBytes)
+    {
+        client->MaxSendingQueueBytes = client->NumSendingQueueBytes;
+    }
+    ownerReactor.NumLaneMsgs[lane]++;
+}
+
+void Server::pushToSendingQueue(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg, const uint64_t queuedTime, const ESendLane lane)
+{
+    // Copy a short reply into the page at the tail instead of queueing its own block. (See [ \ref irc_server_reply_coalescing ])
+    if (mConfig.bCoalesceReplies && msg->MsgLen <= COALESCED_REPLY_LEN_MAX)
+    {
+        if (client->MsgSendingQueue.empty() || !client->bSendQueueTailOwned || client->MsgSendingQueue.back()->MsgLen + msg->MsgLen > MESSAGE_LEN_MAX)
+        {
+            client->MsgSendingQueue.push_back(MakeShared<MsgBlock>());
+            client->bSendQueueTailOwned = true;
+        }
+        MsgBlock& page = *client->MsgSendingQueue.back();
+        std::memcpy(&page.Msg[page.MsgLen], msg->Msg, msg->MsgLen);
+        page.MsgLen += msg->MsgLen;
+    }
+    else
+    {
+        client->MsgSendingQueue.push_back(msg);
+        client->bSendQueueTailOwned = false;
     }
 
-    client->MsgSendingQueue.push(msg);
+    client->NumTotalQueuedBytes += msg->MsgLen;
+    if (client->LaneSampleEndOffset[lane] == 0)
+    {
+        client->LaneSampleEndOffset[lane] = client->NumTotalQueuedBytes;
+        client->LaneSampleQueuedTime[lane] = queuedTime;
+    }
 }
 
-void Server::sendMsgToChannel(SharedPtr<ChannelControlBlock> channel, SharedPtr<MsgBlock> msg, SharedPtr<ClientControlBlock> exceptClient)
+void Server::sendMsgToChannel(SharedPtr<ChannelControlBlock> channel, SharedPtr<MsgBlock> msg, SharedPtr<ClientControlBlock> exceptClient, const bool bDroppable)
 {
     if (channel == NULL || msg == NULL)
     {
@@ -982,7 +2495,7 @@ void Server::sendMsgToChannel(SharedPtr<ChannelControlBlock> channel, SharedPtr<
         SharedPtr<ClientControlBlock> dest = it->second.Lock();
         if (dest != NULL && dest != exceptClient)
         {
-            sendMsgToClient(dest, msg);
+            sendMsgToClient(dest, msg, bDroppable);
         }
     }
 }
@@ -1004,6 +2517,110 @@ void Server::sendMsgToConnectedChannels(SharedPtr<ClientControlBlock> client, Sh
     }
 }
 
+void Server::sendTaggedMsgToClient(SharedPtr<ClientControlBlock> client, const char* msg, const size_t msgLen, const char* clientTags)
+{
+    if (client == NULL)
+    {
+        return;
+    }
+
+    char serverTime[UTC_TIME_STR_SIZE];
+    if (client->IsCapEnabled(CAP_SERVER_TIME))
+    {
+        FormatUtcTime(GetRealtimeNanosec(), serverTime);
+    }
+    sendMsgToClient(client, makeTaggedMsg(msg, msgLen,
+                                          client->IsCapEnabled(CAP_SERVER_TIME) ? serverTime : NULL,
+                                          client->IsCapEnabled(CAP_MESSAGE_TAGS) ? clientTags : NULL));
+}
+
+void Server::sendTaggedMsgToChannel(SharedPtr<ChannelControlBlock> channel, const char* msg, const size_t msgLen, const char* clientTags, SharedPtr<ClientControlBlock> exceptClient, const bool bDroppable)
+{
+    if (channel == NULL)
+    {
+        return;
+    }
+
+    // The time is formatted for the first member with the server-time.
+    char serverTime[UTC_TIME_STR_SIZE];
+    serverTime[0] = '\0';
+
+    SharedPtr<MsgBlock> taggedMsgs[NUM_TAG_CAP_SETS];
+    for (std::map< std::string, WeakPtr< ClientControlBlock > >::iterator it = channel->Clients.begin(); it != channel->Clients.end(); ++it)
+    {
+        SharedPtr<ClientControlBlock> dest = it->second.Lock();
+        if (dest == NULL || dest == exceptClient)
+        {
+            continue;
+        }
+
+        const unsigned int tagCaps = dest->EnabledCaps & TAG_CAPS_MASK;
+        if (taggedMsgs[tagCaps] == NULL)
+        {
+            const bool bServerTime = (tagCaps & (1u << CAP_SERVER_TIME)) != 0;
+            if (bServerTime && serverTime[0] == '\0')
+            {
+                FormatUtcTime(GetRealtimeNanosec(), serverTime);
+            }
+            taggedMsgs[tagCaps] = makeTaggedMsg(msg, msgLen,
+                                                bServerTime ? serverTime : NULL,
+                                                (tagCaps & (1u << CAP_MESSAGE_TAGS)) != 0 ? clientTags : NULL);
+        }
+        sendMsgToClient(dest, taggedMsgs[tagCaps], bDroppable);
+    }
+}
+
+SharedPtr<MsgBlock> Server::makeTaggedMsg(const char* msg, const size_t msgLen, const char* serverTime, const char* clientTags)
+{
+    static const char TIME_TAG_KEY[] = "time=";
+    const size_t msgLenMax = MESSAGE_LEN_MAX - CRLF_LEN_2;
+
+    if (clientTags != NULL && clientTags[0] == '\0')
+    {
+        clientTags = NULL;
+    }
+    size_t timeTagLen = (serverTime != NULL) ? sizeof(TIME_TAG_KEY) - 1 + std::strlen(serverTime) : 0;
+    size_t clientTagsLen = (clientTags != NULL) ? std::strlen(clientTags) : 0;
+
+    // '@' <time tag> [';'] <client tags> ' ' <message>
+    if (clientTagsLen > 0 && 1 + timeTagLen + 1 + clientTagsLen + 1 + msgLen > msgLenMax)
+    {
+        clientTagsLen = 0;
+    }
+    if (timeTagLen > 0 && 1 + timeTagLen + 1 + msgLen > msgLenMax)
+    {
+        timeTagLen = 0;
+    }
+    if (timeTagLen == 0 && clientTagsLen == 0)
+    {
+        return MakeShared<MsgBlock>(msg, msgLen);
+    }
+
+    SharedPtr<MsgBlock> taggedMsg = MakeShared<MsgBlock>();
+    char* p = taggedMsg->Msg;
+    *p++ = '@';
+    if (timeTagLen > 0)
+    {
+        std::memcpy(p, TIME_TAG_KEY, sizeof(TIME_TAG_KEY) - 1);
+        std::memcpy(p + sizeof(TIME_TAG_KEY) - 1, serverTime, timeTagLen - (sizeof(TIME_TAG_KEY) - 1));
+        p += timeTagLen;
+        if (clientTagsLen > 0)
+        {
+            *p++ = ';';
+        }
+    }
+    if (clientTagsLen > 0)
+    {
+        std::memcpy(p, clientTags, clientTagsLen);
+        p += clientTagsLen;
+    }
+    *p++ = ' ';
+    std::memcpy(p, msg, msgLen);
+    p += msgLen;
+    taggedMsg->MsgLen = p - taggedMsg->Msg;
+    return taggedMsg;
+}
+
 void Server::logErrorCode(EIrcErrorCode errorCode) const
 {
     std::cerr << ANSI_BRED << "[LOG][ERROR]" << GetIrcErrorMessage(errorCode) << std::endl << ANSI_RESET;
@@ -1022,4 +2639,10 @@ void Server::logVerbose(const std::string& message) const
 #endif
 }
 
+void Server::logLatencyReport(const ReactorControlBlock& reactor) const
+{
+    logMessage("Reactor " + ValToString(reactor.Idx) + " dispatch latency(us): " + reactor.DispatchLatency.ToString()
+               + ", Busy polls: " + ValToString(reactor.NumBusyPolls) + ", Hits: " + ValToString(reactor.NumBusyPollHits));
+}
+
 } // namespace irc
@@ -6,21 +6,26 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <map>
+#include <pthread.h>
+#include <csignal>
 
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <sys/event.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
 
 #include "Network/SocketTypedef.hpp"
+#include "Network/EventQueue.hpp"
 #include "Server/IrcConstants.hpp"
 #include "Server/IrcErrorCode.hpp"
 #include "Server/MsgBlock.hpp"
+#include "Server/ParsedMsg.hpp"
 #include "Server/ClientControlBlock.hpp"
 #include "Server/IrcReplies.hpp"
 #include "Server/ClientCommand/ClientCommand.hpp"
 #include "Server/ChannelControlBlock.hpp"
+#include "Server/ReactorControlBlock.hpp"
+#include "Server/ServerConfig.hpp"
 
 #include "Core/Core.hpp"
 using namespace IRCCore;
@@ -41,11 +46,51 @@ namespace IRC
      *  
      *  ## Kqueue & Kevent
      *      메인 이벤트 루프는 kqueue를 사용하여 이벤트를 처리합니다.  
-     *      모든 클라이언트는 mhKqueue에 등록되며 소켓이 닫히게되면 kqueue에서 자동으로 제거됩니다.  
+     *      모든 클라이언트는 클라이언트를 accept한 리액터의 ReactorControlBlock::Events에 등록되며 소켓이 닫히게되면 kqueue에서 자동으로 제거됩니다.  
+     *      (리액터는 기본적으로 1개입니다. [ \ref irc_server_multi_reactor ] 참고)  
      *      
+     *      ### 이벤트 큐 백엔드
+     *      kqueue 호출은 EventQueue 인터페이스 뒤에 있으며, 백엔드는 빌드 시점에 선택됩니다. (Makefile의 EVENT_BACKEND)  
+     *      - KqueueEventQueue : kqueue. (Linux에서는 libkqueue 에뮬레이션 레이어를 거칩니다.)  
+     *      - EpollEventQueue  : Linux의 네이티브 epoll. Linux의 기본값입니다.  
+     *      - IoUringEventQueue : Linux의 io_uring. 완료 기반이므로 accept/recv/send는 커널이 수행하고 이벤트 루프는 결과만 받습니다.  
+     *        수신된 메시지는 버퍼 링의 MsgBlock을 복사 없이 RecvMsgBlocks로 가져오며,  
+     *        요청이 끝나기 전까지 클라이언트를 해제할 수 없으므로 ClientControlBlock::NumPendingIoRequests가 0이 될 때까지 ReactorControlBlock::ClientReleaseQueue에 남습니다.  
+     *      
+     *      모든 백엔드는 kqueue와 같은 형태의 인터페이스를 제공하므로 이벤트 루프는 백엔드와 관계없이 동일합니다.  
+     *      
+     *      @anchor irc_server_accept
+     *      ### 연결 수락
+     *      리슨 소켓의 READ 이벤트마다 최대 NUM_ACCEPT_PER_TICK_MAX 개의 연결만 수락합니다. 리슨 소켓은 level-triggered이므로 남은 연결은 다음 Wait()에서 다시 관찰되며, 연결 폭주 중에도 기존 클라이언트의 이벤트가 처리됩니다.  
+     *      Linux에서는 accept4(SOCK_NONBLOCK)로 fcntl() 호출 없이 non-blocking 소켓을 받습니다.  
+     *      - 연결 수가 ServerConfig::MaxClients 에 도달하면 suspendListening()으로 리슨 소켓을 비활성화합니다.  
+     *      - 디스크립터가 부족한 경우(EMFILE/ENFILE), 대기 중인 연결이 매 Wait()마다 관찰되어 이벤트 루프가 헛돌게 됩니다.  
+     *        미리 열어둔 예비 디스크립터를 닫고 연결 하나를 수락 후 바로 닫아(shedPendingConnection()) 클라이언트에 거절을 알리고, 리슨 소켓을 비활성화합니다.  
+     *      클라이언트 연결이 끊어지면 resumeListening()으로 모든 리액터의 리슨 소켓을 다시 활성화합니다.  
+     *      io_uring 백엔드는 multishot accept 요청을 취소하여 비활성화합니다. 이미 수락된 연결이 제한을 넘으면 바로 닫고,  
+     *      EMFILE/ENFILE은 data가 -1인 이벤트로 전달되며 해당 accept 요청은 다시 활성화될 때까지 재등록되지 않으므로 CPU를 점유하지 않습니다.  
+     *
+     *      @anchor irc_server_busy_poll
+     *      ### Busy poll
+     *      ServerConfig::BusyPollMicrosec 가 설정된 경우, 블록해야 하는 Wait() 전에 그 시간 동안 timeout 0으로 Wait()를 반복하며 이벤트를 기다립니다.  
+     *      스레드가 잠들었다 깨어나는 스케줄링 지연 대신 CPU 코어 하나를 계속 사용하며, 클라이언트 소켓에는 SO_BUSY_POLL을 설정합니다. (NAPI 장치에서만 효과가 있습니다)  
+     *      기본값은 0이며 기존처럼 다음 타이머까지 블록합니다. CPU가 하나뿐인 환경에서는 스핀이 클라이언트의 CPU를 빼앗아 왕복 p99가 나빠지므로, 여유 코어가 있을 때만 사용합니다.  
+     *
+     *      @anchor irc_server_dispatch_latency
+     *      ### 디스패치 지연
+     *      ServerConfig::bLatencyHistogram 이 켜진 경우, 커널의 수신 시간(SO_TIMESTAMPNS)부터 READ 이벤트가 처리되기까지의 지연을 ReactorControlBlock::DispatchLatency 히스토그램에 기록하고  
+     *      LATENCY_REPORT_INTERVAL 마다 busy poll 횟수와 함께 로그로 출력합니다. (epoll 백엔드만 지원합니다)  
+     *
      *      ### 이벤트 등록
      *      Kqueue에 이벤트 등록을 하기 위해선 kevent() 함수를 호출하여야 하지만 이는 system call이므로 최대한 줄이는 것이 좋습니다.  
-     *      그러므로 일반적인 Kevent 등록은 mEventRegistrationQueue에 추가하고 다음 이벤트 루프 시작점에서 한 번에 처리합니다.  
+     *      그러므로 일반적인 Kevent 등록은 ReactorControlBlock::EventRegistrationQueue에 추가하고 다음 이벤트 루프 시작점에서 한 번에 처리합니다.  
+     *      
+     *      @anchor irc_server_registration_coalescing
+     *      클라이언트의 등록은 queueClientEvent()로 추가되며, 각 클라이언트는 필터별로 대기 중인 등록의 위치(ClientControlBlock::QueuedEventIdx)를 가집니다.  
+     *      - 같은 필터의 ADD/DELETE, ENABLE/DISABLE 쌍은 서로 취소되고, ADD 뒤의 ENABLE/DISABLE은 ADD에 합쳐지며, 같은 등록은 한 번만 전달됩니다.  
+     *      - 소켓이 닫힌 클라이언트의 등록은 대기열을 탐색하지 않고 그 위치로 취소됩니다(cancelQueuedClientEvents()). 닫힌 디스크립터 번호가 새 연결에 재사용되므로 반드시 취소해야 합니다.  
+     *      취소된 등록은 flags를 0으로 남겨두었다가 Wait() 직전에 한 번에 제거하므로, 대량의 연결이 한 번에 끊어져도 연결당 O(1)입니다.  
+     *      io_uring 백엔드의 READ 등록은 recv 요청 수(ClientControlBlock::NumPendingIoRequests)와 짝을 이루므로 합치거나 취소하지 않습니다.  
      * 
      *  ## 메시지
      *      메시지는 기본적으로 MsgBlock 클래스로 저장됩니다.
@@ -57,13 +102,101 @@ namespace IRC
      *      메시지 처리 대기열은 이벤트가 발생하지 않는 여유러운 시점에 처리됩니다.  
      *      그러므로 해당하는 클라이언트에 처리할 메시지가 있다는 것을 나타내기 위해 해당 클라이언트를 receivedClientMsgProcessQueue 목록에 추가해야합니다.
      *
+     *      @anchor irc_server_recv_readv
+     *      ### readv() 수신
+     *      epoll/kqueue 백엔드는 한 번의 readv()로 두 구간에 수신합니다.  
+     *      - 클라이언트의 마지막 메시지 블록에 남은 공간 : 복사 없이 그 자리에 받고, 잠금 아래에서 MsgLen만 늘립니다(ReactorControlBlock::RecvTailLen).  
+     *      - 리액터의 RecvScratch : 나머지를 받아 잠금 아래에서 새 메시지 블록들에 복사합니다. 풀에서 블록을 할당하려면 잠금이 필요하기 때문입니다.  
+     *      한 번에 받는 크기는 수신 배압 임계값까지 남은 블록 수(NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD)로 정해지므로, 클라이언트당 수신 메모리의 상한은 그대로이며  
+     *      4KB 버스트도 512 byte씩 여덟 번이 아니라 한 번의 readv()로 받습니다.  
+     *      readv() 횟수와 수신 byte는 ReactorControlBlock::NumRecvCalls, ReactorControlBlock::NumRecvBytes 로 집계됩니다.  
+     *
+     *      @anchor irc_server_msg_process_scheduling
+     *      ### 메시지 처리 스케줄링
+     *      - 중복 제거 : 클라이언트는 처리되기 전까지 대기열에 한 번만 추가됩니다(ClientControlBlock::bMsgProcessQueued). 한 틱에 여러 번 수신해도 한 번만 파싱합니다.  
+     *      - 공정성 : 한 라운드에 클라이언트당 NUM_CLIENT_MSG_PROCESS_BUDGET 개의 메시지까지만 처리하고, 남은 메시지는 다른 클라이언트 뒤에서 다음 라운드에 처리합니다.  
+     *      - 지연 상한 : 이벤트가 계속 관찰되는 부하 상태에서도 가장 오래 기다린 클라이언트가 MSG_PROCESS_QUEUE_DELAY_MAX_MICROSEC 를 넘거나,  
+     *        대기 중인 클라이언트가 NUM_MSG_PROCESS_QUEUE_FORCE_THRESHOLD 를 넘으면 처리를 강제합니다.  
+     *      대기열은 추가된 시간(ClientControlBlock::MsgProcessQueuedTime) 순서이므로 맨 앞의 클라이언트만 확인합니다.  
+     *      대기 시간과 강제 처리 횟수는 ReactorControlBlock의 Message processing statistics 로 집계됩니다.  
+     *
+     *      @anchor irc_server_recv_backpressure
+     *      ### 수신 배압
+     *      처리되지 않은 메시지 블록이 NUM_CLIENT_MSGBLOCK_RECV_PAUSE_THRESHOLD 이상이 되면 해당 클라이언트의 READ 필터를 FLAG_DISABLE로 비활성화합니다(ClientControlBlock::bRecvPaused).  
+     *      Level-triggered 소켓은 수신하지 않아도 계속 읽기 가능 이벤트가 발생하므로, 필터를 끄지 않으면 이벤트 루프가 같은 이벤트로 계속 돌며 메시지 처리 단계에 도달하지 못합니다.  
+     *      메시지 처리 단계에서 남은 블록이 NUM_CLIENT_MSGBLOCK_RECV_RESUME_THRESHOLD 이하가 되면 FLAG_ENABLE로 다시 활성화하며, 그 사이의 데이터는 소켓 버퍼에 남아 TCP 흐름 제어로 송신측을 늦춥니다.  
+     *      Edge-triggered 모드에서도 임계값까지만 recv하고 멈추며, 다시 활성화될 때 re-arm되어 남은 데이터가 관찰됩니다.  
+     *      io_uring 백엔드에서는 multishot recv 요청을 취소하고 다시 활성화될 때 새로 등록합니다.  
+     *      일시정지 횟수는 ReactorControlBlock::NumRecvPauses 로 집계됩니다.  
+     *
      *      ### 메시지 전송
      *      서버에서 클라이언트로 메시지를 보내는 경우, 송신될 메시지는 각 클라이언트의 ClientControlBlock::MsgSendingQueue 에 추가되며 kqueue를 통해 비동기적으로 처리됩니다.  
      *      기본적으로 클라이언트 소켓에 대한 kevent는 WRITE 이벤트에 대한 필터가 비활성화 됩니다.  
      *      전송할 메시지가 생긴 경우, 해당 클라이언트 소켓에 대한 kevent에 WRITE 이벤트 필터를 활성화합니다.  
      *      kqueue 이벤트 루프에 의해 모든 전송이 끝난 후 WRITE 이벤트 필터는 다시 비활성화됩니다.  
+     *      
+     *      ### Edge-triggered 모드
+     *      ServerConfig::bEdgeTriggered 가 켜진 경우, 클라이언트 소켓은 FLAG_CLEAR(EV_CLEAR / EPOLLET)로 등록됩니다.  
+     *      - 수신 : 다음 이벤트가 발생하지 않으므로 EAGAIN이 될 때까지(또는 수신 배압 임계값까지) recv합니다.  
+     *      - 송신 : WRITE 필터는 accept 시 비활성화 상태로 한 번 등록되고, 전송할 메시지가 생기면 FLAG_ENABLE로 다시 활성화(re-arm)됩니다.  
+     *        모든 전송이 끝나도 필터를 삭제하지 않으므로 버스트마다 ADD/DELETE 두 번 대신 ENABLE 한 번만 등록됩니다.  
+     *        writev()가 모두 전송되었는데 대기열이 남은 경우 소켓이 여전히 쓰기 가능하여 이벤트가 오지 않으므로 다시 활성화합니다.  
+     *      등록 횟수는 ReactorControlBlock::NumRegistrations 로 집계됩니다.  
+     *      
+     *      @anchor irc_server_inline_send
+     *      ### 즉시 전송
+     *      epoll/kqueue 백엔드에서는 비어있던 MsgSendingQueue에 메시지가 추가되어도 WRITE 필터를 바로 등록하지 않습니다.  
+     *      해당 클라이언트는 리액터의 ReactorControlBlock::InlineSendClients 에 추가되고, 같은 틱의 끝에서 다른 전송과 함께 잠금 없이 writev()로 전송됩니다.  
+     *      유휴 클라이언트는 소켓 버퍼가 비어있으므로 대부분 한 번에 전송되며, 등록도 다음 Wait()도 필요하지 않습니다.  
+     *      전송되지 못한 나머지가 있는 경우에만 WRITE 필터를 등록(ClientControlBlock::bWriteFilterArmed)하고, 모두 전송된 후 해제합니다.  
+     *      소켓에 대한 전송은 항상 해당 클라이언트의 리액터만 수행하므로 다른 스레드의 전송과 섞이지 않습니다.  
+     *
+     *      @anchor irc_server_output_batching
+     *      ### 출력 배치
+     *      한 틱 동안 클라이언트에게 추가된 메시지(JOIN 응답의 RPL_TOPIC, RPL_NAMREPLY 등)는 틱의 끝에서 한 번의 writev()로 모아 전송되므로 이미 하나의 출력 배치입니다.  
+     *      따라서 ServerConfig::bTcpNoDelay 가 켜진 경우 클라이언트 소켓에 TCP_NODELAY를 설정합니다. Nagle 알고리즘은 배치의 마지막 부분 세그먼트를 이전 세그먼트의 ACK까지 붙잡아 두어 지연된 ACK와 겹치면 수십 ms가 지연됩니다.  
+     *      io_uring 백엔드는 메시지 블록마다 연결된 send 요청을 제출하므로 블록마다 세그먼트가 나뉩니다.  
+     *      두 개 이상의 요청을 제출할 때 소켓을 TCP_CORK로 막아 두고, 전송 대기열이 비면 풀어서 남은 부분 세그먼트를 보냅니다(ClientControlBlock::bSendCorked).  
+     *
+     *      @anchor irc_server_send_queue_limit
+     *      ### 전송 대기열 제한
+     *      MsgSendingQueue에서 전송되지 않은 byte는 ClientControlBlock::NumSendingQueueBytes 로 집계되며, 최대값은 ClientControlBlock::MaxSendingQueueBytes 에 기록됩니다.  
+     *      메시지를 추가하면 ServerConfig::SendQueueLimit 를 넘는 경우(--sendq로 설정한 경우만, 기본값은 제한 없음), 읽지 않는 클라이언트가 메모리 풀을 무한히 늘리지 않도록 ServerConfig::SendQueuePolicy 를 적용합니다.  
+     *      - SENDQ_POLICY_DISCONNECT : disconnectClient()로 "SendQ exceeded" 연결 종료합니다. 만료된 클라이언트에는 더 이상 메시지가 추가되지 않습니다.  
+     *      - SENDQ_POLICY_DROP_CHANNEL_MSG : 채널 PRIVMSG처럼 버려도 되는 메시지(bDroppable)는 버리고, 그 외의 메시지가 넘치는 경우에만 연결 종료합니다.  
+     *      대기열은 전송 중인 writev()가 참조할 수 있으므로 비우지 않습니다.  
      *
      *      또한 동일한 메시지를 여러 클라이언트에게 보내는 경우, 하나의 메시지 블록을 SharedPtr로 공유하여 사용 가능합니다.
+     *
+     *      @anchor irc_server_reply_coalescing
+     *      ### 응답 합치기
+     *      ServerConfig::bCoalesceReplies 가 켜진 경우, COALESCED_REPLY_LEN_MAX 이하의 메시지는 블록을 그대로 넣지 않고 MsgSendingQueue 끝의 페이지(MsgBlock)에 복사합니다.  
+     *      끝의 블록이 이 클라이언트의 페이지가 아니거나(ClientControlBlock::bSendQueueTailOwned) 남은 공간이 부족하면 새 페이지를 추가하고, 긴 메시지는 기존처럼 공유된 블록을 참조합니다.  
+     *      - 페이지에는 뒤에 덧붙이기만 하고, advanceSendCursor()는 현재 MsgLen으로 블록을 꺼내므로 락 없이 진행 중인 writev()나 MSG_ZEROCOPY 전송과 겹쳐도 안전합니다.  
+     *      - io_uring 백엔드는 완료 이벤트가 제출한 길이만큼의 전송을 보고하므로, 끝의 페이지를 제출하면 더 이상 덧붙이지 않습니다.  
+     *      PONG 같은 짧은 응답마다 블록 할당, 참조 카운트, deque 원소를 쓰지 않고, io_uring에서는 send 요청의 개수도 줄어듭니다.  
+     *
+     *      @anchor irc_server_send_lanes
+     *      ### 전송 레인
+     *      클라이언트에게 보내는 메시지는 두 레인으로 나뉩니다(ESendLane).  
+     *      - SEND_LANE_CONTROL : 응답, numeric, PONG 등 나머지 메시지. 항상 MsgSendingQueue 끝에 추가됩니다.  
+     *      - SEND_LANE_BULK : 채널로 중계된 메시지(bDroppable). MsgSendingQueue가 NUM_CLIENT_SEND_BULK_WINDOW 블록 이상이면 ClientControlBlock::BulkMsgQueue 에서 기다립니다.  
+     *      advanceSendCursor()가 블록을 꺼내 대기열이 짧아지면 BulkMsgQueue의 메시지를 순서대로 MsgSendingQueue로 옮기므로,  
+     *      채널 메시지가 밀린 클라이언트에게도 응답은 최대 NUM_CLIENT_SEND_BULK_WINDOW 블록 뒤에서 전송됩니다.  
+     *      각 레인 안의 순서는 유지되지만, 응답은 먼저 추가된 채널 메시지를 앞지를 수 있습니다. (예: PART 응답이 그 전의 채널 PRIVMSG보다 먼저 도착)  
+     *      대기 시간은 레인마다 한 번에 하나의 메시지를 표본으로 골라, MsgSendingQueue에서 보낸 누적 byte가 그 끝에 도달할 때 기록합니다(ClientControlBlock::LaneSampleEndOffset).  
+     *      메시지마다 기록하지 않으므로 fan-out 경로의 비용이 늘지 않으며, 통계는 ReactorControlBlock의 Send lane statistics 로 집계됩니다.  
+     *      시간은 메시지마다 읽지 않고, 추가된 시간은 락을 가진 리액터의 TickTime(mLockedTickTime), 보낸 시간은 보낸 리액터의 TickTime 을 사용하므로 해상도는 한 틱입니다.  
+     *
+     *      @anchor irc_server_zerocopy
+     *      ### MSG_ZEROCOPY 전송
+     *      ServerConfig::ZeroCopyThreshold 가 설정된 경우(Linux, epoll 백엔드), 한 번에 모은 byte가 그 이상인 전송은 writev() 대신 sendmsg(MSG_ZEROCOPY)로 보냅니다.  
+     *      커널은 메시지 블록을 복사하지 않고 페이지를 참조하므로, 전송이 끝났다는 알림을 받기 전까지 블록을 수정하거나 해제하면 안 됩니다.  
+     *      - 전송한 블록은 ClientControlBlock::ZeroCopyMsgBlocks 에 참조를 유지하고, 커널이 소켓마다 매기는 순번을 ClientControlBlock::InFlightZeroCopySends 에 기록합니다.  
+     *      - 완료 알림은 소켓의 에러 큐에 쌓이며 EPOLLERR로 관찰됩니다. 연결 종료가 아닌 에러 이벤트에서 reapZeroCopySends()로 읽고, 완료된 순번까지의 참조를 해제합니다.  
+     *      - 알림을 받지 못한 전송이 NUM_CLIENT_ZEROCOPY_SEND_MAX 개를 넘거나 알림 메모리가 부족하면(ENOBUFS) 복사하여 보냅니다.  
+     *      - 소켓을 닫아도 커널은 확인받지 못한 데이터를 계속 보내므로, 남은 참조는 리액터에서 CLIENT_DISCONNECT_TIMEOUT 이상 유지한 후 해제합니다.  
+     *      페이지 고정과 알림 처리 비용이 있으므로 깊은 대기열을 한 번에 보내는 경우에만 이득이며, loopback에서는 커널이 결국 복사합니다.  
      *      
      *      @see MessageSending section in IRC::Server class
      * 
@@ -75,6 +208,46 @@ namespace IRC
      *      
      *      각 커맨드 실행 함수는 executeClientCommand_<COMMAND>() 형태로 정의되어 있습니다.
      *      @see ClientCommandExecution section in IRC::Server class
+     *
+     *      @anchor irc_server_line_split
+     *      ### 메시지 분리
+     *      separateMsgsFromClientRecvMsgs()는 byte마다 복사하고 "\r\n"을 검사하지 않고, FindLineFeed()로 다음 '\n'을 찾아 그 앞까지를 memcpy로 한 번에 복사합니다.  
+     *      FindLineFeed()는 AVX2를 지원하는 CPU에서 32 byte, 그 외에는 SSE2로 16 byte씩 비교하며, 빌드 옵션(-mavx)에 AVX2가 없으므로 실행 중에 선택합니다.  
+     *      '\n' 앞의 문자가 '\r'이면 메시지의 끝이며, 그 '\r'은 이전 블록에 있을 수도 있습니다. '\r' 없는 '\n'은 메시지의 일부로 복사됩니다.  
+     *      구분자를 포함해 MESSAGE_LEN_MAX를 넘는 메시지는 다음 "\r\n"까지 복사하지 않고 건너뜁니다. (processClientMsg()는 NULL 문자를 '\r' 자리에 넣으므로 510 byte + "\r\n"까지 처리합니다)  
+     *      건너뛰는 상태는 ClientControlBlock::bSkippingRecvMsg 에 남고 검사한 byte는 바로 소비하므로, 구분자가 오기 전에 수신이 일시정지되어도 블록이 풀려 다시 수신합니다.  
+     *      한 블록 안에 있는 메시지는 복사하지 않고 그 블록을 가리키는 MsgView(블록, 오프셋, 길이)로 processClientMsg()에 전달하며, 두 블록에 걸친 메시지만 새 블록에 복사합니다(ReactorControlBlock::NumCopiedMsgs).  
+     *      메시지는 이미 수신 대기열에서 소비되었으므로 그 자리에서 토큰으로 나누며, 뒤따르는 CR-LF 자리에 NULL 문자를 넣습니다.  
+     *      나눈 메시지는 스택의 ParsedMsg로 커맨드 함수에 전달합니다. (See [ \ref irc_server_parsed_msg ])  
+     *      벤치마크는 Tester/LineSplitBench.cpp 입니다.  
+     * 
+     *  @anchor irc_server_parsed_msg
+     *      ### 메시지 파싱
+     *      ParsedMsg::Parse()는 메시지를 태그, 소스, 커맨드, 최대 15개의 파라미터로 나누고 사이의 공백에 NULL 문자를 넣습니다.  
+     *      모든 부분은 수신 블록 안의 뷰이며 파라미터 배열도 고정 크기이므로, 파싱에 힙 할당이 없습니다.  
+     *      RFC 2812대로 15번째 파라미터는 ':'로 시작하지 않아도 메시지의 나머지 전체입니다.  
+     * 
+     *  @anchor irc_server_message_tags
+     *      ### IRCv3 메시지 태그
+     *      IRC_CAPABILITY_LIST의 capability(message-tags, server-time)는 CAP 커맨드로 협상하며 ClientControlBlock::EnabledCaps 에 남습니다.  
+     *      CAP LS/REQ를 보낸 등록 전의 클라이언트는 ClientControlBlock::bCapNegotiating 이 설정되고, registerClient()는 CAP END까지 기다립니다.  
+     *      PRIVMSG는 sendTaggedMsgToChannel()/sendTaggedMsgToClient()로 전달되며, server-time에는 "time" 태그를, message-tags에는 보낸 클라이언트의 '+' 태그를 붙입니다.  
+     *      채널 전달은 태그 capability 조합(TAG_CAPS_MASK)마다 메시지를 한 번 만들어 같은 조합의 멤버가 공유합니다.  
+     *      PRIVMSG는 전달할 줄을 스택에서 만들고 makeTaggedMsg()가 태그와 함께 풀의 블록에 바로 쓰므로, std::string을 만들지 않습니다. 보낸 클라이언트의 태그는 CLIENT_TAGS_LEN_MAX 까지 전달합니다.  
+     * 
+     *  @anchor irc_server_command_dispatch
+     *      ### 커맨드 찾기
+     *      processClientMsg()는 IRC_CLIENT_COMMAND_LIST로 한 번 만든 mClientCommandTable 에서 커맨드 함수를 찾습니다.  
+     *      ClientCommandTable::Find()는 토큰을 대문자로 바꾸면서 해시하므로, RFC 1459대로 커맨드의 대소문자를 구분하지 않습니다.  
+     *      현재 커맨드들은 테이블에서 충돌하지 않으며, 충돌하면 다음 칸을 찾습니다.  
+     *      벤치마크는 Tester/CommandDispatchBench.cpp 입니다.  
+     * 
+     *  @anchor irc_server_char_class
+     *      ### 이름 검사와 목록 나누기
+     *      NICK/USER/JOIN/MODE +k는 닉네임, 채널 이름, 키를 Core/CharClass.hpp의 CharClass로 검사합니다.  
+     *      CharClass는 256칸 테이블과 함께 하위/상위 니블의 16칸 테이블 두 개를 만들어, SSSE3 CPU에서는 pshufb로 16 byte씩 검사합니다.  
+     *      JOIN/PART/PRIVMSG의 쉼표 목록은 SplitCommaList()가 파라미터를 수정하지 않고 StrView 배열로 나눕니다. (빈 항목은 건너뜁니다)  
+     *      이전 검사 루프와의 동등성 확인은 Tester/CharClassTest.cpp (Tester에서 `make test_char_class`), 벤치마크는 Tester/CharClassBench.cpp 입니다.  
      * 
      *  ## 클라이언트
      *      ### 클라이언트 생성
@@ -90,12 +263,78 @@ namespace IRC
      *          클라이언트에게 disconnect 메시지를 보내고 소켓을 닫아야하는 경우에 사용합니다.  
      *          이 경우 클라이언트는 bExpired 플래그를 설정하고, 남은 메시지 전송이 끝난 후 소켓을 닫습니다.  
      *      
-     *      소켓이 닫힌 클라이언트의 리소스는 후속 이벤트 루프에서 접근할 가능성이 있으므로, 클라이언트는 mClientReleaseQueue 목록에 추가되어 이벤트 루프에서 소멸됩니다.  
+     *      소켓이 닫힌 클라이언트의 리소스는 후속 이벤트 루프에서 접근할 가능성이 있으므로, 클라이언트는 ReactorControlBlock::ClientReleaseQueue 목록에 추가되어 이벤트 루프에서 소멸됩니다.  
+     * 
+     *      @anchor irc_server_client_timer
+     *      ### 클라이언트 타이머
+     *      각 클라이언트는 리액터의 ReactorControlBlock::ClientTimers(계층형 타이머 휠)에 하나의 타이머(ClientControlBlock::DeadlineTimer)를 가지며, 만료되면 handleClientTimer()가 다음 기한을 확인합니다.  
+     *      - 등록 : 연결 후 CLIENT_REGISTRATION_TIMEOUT 안에 등록되지 않으면 연결을 종료합니다.  
+     *      - 유휴 : 마지막 수신(ClientControlBlock::LastActiveTime) 후 CLIENT_TIMEOUT 이 지나면 PING을 보내고, CLIENT_PING_TIMEOUT 안에 아무것도 수신되지 않으면 연결을 종료합니다.  
+     *      - 종료 : disconnectClient()로 만료된 클라이언트가 CLIENT_DISCONNECT_TIMEOUT 안에 남은 메시지를 보내지 못하면 소켓을 닫습니다.  
+     *      
+     *      @anchor irc_server_keepalive
+     *      ### PING/PONG
+     *      유휴 기한에 보낸 PING의 PONG이 오면 왕복 시간(ClientControlBlock::RttMicrosec)을 측정하고 1/8 가중 이동 평균(ClientControlBlock::SmoothedRttMicrosec)으로 지연을 추적합니다.  
+     *      PONG을 기다리는 기한은 CLIENT_PING_TIMEOUT 과 평균 왕복 시간의 4배 중 큰 값이므로, 지연이 큰 클라이언트도 끊기지 않습니다.  
+     *      PING/PONG은 가장 빈번한 메시지이므로 processKeepaliveMsgFastPath()가 ParsedMsg 파싱과 명령 테이블 조회 전에 처리합니다.  
+     *      접두사가 있거나 인자가 없는 메시지만 일반 경로의 executeClientCommand_PING/PONG 으로 처리됩니다.  
+     *      명령 함수와 같이 등록 전에도 응답하지만, 만료된 클라이언트(ClientControlBlock::bExpired)의 메시지는 무시합니다.  
+     *      
+     *      수신할 때마다 타이머를 옮기지 않고 LastActiveTime만 기록하며, 타이머가 만료되었을 때 아직 기한 전이면 다시 예약합니다. 그러므로 타이머 휠은 클라이언트당 기한마다 한 번만 갱신됩니다.  
+     *      타이머의 예약과 취소는 O(1)이며, 다음 만료 틱은 각 단계의 점유 비트맵으로 찾으므로 Wait()의 타임아웃은 다음 타이머까지만 기다립니다. 만료될 타이머가 없으면 리액터는 깨어나지 않습니다.  
+     *      시간은 Wait() 직후 한 번 읽은 ReactorControlBlock::TickTime 을 해당 틱 동안 사용합니다.  
      * 
      *  ## 리소스 해제  
      *      소켓을 제외한 대부분의 리소스는 SharedPtr를 사용하여 관리되기 때문에 명시적인 해제가 필요하지 않습니다.  
      *      채널 또한 SharedPtr에 의하여 모든 클라이언트가 나가게 되면 자동으로 해제됩니다.  
      * 
+     *  @anchor irc_server_hot_upgrade
+     *  ## 무중단 업그레이드
+     *      SIGUSR2를 받으면 RequestUpgrade()가 플래그를 세우고, 모든 리액터는 틱의 시작점(지난 틱의 송신이 반영된 후)에서 IRC_UPGRADE로 멈춥니다.  
+     *      시그널은 한 스레드의 Wait()만 중단시키므로, RequestUpgrade()는 모든 리액터의 깨우기 소켓에 write()하여 타이머 없이 블록된 리액터도 깨웁니다.  
+     *      처리하지 못한 메시지 처리 대기열은 ReactorControlBlock::SuspendedMsgProcessQueue에 보관됩니다.  
+     *      handOverToNewProcess()는 socketpair를 만들고 같은 옵션(ServerConfig::CommandLine)에 --upgrade-fd를 더해 바이너리를 fork/exec 합니다.  
+     *      - 리슨 소켓과 클라이언트 소켓은 SCM_RIGHTS로 NUM_UPGRADE_FDS_PER_MSG_MAX 개씩 전달합니다.  
+     *      - 클라이언트(닉네임, 등록 여부, 타이머 기한, 왕복 시간, 처리하지 못한 수신 바이트, 보내지 못한 송신 바이트)와 채널(토픽, 모드, 멤버, 운영자, 초대)은 serializeUpgradeState()가 직렬화합니다.  
+     *      - 새 프로세스는 리슨 소켓을 다시 bind하지 않고 그대로 사용하며, restoreUpgradeState()로 클라이언트를 accept와 같은 방식으로 등록한 뒤 ACK를 보냅니다.  
+     *      
+     *      ACK를 받은 후에만 이전 프로세스는 디스크립터를 닫고 종료합니다. 커널의 소켓은 두 프로세스가 공유하므로 연결은 끊기지 않으며, 그 사이 도착한 데이터는 새 프로세스가 수신합니다.  
+     *      UPGRADE_HANDOVER_TIMEOUT 안에 ACK가 없거나 새 프로세스가 실패하면, 새 프로세스를 종료하고 보관한 상태로 이벤트 루프를 다시 시작합니다.  
+     *      - 연결을 종료 중인 클라이언트(bExpired)는 넘기지 않습니다.  
+     *      - 타이머 기한과 시간은 단조 시계 기준이므로 프로세스가 달라도 그대로 유효합니다.  
+     *      - 완료되지 않은 MSG_ZEROCOPY 송신의 메시지 블록은 커널이 계속 읽으므로, 서버 객체가 삭제될 때까지 mHandedOverZeroCopyMsgBlocks 에 보관하고 재사용하지 않습니다.  
+     *      - io_uring 백엔드는 커널에 진행 중인 요청을 넘길 수 없으므로 지원하지 않습니다.  
+     *      새 프로세스는 이전 프로세스의 자식이므로, 프로세스 관리자가 PID를 추적하는 경우 주의해야 합니다.  
+     * 
+     * 
+     *  @page irc_server_multi_reactor    Multi Reactor
+     *  ## 리액터
+     *      ServerConfig::NumReactors 개의 이벤트 루프 스레드(리액터)가 동일한 포트를 SO_REUSEPORT로 나누어 listen합니다.  
+     *      각 리액터는 자신의 listen 소켓, 이벤트 큐, 등록 대기열, 해제 대기열을 가지며 (ReactorControlBlock)  
+     *      커널이 분배한 연결을 accept한 리액터가 해당 클라이언트의 모든 I/O를 담당합니다. (ClientControlBlock::ReactorIdx)  
+     *      첫번째 리액터는 Startup()을 호출한 스레드에서 실행됩니다.  
+     * 
+     *  ## 공유 상태와 잠금
+     *      닉네임과 채널 목록은 모든 리액터가 공유하며 mStateLock으로 보호됩니다.  
+     *      SharedPtr의 참조 카운트와 메모리 풀은 thread-safe하지 않으므로, 이들을 다루는 모든 코드(명령어 처리 포함)는 잠금을 가진 상태에서 실행됩니다.  
+     *      잠금 없이 실행되는 구간은 시스템 콜 뿐입니다.  
+     *      - Wait() : 등록 대기열은 EventChangeList와 교체되어 전달되므로 다른 리액터는 그동안 등록 대기열에 추가할 수 있습니다.  
+     *      - recv() : 관찰된 READ 이벤트들을 클라이언트의 마지막 수신 블록과 리액터의 RecvScratch로 readv()하여 미리 수신합니다. 블록의 길이는 잠금 아래에서 반영합니다.  
+     *      - send() : 이벤트 처리 중 모아둔 PendingSends를 writev()로 전송한 뒤 다시 잠금을 얻어 결과를 반영합니다.  
+     *      
+     *      클라이언트의 소켓과 수신/송신 상태(bSocketClosed, bRecvPaused, RecvMsgBlocks, 송신 커서)는 해당 리액터만 수정하므로 그 리액터는 잠금 없이 읽을 수 있습니다.  
+     *      bExpired는 다른 리액터도 설정할 수 있으므로(느린 클라이언트의 SendQ 초과) 잠금 없는 구간에서 읽지 않습니다.  
+     *      다른 리액터가 종료시킨 클라이언트는 해당 리액터가 다음 READ 이벤트에서 수신을 중지하고, 소켓은 해당 리액터만 닫습니다. (disconnectClient(), forceDisconnectClient())  
+     *      잠금 없는 구간에서는 SharedPtr를 복사하거나 해제하지 않고, 로그를 출력하지 않습니다.  
+     *      
+     *      명령어 처리는 직렬화되므로 처리량은 리액터 수에 비례하지 않으며, 병렬로 실행되는 것은 시스템 콜뿐입니다.  
+     *      코어 수에 비례하는 확장에는 클라이언트, 닉네임, 채널 상태의 리액터별 분할과 리액터 간 작업 전달, 스레드별 메모리 풀이 필요하며 아직 구현되지 않았습니다.  
+     * 
+     *  ## 리액터 간 메시지 전달
+     *      다른 리액터의 클라이언트에게 메시지를 보내는 경우, 메시지는 잠금 아래에서 해당 클라이언트의 MsgSendingQueue에 추가되고  
+     *      클라이언트는 해당 리액터의 InlineSendClients(io_uring은 등록 대기열)에 추가됩니다.  
+     *      그 리액터가 Wait()에서 대기 중일 수 있으므로 wakeupReactor()로 깨웁니다.  
+     * 
      **/
     class Server
     {
@@ -106,29 +345,59 @@ namespace IRC
          * @param port              Port number to listen.
          * @param password          Password to access server.
          *                          see Constants::SVR_PASS_MIN, Constants::SVR_PASS_MAX
+         * @param config            Runtime options.
          */
-        static EIrcErrorCode CreateServer(Server** outPtrServer, const std::string& serverName, const unsigned short port, const std::string& password);
+        static EIrcErrorCode CreateServer(Server** outPtrServer, const std::string& serverName, const unsigned short port, const std::string& password, const ServerConfig& config = ServerConfig());
 
         /** Initialize resources and start the server event loop.
          *
-         * @details Initialize kqueue and resources and register listen socket to kqueue.
-         *          And then call eventLoop() to start the server.
+         * @details Initialize the reactors and register their listen sockets to the event queues.
+         *          And then start the event loop of each reactor. (See [ \ref irc_server_multi_reactor ])
          *
          * @note    \li Blocking until the server is terminated.
          *          \li All non-static methods must be called after this function is called.
          */
         EIrcErrorCode Startup();
 
+        /** Request the running server to hand over to a new process of the binary, and wake up the reactors. (Async-signal-safe. See [ \ref irc_server_hot_upgrade ]) */
+        static void RequestUpgrade();
+
         ~Server();
 
     private:
-        Server(const std::string& serverName, const unsigned short port, const std::string& password);
+        Server(const std::string& serverName, const unsigned short port, const std::string& password, const ServerConfig& config);
 
         /** @warning Copy constructor is not allowed. */
         UNUSED Server& operator=(const Server& rhs);
 
-        /** A main event loop of the server. */
-        EIrcErrorCode eventLoop();
+        /** @name Reactor */
+        ///@{
+        /** Create the listen socket, the event queue and the wakeup sockets of the reactor.
+         *  The listen socket is not created if it is already set by the hot upgrade.
+         */
+        EIrcErrorCode createReactorResources(ReactorControlBlock& reactor);
+
+        /** Create the wakeup sockets and the event queue of the reactor, and register the listen socket. */
+        EIrcErrorCode createReactorEvents(ReactorControlBlock& reactor);
+
+        /** Run the event loops of all reactors until they are terminated. */
+        EIrcErrorCode runReactors();
+
+        /** Entry point of the reactor threads except the first one. */
+        static void* reactorThreadMain(void* reactor);
+
+        /** Run the event loop of the reactor, and stop the other reactors when it is terminated. */
+        EIrcErrorCode runReactor(ReactorControlBlock& reactor);
+
+        /** An event loop of the reactor.
+         *
+         * @note    Called with the mStateLock, and returns with the lock.
+         */
+        EIrcErrorCode eventLoop(ReactorControlBlock& reactor);
+
+        /** Wake up the reactor blocking in Wait() to apply the new registrations. (With the mStateLock) */
+        void wakeupReactor(ReactorControlBlock& reactor);
+        ///@}
 
         /** Destroy all resources of the server. 
          * 
@@ -136,42 +405,190 @@ namespace IRC
         */
         EIrcErrorCode destroyResources();
 
+        /** @name Hot upgrade (See [ \ref irc_server_hot_upgrade ]) */
+        ///@{
+        /** Exec the binary and pass the listen sockets, the clients and the channels to it.
+         *
+         * @note    Called after the reactors are stopped.
+         * @return  IRC_SUCCESS if the new process restored the state. Else the server keeps its state to resume.
+         */
+        EIrcErrorCode handOverToNewProcess();
+
+        /** Write the state of the clients and channels, and collect the descriptors to pass. (The listen sockets first) */
+        void serializeUpgradeState(std::vector<int>& outFds, std::vector<char>& outState) const;
+
+        /** Receive the descriptors and the state from the old process with the ServerConfig::hUpgradeSocket.
+         *  @note   The descriptors are closed if it failed.
+         */
+        EIrcErrorCode receiveUpgradeState(std::vector<int>& outFds, std::vector<char>& outState);
+
+        /** Restore the clients and channels to the created reactors, and notify the old process.
+         *  @note   The descriptors not restored are closed if it failed.
+         */
+        EIrcErrorCode restoreUpgradeState(const std::vector<int>& fds, const std::vector<char>& state);
+
+        /** Close the descriptors from the index. */
+        static void closeUpgradeFds(const std::vector<int>& fds, const size_t fromIdx);
+        ///@}
+
     private:
         /** @name Message Processing */
         ///@{
-        /** Separate all separable messages in the client's ClientControlBlock::RecvMsgBlocks
+        /** Separate separable messages in the client's ClientControlBlock::RecvMsgBlocks
          *
          * @param client            A client to separate messages.
-         * @param outSeparatedMsgs     [out] Vector to receive the separated messages without CR-LF.
+         * @param outSeparatedMsgs     [out] Vector to receive the views of the separated messages without CR-LF. (See [ \ref irc_server_line_split ])
          *                          If the vector is not empty, the separated messages are appended to the end of the vector.
+         * @param maxNumMsgs        Max number of the messages to separate. The rest is left for the next call.
          * 
          * @see                     ClientControlBlock::RecvMsgBlockCursor
          */
-        EIrcErrorCode separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBlock> client, std::vector<SharedPtr<MsgBlock> >& outSeparatedMsgs);
+        EIrcErrorCode separateMsgsFromClientRecvMsgs(SharedPtr<ClientControlBlock> client, std::vector<MsgView>& outSeparatedMsgs, const size_t maxNumMsgs);
 
         /** Execute and reply the client's single message.
          *
          *  @param client            The client to process the message.
-         *  @param msg               The single message to process. It contains CR-LF.
+         *  @param msg               The single message to process without CR-LF, in the receive block or a copy.
          *                           And it will be modified during the processing. 
          * 
          *  @see                    ReplyMsgMakingFunctions
          */
-        EIrcErrorCode processClientMsg(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg);
+        EIrcErrorCode processClientMsg(SharedPtr<ClientControlBlock> client, const MsgView& msg);
         ///@}
 
-        /** Get SharedPtr to the ClientControlBlock from the kevent's udata. */
-        FORCEINLINE SharedPtr<ClientControlBlock> getClientFromKeventUdata(kevent_t& event) const
+        /** Append the received bytes to the client's ClientControlBlock::RecvMsgBlocks.
+         *
+         *  Fill the space left in the last message block first, and then a new message block.
+         */
+        void appendRecvBytesToClient(SharedPtr<ClientControlBlock> client, const char* bytes, const size_t numBytes);
+
+        /** @name Accept (See [ \ref irc_server_accept ]) */
+        ///@{
+        /** Disable the listen socket of the reactor until resumeListening(). */
+        void suspendListening(ReactorControlBlock& reactor);
+
+        /** Enable the suspended listen sockets of all reactors. Called when a client is disconnected. */
+        void resumeListening();
+
+        /** Accept a pending connection with the reserve descriptor and close it right away. */
+        void shedPendingConnection(ReactorControlBlock& reactor);
+
+        /** Set the socket options of the client and queue the registrations of its events. (At the accept and the hot upgrade) */
+        void setupClientSocket(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+        ///@}
+
+        /** @name Client timer (See [ \ref irc_server_client_timer ]) */
+        ///@{
+        /** Schedule the ClientControlBlock::DeadlineTimer of the client at the monotonic time (microseconds). */
+        void scheduleClientTimer(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const uint64_t deadline);
+
+        /** Advance the ReactorControlBlock::ClientTimers to the ReactorControlBlock::TickTime, and handle the expired timers. */
+        EIrcErrorCode processExpiredClientTimers(ReactorControlBlock& reactor);
+
+        /** Check the deadlines of the client, and disconnect it, send a PING, or schedule the next deadline. */
+        EIrcErrorCode handleClientTimer(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+        ///@}
+
+        /** @name Keepalive (See [ \ref irc_server_keepalive ]) */
+        ///@{
+        /** Reply the PING of the client with a PONG of the token. */
+        void replyPing(SharedPtr<ClientControlBlock> client, const char* token);
+
+        /** Take the reply of the PING sent by the server, and update the round-trip time of the client. */
+        void receivePong(SharedPtr<ClientControlBlock> client);
+
+        /** Handle a PING/PONG message without a prefix before the tokenizing of processClientMsg().
+         *
+         *  The token of a PING is terminated in place, at the blank after it or at the CR following the message in the receive block.
+         *  @return false if the message is not a PING/PONG with a parameter, and it is processed by the command functions.
+         */
+        bool processKeepaliveMsgFastPath(SharedPtr<ClientControlBlock> client, const MsgView& msg);
+        ///@}
+
+        /** @name Event registration (See [ \ref irc_server_registration_coalescing ]) */
+        ///@{
+        /** Add a registration of the client to the EventRegistrationQueue of the reactor.
+         *  It is coalesced with the pending registration of the same filter, or both are canceled if they are opposite.
+         */
+        void queueClientEvent(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const short filter, const unsigned short flags);
+
+        /** Cancel the pending registrations of the client. Called when the socket of the client is closed. */
+        void cancelQueuedClientEvents(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+        ///@}
+
+        /** Disable or enable the READ event filter of the client of the reactor.
+         *
+         *  @see [ \ref irc_server_recv_backpressure ]
+         */
+        void setClientRecvPaused(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client, const bool bPaused);
+
+        /** Gather the sending queue of the client into the PendingSends of the reactor. (Once per tick)
+         *
+         *  @see [ \ref irc_server_inline_send ]
+         */
+        void schedulePendingSend(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+
+        /** Advance ClientControlBlock::SendMsgBlockCursor by the sent bytes, and pop the fully sent message blocks.
+         *  The bulk lane is moved to the sending queue as it gets short. (See [ \ref irc_server_send_lanes ])
+         *
+         *  @return Number of the popped message blocks.
+         */
+        size_t advanceSendCursor(SharedPtr<ClientControlBlock> client, size_t nSentBytes);
+
+        /** Add the message to the end of the ClientControlBlock::MsgSendingQueue, and sample its end to measure the wait time of the lane.
+         *
+         *  @param queuedTime   Monotonic time (microseconds) when the message is queued to the lane.
+         *  @see [ \ref irc_server_send_lanes ]
+         */
+        void pushToSendingQueue(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg, const uint64_t queuedTime, const ESendLane lane);
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        /** @name MSG_ZEROCOPY sends (See [ \ref irc_server_zerocopy ]) */
+        ///@{
+        /** Keep the message blocks sent by the MSG_ZEROCOPY send until it is notified. */
+        void holdZeroCopyMsgBlocks(ReactorControlBlock& reactor, const ReactorControlBlock::PendingSend& pendingSend);
+
+        /** Release the message blocks of the notified MSG_ZEROCOPY sends of the client.
+         *
+         *  @return false if the socket has an error, which is reported together with the notifications.
+         */
+        bool reapZeroCopySends(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+
+        /** Move the message blocks of the MSG_ZEROCOPY sends of the closing client to the reactor. */
+        void lingerZeroCopyMsgBlocks(ReactorControlBlock& reactor, SharedPtr<ClientControlBlock> client);
+        ///@}
+#endif
+
+        /** Get SharedPtr to the ClientControlBlock from the event's udata. */
+        FORCEINLINE SharedPtr<ClientControlBlock> getClientFromEventUdata(const EventQueue::Event& event) const
         {
-            // @see SharedPtr::GetControlBlock(), mhKqueue
+            // @see SharedPtr::GetControlBlock(), ReactorControlBlock::Events
             return SharedPtr<ClientControlBlock>(reinterpret_cast< detail::ControlBlock< ClientControlBlock >* >(event.udata));
         }
 
+        /** Get SharedPtr to the ClientControlBlock from the owner of the ClientControlBlock::DeadlineTimer. */
+        FORCEINLINE SharedPtr<ClientControlBlock> getClientFromTimerOwner(void* owner) const
+        {
+            return SharedPtr<ClientControlBlock>(reinterpret_cast< detail::ControlBlock< ClientControlBlock >* >(owner));
+        }
+
+        /** Get the ClientControlBlock from the event's udata without touching the reference count.
+         *
+         *  For the reactor of the client to access the client without the lock. (See [ \ref irc_server_multi_reactor ])
+         */
+        FORCEINLINE const ClientControlBlock* peekClientFromEventUdata(const EventQueue::Event& event) const
+        {
+            return reinterpret_cast<const ClientControlBlock*>(&reinterpret_cast< detail::ControlBlock< ClientControlBlock >* >(event.udata)->data);
+        }
+
     private:
         /** Client command execution function type
          *  @see ClientCommandExecution section in IRC::Server class
          */
-        typedef IRC::EIrcErrorCode (Server::*ClientCommandFuncPtr)(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments);
+        typedef IRC::EIrcErrorCode (Server::*ClientCommandFuncPtr)(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg);
+
+        /** Build the dispatch table of the IRC_CLIENT_COMMAND_LIST. Called once to initialize mClientCommandTable. */
+        static ClientCommandTable<ClientCommandFuncPtr> makeClientCommandTable();
 
         /** 
          *  @name       Client command execution
@@ -181,15 +598,16 @@ namespace IRC
          *  Each function handles permission and validity checks, execution, and all replies.
          */
         ///@{
-#define IRC_CLIENT_COMMAND_X(command_name) IRC::EIrcErrorCode executeClientCommand_##command_name(SharedPtr<ClientControlBlock> client, const std::vector<char*>& arguments);
+#define IRC_CLIENT_COMMAND_X(command_name) IRC::EIrcErrorCode executeClientCommand_##command_name(SharedPtr<ClientControlBlock> client, const ParsedMsg& msg);
         /**
          *  @param      client          [in]  The client to process the command.
-         *  @param      arguments       [in]  Unvalidated arguments that separated by space.  
-         *                              Example: "JOIN #channel1,#channel2 key1 key2 :h ello!@:world"  
-         *                              arguments[0] = "#channel1,#channel2"  
-         *                              arguments[1] = "key1"  
-         *                              arguments[2] = "key2"  
-         *                              arguments[3] = "h ello!@:world"  
+         *  @param      msg             [in]  The parsed message with the unvalidated parameters. (See [ \ref irc_server_parsed_msg ])  
+         *                              Example: "@+draft/reply=1 JOIN #channel1,#channel2 key1 key2 :h ello!@:world"  
+         *                              msg.Tags = "+draft/reply=1"  
+         *                              msg.Params[0] = "#channel1,#channel2"  
+         *                              msg.Params[1] = "key1"  
+         *                              msg.Params[2] = "key2"  
+         *                              msg.Params[3] = "h ello!@:world" (msg.bHasTrailing)  
          *                                    
          *  @return     The error code of the command execution.
          *  @see        Server/ClientCommand/<COMMAND>.cpp
@@ -223,6 +641,9 @@ namespace IRC
          */
         bool registerClient(SharedPtr<ClientControlBlock> client);
 
+        /** Remove the client from the mUnregistedClients with its ClientControlBlock::UnregisteredClientIdx. */
+        void removeUnregisteredClient(SharedPtr<ClientControlBlock> client);
+
         /** Join a client to the exist channel without any error/permission check. */
         void joinClientToChannel(SharedPtr<ClientControlBlock> client, SharedPtr<ChannelControlBlock> channel);
 
@@ -241,18 +662,21 @@ namespace IRC
         ///@{
         /** Send a message to client.
          * 
-         *  @param client   The client to send the message.
-         *  @param msg      The message to send. It can contain CR-LF or not.
+         *  @param client       The client to send the message.
+         *  @param msg          The message to send. It can contain CR-LF or not.
+         *  @param bDroppable   The message can be dropped if the sending queue of the client is full. (See [ \ref irc_server_send_queue_limit ])
+         *                      It is a channel message of the bulk lane. (See [ \ref irc_server_send_lanes ])
          */
-        void sendMsgToClient(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg);
+        void sendMsgToClient(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg, const bool bDroppable = false);
 
         /** Send a message to channel members.
          * 
-         *  @param channel  The channel to send the message.
-         *  @param msg      The message to send. It can contain CR-LF or not.
-         *  @param client   A client to exclude from the message sending.
+         *  @param channel      The channel to send the message.
+         *  @param msg          The message to send. It can contain CR-LF or not.
+         *  @param client       A client to exclude from the message sending.
+         *  @param bDroppable   See sendMsgToClient()
          */
-        void sendMsgToChannel(SharedPtr<ChannelControlBlock> channel, SharedPtr<MsgBlock> msg, SharedPtr<ClientControlBlock> exceptClient = NULL);
+        void sendMsgToChannel(SharedPtr<ChannelControlBlock> channel, SharedPtr<MsgBlock> msg, SharedPtr<ClientControlBlock> exceptClient = NULL, const bool bDroppable = false);
 
         /** Send a message to channels the client is connected
          * 
@@ -261,7 +685,33 @@ namespace IRC
          *  @param msg      The message to send. It can contain CR-LF or not.
          */
         void sendMsgToConnectedChannels(SharedPtr<ClientControlBlock> client, SharedPtr<MsgBlock> msg);
+
+        /** Send a relayed message to client, with the tags of the capabilities it enabled. (See [ \ref irc_server_message_tags ])
+         *
+         *  @param client       The client to send the message.
+         *  @param msg          The message to send without the tags.
+         *  @param msgLen       Length of the message.
+         *  @param clientTags   The client-only tags of the sender to relay, or NULL. (See ParsedMsg::CopyClientOnlyTags())
+         */
+        void sendTaggedMsgToClient(SharedPtr<ClientControlBlock> client, const char* msg, const size_t msgLen, const char* clientTags);
+
+        /** Send a relayed message to channel members, with the tags of the capabilities of each member.
+         *
+         *  The message of each set of the tag capabilities is made once when a member of the set is found, and shared by them.
+         *  @see sendTaggedMsgToClient(), sendMsgToChannel()
+         */
+        void sendTaggedMsgToChannel(SharedPtr<ChannelControlBlock> channel, const char* msg, const size_t msgLen, const char* clientTags, SharedPtr<ClientControlBlock> exceptClient, const bool bDroppable);
         ///@}
+
+        /** Make the message with the tag section of the server-time and the client-only tags.
+         *
+         *  @param msg          The message without the tags.
+         *  @param msgLen       Length of the message.
+         *  @param serverTime   The time of the "time" tag, or NULL. (See FormatUtcTime())
+         *  @param clientTags   The client-only tags, or NULL.
+         *  @return             The tagged message. The tags that do not fit in the message block are dropped, the client-only tags first.
+         */
+        static SharedPtr<MsgBlock> makeTaggedMsg(const char* msg, const size_t msgLen, const char* serverTime, const char* clientTags);
         
     private:
         /** @name Logging */
@@ -271,6 +721,9 @@ namespace IRC
         void logMessage(const std::string& message) const;
 
         void logVerbose(const std::string& message) const;
+
+        /** Log the ReactorControlBlock::DispatchLatency histogram and the busy-poll statistics. (See [ \ref irc_server_dispatch_latency ]) */
+        void logLatencyReport(const ReactorControlBlock& reactor) const;
         ///@}
 
     private:
@@ -278,13 +731,13 @@ namespace IRC
         short       mServerPort;
         std::string mServerPassword;
 
-        int mhListenSocket;
+        ServerConfig mConfig;
 
         /** 
          * @name    Kqueue
          * @brief   Data in the udata of kevent is the controlBlock of the SharedPtr to corresponding ClientControlBlock (except listensocket).
          *          
-         * @see     \li SharedPtr::GetControlBlock(), getClientFromKeventUdata()
+         * @see     \li SharedPtr::GetControlBlock(), getClientFromEventUdata()
          *          \li [ \ref irc_server_kqueue_udata ]
          *         
          * @page    irc_server_kqueue_udata     Technical reason for using the controlBlock of SharedPtr in the kqueue udata
@@ -305,13 +758,42 @@ namespace IRC
          *      전체 프로젝트에서 메모리 해제에 대한 걱정을 없애주고,  
          *      단지 udata와 직접적으로 상호작용하는 작은 코어 부분만 복잡하게 만들기에 유리하다고 판단되었습니다.  
          * 
-         * @see     Server::mhKqueue, SharedPtr::GetControlBlock(), getClientFromKeventUdata()
+         * @see     ReactorControlBlock::Events, SharedPtr::GetControlBlock(), getClientFromEventUdata()
          */
         ///@{
-        int mhKqueue;
-        std::vector<kevent_t> mEventRegistrationQueue;
+        std::vector<ReactorControlBlock*> mReactors;
         ///@}
 
+        /** Lock of the server state shared by the reactors. (See [ \ref irc_server_multi_reactor ]) */
+        pthread_mutex_t mStateLock;
+
+        /** ReactorControlBlock::TickTime of the reactor holding the mStateLock, used as the queued time of the sent messages. (See [ \ref irc_server_send_lanes ]) */
+        uint64_t mLockedTickTime;
+
+        /** Set when a reactor is terminated, to stop the other reactors. */
+        bool mbShutdown;
+
+        /** Set by RequestUpgrade() from the signal handler, and checked by the event loops. (See [ \ref irc_server_hot_upgrade ]) */
+        static volatile sig_atomic_t mbUpgradeRequested;
+
+        /** Write ends of the wakeup sockets of the running reactors, written by RequestUpgrade(). Only the first mNumUpgradeWakeupSockets are valid. */
+        static volatile int mhUpgradeWakeupSockets[REACTOR_MAX];
+        static volatile sig_atomic_t mNumUpgradeWakeupSockets;
+
+        /** Dispatch table of the client commands. (See [ \ref irc_server_command_dispatch ]) */
+        static const ClientCommandTable<ClientCommandFuncPtr> mClientCommandTable;
+
+        /** Number of the connected clients of all reactors. (See ServerConfig::MaxClients) */
+        size_t mNumClients;
+
+        /** A descriptor kept open to be freed when the descriptors run out. (See shedPendingConnection()) */
+        int mhReserveFd;
+
+#if defined(IRC_ZEROCOPY_SUPPORTED)
+        /** Message blocks of the MSG_ZEROCOPY sends not notified at the hot upgrade. Released when the server is deleted. (See [ \ref irc_server_hot_upgrade ]) */
+        std::vector< SharedPtr<MsgBlock> > mHandedOverZeroCopyMsgBlocks;
+#endif
+
         /**
          *  @name   Client lists
          *  @warning    Do not release a client if the client's event is still exists in the kqueue.
@@ -323,12 +805,6 @@ namespace IRC
         std::map< std::string, SharedPtr< ClientControlBlock > > mClients;
         ///@}
 
-        /** Queue to release expired clients
-         * 
-         *  @see   ClientDisconnection section in IRC::Server class
-        */
-        std::vector< SharedPtr< ClientControlBlock > > mClientReleaseQueue;
-
         /** Channel name to channel map 
          * 
          *  @warning
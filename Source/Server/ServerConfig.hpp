@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Core/Core.hpp"
+using namespace IRCCore;
+
+#include "Server/IrcConstants.hpp"
+
+namespace IRC
+{
+
+/** What to do with a client whose sending queue exceeds the ServerConfig::SendQueueLimit. */
+enum ESendQueuePolicy
+{
+    /** Disconnect the client with "SendQ exceeded". */
+    SENDQ_POLICY_DISCONNECT,
+
+    /** Drop the channel messages (PRIVMSG to a channel) to the client, and disconnect only if the other messages exceed. */
+    SENDQ_POLICY_DROP_CHANNEL_MSG
+};
+
+/** Runtime options of the server.
+ *
+ * @details Set by the command line options. (See main.cpp)
+ *          The default values keep the behavior of the server without any option.
+ */
+struct ServerConfig
+{
+public:
+    /** Number of the event loop threads. (1 ~ Constants::REACTOR_MAX)
+     *
+     *  Each reactor has its own listen socket sharing the port with SO_REUSEPORT, event queue and clients.
+     *  @see ReactorControlBlock
+     */
+    unsigned int NumReactors;
+
+    /** Register the client sockets edge-triggered. (EV_CLEAR / EPOLLET)
+     *
+     *  The sockets are received until EAGAIN, and the WRITE filter is registered once and re-armed with FLAG_ENABLE,
+     *  instead of the ADD/DELETE pair of every burst of the level-triggered mode.
+     */
+    bool bEdgeTriggered;
+
+    /** Max number of the connected clients. (1 ~ Constants::CLIENT_MAX)
+     *
+     *  The listen sockets are disabled at the limit until a client is disconnected.
+     */
+    size_t MaxClients;
+
+    /** Max bytes of the unsent messages of a client. (0 is unlimited, else at least Constants::MESSAGE_LEN_MAX. Set by --sendq)
+     *
+     *  A slow consumer is handled by the SendQueuePolicy instead of growing the sending queue without limit.
+     *  @see ClientControlBlock::NumSendingQueueBytes
+     */
+    size_t SendQueueLimit;
+
+    ESendQueuePolicy SendQueuePolicy;
+
+    /** A writev() of a client gathering this or more bytes is sent with MSG_ZEROCOPY. (0 is off, else at least Constants::MESSAGE_LEN_MAX)
+     *
+     *  Linux with the epoll backend only. The other builds ignore it.
+     *  @see [ \ref irc_server_zerocopy ]
+     */
+    size_t ZeroCopyThreshold;
+
+    /** Set TCP_NODELAY on the client sockets. (Set by --tcp-nodelay)
+     *
+     *  The messages queued in a tick are already sent at once at the end of the tick,
+     *  so Nagle's algorithm only holds the last partial segment of it until the previous one is acknowledged.
+     *  @see [ \ref irc_server_output_batching ]
+     */
+    bool bTcpNoDelay;
+
+    /** Spin with the zero timeout Wait() for this microseconds before blocking, and set SO_BUSY_POLL of the client sockets. (0 is off, else up to Constants::BUSY_POLL_MICROSEC_MAX)
+     *
+     *  Lower wakeup latency for a CPU core spinning while idle. Off by default, because the spin takes the CPU of the other threads on a small host.
+     *  @see [ \ref irc_server_busy_poll ]
+     */
+    unsigned int BusyPollMicrosec;
+
+    /** Record the latency from the kernel receive time to the dispatch of the READ events, and log the histogram every Constants::LATENCY_REPORT_INTERVAL.
+     *
+     *  Linux with the epoll backend only.
+     *  @see [ \ref irc_server_dispatch_latency ]
+     */
+    bool bLatencyHistogram;
+
+    /** Copy the short replies of a client into a shared page at the tail of its sending queue instead of a message block per reply. (Set by --coalesce-replies)
+     *
+     *  @see [ \ref irc_server_reply_coalescing ]
+     */
+    bool bCoalesceReplies;
+
+    /** Arguments of the process, to exec the new binary with the same options at the hot upgrade. (See [ \ref irc_server_hot_upgrade ]) */
+    std::vector<std::string> CommandLine;
+
+    /** Unix socket to receive the state from the old process, or -1 to start fresh. (Set by the internal --upgrade-fd option)
+     *
+     *  @see [ \ref irc_server_hot_upgrade ]
+     */
+    int hUpgradeSocket;
+
+    FORCEINLINE ServerConfig()
+        : NumReactors(1)
+        , bEdgeTriggered(false)
+        , MaxClients(CLIENT_MAX)
+        , SendQueueLimit(0)
+        , SendQueuePolicy(SENDQ_POLICY_DISCONNECT)
+        , ZeroCopyThreshold(0)
+        , bTcpNoDelay(false)
+        , BusyPollMicrosec(0)
+        , bLatencyHistogram(false)
+        , bCoalesceReplies(false)
+        , CommandLine()
+        , hUpgradeSocket(-1)
+    {
+    }
+};
+
+} // namespace IRC
@@ -1,24 +1,106 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <csignal>
 
 #include "Server/Server.hpp"
 
-// Usage :   ./<executable> <port> <password>
+// SIGUSR2 : Hand over the live connections to a new process of the binary. (See [ \ref irc_server_hot_upgrade ])
+static void handleUpgradeSignal(int signalNumber)
+{
+    (void)signalNumber;
+    IRC::Server::RequestUpgrade();
+}
+
+// Usage :   ./<executable> <port> <password> [--reactors=<N>] [--edge-triggered] [--max-clients=<N>] [--sendq=<bytes>] [--sendq-policy=disconnect|drop-channel] [--zerocopy=<bytes>] [--tcp-nodelay] [--busy-poll=<us>] [--latency-histogram] [--coalesce-replies]
 int main(int argc, char** argv)
 {
     // Invalid number of arguments
-    if (argc != 3)
+    if (argc < 3)
     {
-        std::cerr << "Usage: " << argv[0] << " <port> <password>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <port> <password> [--reactors=<N>] [--edge-triggered] [--max-clients=<N>] [--sendq=<bytes>] [--sendq-policy=disconnect|drop-channel] [--zerocopy=<bytes>] [--tcp-nodelay] [--busy-poll=<us>] [--latency-histogram] [--coalesce-replies]" << std::endl;
         return 1;
     }
 
+    IRC::ServerConfig config;
+    config.CommandLine.assign(argv, argv + 3);
+    for (int argIdx = 3; argIdx < argc; argIdx++)
+    {
+        if (std::strncmp(argv[argIdx], "--reactors=", std::strlen("--reactors=")) == 0)
+        {
+            config.NumReactors = std::atoi(argv[argIdx] + std::strlen("--reactors="));
+        }
+        else if (std::strcmp(argv[argIdx], "--edge-triggered") == 0)
+        {
+            config.bEdgeTriggered = true;
+        }
+        else if (std::strncmp(argv[argIdx], "--max-clients=", std::strlen("--max-clients=")) == 0)
+        {
+            config.MaxClients = std::strtoul(argv[argIdx] + std::strlen("--max-clients="), NULL, 10);
+        }
+        else if (std::strncmp(argv[argIdx], "--sendq=", std::strlen("--sendq=")) == 0)
+        {
+            config.SendQueueLimit = std::strtoul(argv[argIdx] + std::strlen("--sendq="), NULL, 10);
+        }
+        else if (std::strcmp(argv[argIdx], "--sendq-policy=disconnect") == 0)
+        {
+            config.SendQueuePolicy = IRC::SENDQ_POLICY_DISCONNECT;
+        }
+        else if (std::strcmp(argv[argIdx], "--sendq-policy=drop-channel") == 0)
+        {
+            config.SendQueuePolicy = IRC::SENDQ_POLICY_DROP_CHANNEL_MSG;
+        }
+        else if (std::strncmp(argv[argIdx], "--zerocopy=", std::strlen("--zerocopy=")) == 0)
+        {
+            config.ZeroCopyThreshold = std::strtoul(argv[argIdx] + std::strlen("--zerocopy="), NULL, 10);
+        }
+        else if (std::strcmp(argv[argIdx], "--tcp-nodelay") == 0)
+        {
+            config.bTcpNoDelay = true;
+        }
+        else if (std::strncmp(argv[argIdx], "--busy-poll=", std::strlen("--busy-poll=")) == 0)
+        {
+            config.BusyPollMicrosec = std::strtoul(argv[argIdx] + std::strlen("--busy-poll="), NULL, 10);
+        }
+        else if (std::strcmp(argv[argIdx], "--latency-histogram") == 0)
+        {
+            config.bLatencyHistogram = true;
+        }
+        else if (std::strcmp(argv[argIdx], "--coalesce-replies") == 0)
+        {
+            config.bCoalesceReplies = true;
+        }
+        // Internal. Added by the old process at the hot upgrade.
+        else if (std::strncmp(argv[argIdx], "--upgrade-fd=", std::strlen("--upgrade-fd=")) == 0)
+        {
+            config.hUpgradeSocket = std::atoi(argv[argIdx] + std::strlen("--upgrade-fd="));
+            continue;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << argv[argIdx] << std::endl;
+            std::cerr << "Usage: " << argv[0] << " <port> <password> [--reactors=<N>] [--edge-triggered] [--max-clients=<N>] [--sendq=<bytes>] [--sendq-policy=disconnect|drop-channel] [--zerocopy=<bytes>] [--tcp-nodelay] [--busy-poll=<us>] [--latency-histogram] [--coalesce-replies]" << std::endl;
+            return 1;
+        }
+        config.CommandLine.push_back(argv[argIdx]);
+    }
+
+    // Without SA_RESTART, so that the Wait() of the event loop is interrupted. The other reactors are woken up by the handler.
+    struct sigaction upgradeAction;
+    std::memset(&upgradeAction, 0, sizeof(upgradeAction));
+    upgradeAction.sa_handler = handleUpgradeSignal;
+    sigemptyset(&upgradeAction.sa_mask);
+    sigaction(SIGUSR2, &upgradeAction, NULL);
+
+    // A send to a socket reset by the peer fails with EPIPE instead of terminating the process. (writev() has no MSG_NOSIGNAL)
+    signal(SIGPIPE, SIG_IGN);
+
     std::string serverName("IRCServer");
     const short port = std::atoi(argv[1]); 
     const char* password = argv[2];
     IRC::Server* server = NULL;
 
-    IRC::EIrcErrorCode err = IRC::Server::CreateServer(&server, serverName, port, password);
+    IRC::EIrcErrorCode err = IRC::Server::CreateServer(&server, serverName, port, password, config);
     if (server == NULL)
     {
         std::cerr << IRC::GetIrcErrorMessage(err) << std::endl;
@@ -0,0 +1,183 @@
+// Benchmark of the name validators and the comma list splitter, against the loops of the handlers before them. (See Source/Core/CharClass.hpp)
+// The results are checked by CharClassTest.cpp.
+//
+//  $ make bench_char_class && ./CharClassBench [million tokens]
+//
+// - validate    : ns/token of the nicknames, channel names and long tokens.
+// - split       : ns/list of the JOIN/PRIVMSG target lists.
+
+#include <time.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/CharClass.hpp"
+#include "CharClassReference.hpp"
+
+using namespace IRCCore;
+
+#define NUM_TOKENS_M        4
+#define NUM_LIST_ITEMS_MAX  256
+
+static double getTimeSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static unsigned int gSeed = 12345;
+static unsigned int nextRandom()
+{
+    gSeed = gSeed * 1103515245 + 12345;
+    return (gSeed >> 16) & 0x7fff;
+}
+
+static void report(const char* name, const double sec, const size_t numOps, const size_t checksum)
+{
+    std::cout << "  " << std::left << std::setw(26) << name << std::right
+              << " " << std::fixed << std::setprecision(2) << std::setw(7) << sec * 1000000000.0 / numOps << " ns"
+              << "  (checksum " << checksum << ")" << std::endl;
+}
+
+static void benchValidation(const char* title, const std::vector<std::string>& tokens, const size_t numOps)
+{
+    std::cout << title << std::endl;
+    const CharClass& nicknameChars = GetNicknameCharClass();
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            checksum += isValidNicknameOld(tokens[i % tokens.size()].c_str());
+        }
+        report("isalnum loop", getTimeSec() - start, numOps, checksum);
+    }
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            const std::string& token = tokens[i % tokens.size()];
+            checksum += (nicknameChars.FindNonMemberScalar(token.data(), token.size()) == token.size());
+        }
+        report("table", getTimeSec() - start, numOps, checksum);
+    }
+#if defined(__SSSE3__)
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            const std::string& token = tokens[i % tokens.size()];
+            checksum += (nicknameChars.FindNonMemberSsse3(token.data(), token.size()) == token.size());
+        }
+        report("nibble tables SSSE3", getTimeSec() - start, numOps, checksum);
+    }
+#endif
+}
+
+typedef size_t (*SplitFunc)(const char* str, const size_t len, StrView* outItems, const size_t maxNumItems);
+
+struct Splitter
+{
+    const char* Name;
+    SplitFunc Func;
+};
+
+static void benchSplit(const char* title, const std::vector<std::string>& lists, const size_t numOps)
+{
+    std::cout << title << std::endl;
+
+    // Every splitter splits a copy of the list, as the old one modifies it.
+    char buffer[512];
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            const std::string& list = lists[i % lists.size()];
+            std::memcpy(buffer, list.c_str(), list.size() + 1);
+            std::vector<const char*> items;
+            splitCommaListOld(buffer, items);
+            checksum += items.size();
+        }
+        report("'\\0' loop + vector", getTimeSec() - start, numOps, checksum);
+    }
+
+    std::vector<Splitter> splitters;
+    Splitter scalar = { "views scalar", SplitCommaListScalar };
+    splitters.push_back(scalar);
+#if defined(__SSE2__)
+    Splitter sse2 = { "views SSE2", SplitCommaListSse2 };
+    splitters.push_back(sse2);
+#endif
+    for (size_t splitterIdx = 0; splitterIdx < splitters.size(); splitterIdx++)
+    {
+        StrView items[NUM_LIST_ITEMS_MAX];
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            const std::string& list = lists[i % lists.size()];
+            std::memcpy(buffer, list.c_str(), list.size() + 1);
+            checksum += splitters[splitterIdx].Func(buffer, list.size(), items, NUM_LIST_ITEMS_MAX);
+        }
+        report(splitters[splitterIdx].Name, getTimeSec() - start, numOps, checksum);
+    }
+}
+
+static std::string makeName(const size_t len, const char* prefix)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    std::string name(prefix);
+    while (name.size() < len)
+    {
+        name += chars[nextRandom() % (sizeof(chars) - 1)];
+    }
+    return name;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t numOps = ((argc > 1) ? std::atoi(argv[1]) : NUM_TOKENS_M) * 1000000;
+
+    std::vector<std::string> nicknames;
+    std::vector<std::string> channelNames;
+    std::vector<std::string> longTokens;
+    std::vector<std::string> shortLists;
+    std::vector<std::string> longLists;
+    for (size_t i = 0; i < 1024; i++)
+    {
+        nicknames.push_back(makeName(3 + nextRandom() % 7, ""));
+        channelNames.push_back(makeName(6 + nextRandom() % 20, ""));
+        longTokens.push_back(makeName(200, ""));
+
+        std::string shortList = makeName(4 + nextRandom() % 8, "#");
+        if (nextRandom() % 4 == 0)
+        {
+            shortList += "," + makeName(4 + nextRandom() % 8, "#");
+        }
+        shortLists.push_back(shortList);
+
+        std::string longList = makeName(4 + nextRandom() % 8, "#");
+        while (longList.size() < 400)
+        {
+            longList += "," + makeName(4 + nextRandom() % 8, "#");
+        }
+        longLists.push_back(longList);
+    }
+
+    std::cout << "Operations: " << numOps << std::endl;
+    benchValidation("validate nickname (3 ~ 9 bytes)", nicknames, numOps);
+    benchValidation("validate name (6 ~ 25 bytes)", channelNames, numOps);
+    benchValidation("validate long token (200 bytes)", longTokens, numOps / 4);
+    benchSplit("split 1 ~ 2 targets", shortLists, numOps);
+    benchSplit("split 400 byte list", longLists, numOps / 4);
+    return 0;
+}
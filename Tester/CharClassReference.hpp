@@ -0,0 +1,52 @@
+#pragma once
+
+// The loops of the handlers before the CharClass, shared by CharClassBench and CharClassTest as the reference.
+
+#include <cctype>
+#include <vector>
+
+// The validation of the NICK before the CharClass
+inline bool isValidNicknameOld(const char* str)
+{
+    for (const char* p = str; *p != '\0'; p++)
+    {
+        if (isalnum(*p) == 0 && *p != '_')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The validation of the USER before the CharClass
+inline bool isValidUserParamOld(const char* str)
+{
+    for (const char* p = str; *p != '\0'; p++)
+    {
+        if (isalnum(*p) == 0 && *p != '_' && *p != '*')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The splitter of the JOIN/PART/PRIVMSG before the CharClass. Modifies the list.
+inline void splitCommaListOld(char* list, std::vector<const char*>& items)
+{
+    for (char* p = list; *p != '\0'; p++)
+    {
+        if (*p != ',')
+        {
+            items.push_back(p);
+        }
+        for (; *p != '\0' && *p != ','; p++)
+        {
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        *p = '\0';
+    }
+}
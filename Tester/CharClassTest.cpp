@@ -0,0 +1,175 @@
+// Equivalence test of the name validators and the comma list splitter. (See Source/Core/CharClass.hpp)
+//
+//  $ make test_char_class [CASES=<fuzz cases>]
+//
+// Random strings are validated and split by the loops of the handlers before the CharClass
+// (isalnum() loops of the NICK/USER, '\0' writing loops of the JOIN/PART/PRIVMSG), and by every validator
+// and splitter of the CharClass.hpp. Any difference is printed and the exit code is 1.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/CharClass.hpp"
+#include "CharClassReference.hpp"
+
+using namespace IRCCore;
+
+#define NUM_FUZZ_CASES      200000
+#define NUM_LIST_ITEMS_MAX  256
+
+static unsigned int gSeed = 12345;
+static unsigned int nextRandom()
+{
+    gSeed = gSeed * 1103515245 + 12345;
+    return (gSeed >> 16) & 0x7fff;
+}
+
+static size_t findNonMemberReference(CharClass::MemberFunc isMember, const std::string& str)
+{
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        if (!isMember(static_cast<unsigned char>(str[i])))
+        {
+            return i;
+        }
+    }
+    return str.size();
+}
+
+// Random string, without '\0' if bNoNull. Mostly the characters of the names, sometimes any byte.
+static std::string makeFuzzString(const size_t maxLen, const char* alphabet, const bool bNoNull)
+{
+    const size_t len = nextRandom() % (maxLen + 1);
+    const size_t alphabetLen = std::strlen(alphabet);
+    std::string str;
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = (nextRandom() % 16 == 0) ? static_cast<char>(nextRandom() % 256) : alphabet[nextRandom() % alphabetLen];
+        if (bNoNull && c == '\0')
+        {
+            c = 'x';
+        }
+        str += c;
+    }
+    return str;
+}
+
+static size_t gNumMismatches = 0;
+static void expect(const bool bEqual, const char* what, const std::string& str)
+{
+    if (!bEqual && gNumMismatches++ < 10)
+    {
+        std::cout << "  MISMATCH " << what << ": \"" << str << "\"" << std::endl;
+    }
+}
+
+static void checkEquivalence(const size_t numCases)
+{
+    static const char nameAlphabet[] = "abcXYZ019_*#&-[]{}\\|^`,:. \t\a";
+    static const char listAlphabet[] = ",,,#abc";
+
+    struct Class
+    {
+        const char* Name;
+        const CharClass* Chars;
+        CharClass::MemberFunc IsMember;
+    };
+    const Class classes[] = {
+        { "nickname", &GetNicknameCharClass(), detail::IsNicknameChar },
+        { "user", &GetUserParamCharClass(), detail::IsUserParamChar },
+        { "channel", &GetChannelCharClass(), detail::IsChannelChar },
+        { "key", &GetKeyCharClass(), detail::IsKeyChar },
+    };
+
+    for (size_t caseIdx = 0; caseIdx < numCases; caseIdx++)
+    {
+        // Validators, against the old loops and the predicates
+        const std::string name = makeFuzzString(64, nameAlphabet, true);
+        expect(isValidNicknameOld(name.c_str()) == GetNicknameCharClass().IsValid(name.data(), name.size()), "nickname", name);
+        expect(isValidUserParamOld(name.c_str()) == GetUserParamCharClass().IsValid(name.data(), name.size()), "user", name);
+
+        const std::string anyBytes = makeFuzzString(80, nameAlphabet, false);
+        for (size_t classIdx = 0; classIdx < sizeof(classes) / sizeof(classes[0]); classIdx++)
+        {
+            const size_t expected = findNonMemberReference(classes[classIdx].IsMember, anyBytes);
+            expect(classes[classIdx].Chars->FindNonMemberScalar(anyBytes.data(), anyBytes.size()) == expected, classes[classIdx].Name, anyBytes);
+#if defined(__SSSE3__)
+            expect(classes[classIdx].Chars->IsNibbleExact(), classes[classIdx].Name, "(nibble tables not exact)");
+            expect(classes[classIdx].Chars->FindNonMemberSsse3(anyBytes.data(), anyBytes.size()) == expected, classes[classIdx].Name, anyBytes);
+#endif
+        }
+
+        // Splitters, against the old loop
+        const std::string list = makeFuzzString(300, listAlphabet, true);
+        std::vector<char> writableList(list.begin(), list.end());
+        writableList.push_back('\0');
+        std::vector<const char*> oldItems;
+        splitCommaListOld(&writableList[0], oldItems);
+
+        StrView items[NUM_LIST_ITEMS_MAX];
+        const size_t numScalarItems = SplitCommaListScalar(list.data(), list.size(), items, NUM_LIST_ITEMS_MAX);
+        bool bEqual = (numScalarItems == oldItems.size());
+        for (size_t i = 0; bEqual && i < numScalarItems; i++)
+        {
+            bEqual = (std::string(items[i].Str, items[i].Len) == oldItems[i]);
+        }
+        expect(bEqual, "split scalar", list);
+#if defined(__SSE2__)
+        const size_t numSse2Items = SplitCommaListSse2(list.data(), list.size(), items, NUM_LIST_ITEMS_MAX);
+        bEqual = (numSse2Items == oldItems.size());
+        for (size_t i = 0; bEqual && i < numSse2Items; i++)
+        {
+            bEqual = (std::string(items[i].Str, items[i].Len) == oldItems[i]);
+        }
+        expect(bEqual, "split SSE2", list);
+#endif
+    }
+    std::cout << "Equivalence: " << numCases << " cases, " << gNumMismatches << " mismatches" << std::endl;
+}
+
+// The checks that differ from the old handlers on purpose.
+// - The channel name is the RFC 2812 chanstring, so "#a:b" is not a channel.
+// - The key of the MODE +k must be sent by the JOIN, so "a,b" gets 525 ERR_INVALIDKEY.
+static void checkFixedCases()
+{
+    struct Case
+    {
+        const CharClass* Chars;
+        const char* Name;
+        const char* Str;
+        bool bValid;
+    };
+    const Case cases[] = {
+        { &GetNicknameCharClass(), "nickname", "Nick_09", true },
+        { &GetNicknameCharClass(), "nickname", "nick-1", false },
+        { &GetUserParamCharClass(), "user", "user*", true },
+        { &GetChannelCharClass(), "channel", "#chan.&[]{}", true },
+        { &GetChannelCharClass(), "channel", "#a:b", false },
+        { &GetChannelCharClass(), "channel", "#a,b", false },
+        { &GetChannelCharClass(), "channel", "#a b", false },
+        { &GetChannelCharClass(), "channel", "#a\ab", false },
+        { &GetKeyCharClass(), "key", "s3cr3t!#:", true },
+        { &GetKeyCharClass(), "key", "a,b", false },
+        { &GetKeyCharClass(), "key", "a b", false },
+        { &GetKeyCharClass(), "key", "a\tb", false },
+        { &GetKeyCharClass(), "key", "caf\xc3\xa9", false },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const std::string str(cases[i].Str);
+        expect(cases[i].Chars->IsValid(str.data(), str.size()) == cases[i].bValid, cases[i].Name, str);
+    }
+    std::cout << "Fixed cases: " << sizeof(cases) / sizeof(cases[0]) << " cases, " << gNumMismatches << " mismatches in total" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t numFuzzCases = (argc > 1) ? std::atoi(argv[1]) : NUM_FUZZ_CASES;
+
+    checkEquivalence(numFuzzCases);
+    checkFixedCases();
+    return (gNumMismatches == 0) ? 0 : 1;
+}
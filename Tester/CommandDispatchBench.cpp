@@ -0,0 +1,151 @@
+// Benchmark of the client command dispatch. (See Source/Server/ClientCommand/ClientCommand.hpp)
+//
+//  $ make bench_command_dispatch && ./CommandDispatchBench [million lookups] [rounds]
+//
+// The command tokens are a mix of the client messages, mostly PRIVMSG and PING, with lower case and unknown commands.
+// - strcmp scan : Build the name/function array of the IRC_CLIENT_COMMAND_LIST on every lookup and strcmp() every name
+//                 (the dispatch before the table). It is case-sensitive, so the lower case tokens are unknown.
+// - table       : ClientCommandTable::Find() of the table built once. Case-insensitive.
+
+#include <time.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "Server/ClientCommand/ClientCommand.hpp"
+
+using namespace IRC;
+
+#define NUM_LOOKUPS_M       16
+#define NUM_ROUNDS          5
+
+typedef size_t (*CommandFunc)(size_t arg);
+
+#define IRC_CLIENT_COMMAND_X(command_name) static size_t execute_##command_name(size_t arg) { return arg + sizeof(#command_name); }
+IRC_CLIENT_COMMAND_LIST
+#undef  IRC_CLIENT_COMMAND_X
+
+static double getTimeSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static unsigned int gSeed = 12345;
+static unsigned int nextRandom()
+{
+    gSeed = gSeed * 1103515245 + 12345;
+    return (gSeed >> 16) & 0x7fff;
+}
+
+static const char* pickCommand()
+{
+    const unsigned int kind = nextRandom() % 100;
+    if (kind < 60) return "PRIVMSG";
+    if (kind < 75) return "PING";
+    if (kind < 80) return "PONG";
+    if (kind < 84) return "JOIN";
+    if (kind < 88) return "MODE";
+    if (kind < 90) return "PART";
+    if (kind < 91) return "NICK";
+    if (kind < 92) return "TOPIC";
+    if (kind < 93) return "QUIT";
+    if (kind < 96) return "privmsg";
+    if (kind < 97) return "ping";
+    if (kind < 98) return "LIST";
+    if (kind < 99) return "WHO";
+    return "NOTICE";
+}
+
+static CommandFunc findStrcmpScan(const char* command)
+{
+    typedef struct {
+        const char*     command;
+        CommandFunc     func;
+    } CommandFuncPair;
+
+    const CommandFuncPair commandFuncPairs[] = {
+#define IRC_CLIENT_COMMAND_X(command_name) { #command_name, execute_##command_name },
+        IRC_CLIENT_COMMAND_LIST
+#undef  IRC_CLIENT_COMMAND_X
+    };
+    const size_t numCommandFunc = sizeof(commandFuncPairs) / sizeof(commandFuncPairs[0]);
+
+    for (size_t i = 0; i < numCommandFunc; i++)
+    {
+        if (std::strcmp(command, commandFuncPairs[i].command) == 0)
+        {
+            return commandFuncPairs[i].func;
+        }
+    }
+    return NULL;
+}
+
+static void report(const char* name, const double sec, const size_t numLookups, const size_t numFound, const size_t checksum)
+{
+    std::cout << "  " << std::left << std::setw(14) << name << std::right
+              << " " << std::fixed << std::setprecision(2) << std::setw(6) << sec * 1000000000.0 / numLookups << " ns/lookup"
+              << "  (found " << numFound << ", checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t numLookupsM = (argc > 1) ? std::atoi(argv[1]) : NUM_LOOKUPS_M;
+    const size_t numRounds = (argc > 2) ? std::atoi(argv[2]) : NUM_ROUNDS;
+
+    // Copies of the tokens, like the tokens in the received messages
+    std::vector<char> tokenBuffer;
+    std::vector<size_t> tokenOffsets;
+    for (size_t i = 0; i < 4096; i++)
+    {
+        const char* command = pickCommand();
+        tokenOffsets.push_back(tokenBuffer.size());
+        tokenBuffer.insert(tokenBuffer.end(), command, command + std::strlen(command) + 1);
+    }
+    const size_t numLookups = numLookupsM * 1000000;
+
+    ClientCommandTable<CommandFunc> table;
+#define IRC_CLIENT_COMMAND_X(command_name) table.Add(#command_name, execute_##command_name);
+    IRC_CLIENT_COMMAND_LIST
+#undef  IRC_CLIENT_COMMAND_X
+    std::cout << "Lookups: " << numLookups << " x " << numRounds << " rounds, table collisions: " << table.GetNumCollisions() << std::endl;
+
+    for (size_t round = 0; round < numRounds; round++)
+    {
+        {
+            size_t numFound = 0;
+            size_t checksum = 0;
+            const double start = getTimeSec();
+            for (size_t i = 0; i < numLookups; i++)
+            {
+                const CommandFunc func = findStrcmpScan(&tokenBuffer[tokenOffsets[i % tokenOffsets.size()]]);
+                if (func != NULL)
+                {
+                    numFound++;
+                    checksum = func(checksum);
+                }
+            }
+            report("strcmp scan", getTimeSec() - start, numLookups, numFound, checksum);
+        }
+        {
+            size_t numFound = 0;
+            size_t checksum = 0;
+            const double start = getTimeSec();
+            for (size_t i = 0; i < numLookups; i++)
+            {
+                const CommandFunc func = table.Find(&tokenBuffer[tokenOffsets[i % tokenOffsets.size()]]);
+                if (func != NULL)
+                {
+                    numFound++;
+                    checksum = func(checksum);
+                }
+            }
+            report("table", getTimeSec() - start, numLookups, numFound, checksum);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Benchmark of the event queue backend. (See Source/Network/EventQueue.hpp)
+//
+// Build each backend and compare the results.
+//  $ make bench_epoll  && ./EventQueueBench_epoll
+//  $ make bench_io_uring && ./EventQueueBench_io_uring
+//  $ make bench_kqueue && ./EventQueueBench_kqueue     (libkqueue on Linux)
+//
+// Each round writes a byte to random socket pairs and runs one iteration of the loop that the server runs:
+// Wait() with the pending change list, then recv() on READ events and toggle the WRITE filter like sendMsgToClient() does.
+// The latency of one round is from the start of Wait() to the end of the dispatch.
+// With io_uring, the bytes are already received when the READ event is observed, so recv() is not called.
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Network/EventQueue.hpp"
+
+using namespace IRC;
+
+#define NUM_SOCKET_PAIRS    1024
+#define NUM_ACTIVE_PER_ROUND 64
+#define NUM_ROUNDS          20000
+#define MAX_EVENTS          1024
+
+static double getTimeMicrosec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    const int numPairs  = (argc > 1) ? std::atoi(argv[1]) : NUM_SOCKET_PAIRS;
+    const int numActive = (argc > 2) ? std::atoi(argv[2]) : NUM_ACTIVE_PER_ROUND;
+    const int numRounds = (argc > 3) ? std::atoi(argv[3]) : NUM_ROUNDS;
+
+    EventQueue eventQueue;
+    if (eventQueue.Create() == false)
+    {
+        std::cerr << "Failed to create the event queue" << std::endl;
+        return 1;
+    }
+
+    // Create socket pairs and register the server side to the event queue.
+    // udata is the index of the pair like the server passes the client.
+    std::vector<int> serverSides(numPairs);
+    std::vector<int> clientSides(numPairs);
+    std::vector<EventQueue::Event> changes;
+    changes.reserve(numPairs * 2);
+    for (int i = 0; i < numPairs; i++)
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1)
+        {
+            std::cerr << "Failed to create socketpair. (Check ulimit -n)" << std::endl;
+            return 1;
+        }
+        fcntl(pair[0], F_SETFL, O_NONBLOCK);
+        fcntl(pair[1], F_SETFL, O_NONBLOCK);
+        serverSides[i] = pair[0];
+        clientSides[i] = pair[1];
+
+        EventQueue::Event ev;
+        EventQueue::SetEvent(ev, pair[0], EventQueue::FILTER_READ, EventQueue::FLAG_ADD, reinterpret_cast<void*>(static_cast<intptr_t>(i)));
+        changes.push_back(ev);
+    }
+
+    std::vector<EventQueue::Event> events(MAX_EVENTS);
+    std::vector<double> latencies;
+    latencies.reserve(numRounds);
+
+    struct timespec timeoutZero;
+    timeoutZero.tv_sec  = 0;
+    timeoutZero.tv_nsec = 0;
+
+    srand(42);
+    int64_t totalEvents = 0;
+    double totalTime = 0;
+    for (int round = 0; round < numRounds; round++)
+    {
+        for (int i = 0; i < numActive; i++)
+        {
+            const char byte = 'x';
+            const ssize_t nSent = send(clientSides[rand() % numPairs], &byte, 1, 0);
+            (void)nSent;
+        }
+
+        const double beginTime = getTimeMicrosec();
+
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+        eventQueue.RecycleRecvBuffers();
+#endif
+        const int numEvents = eventQueue.Wait(changes.empty() ? NULL : &changes[0], changes.size(), &events[0], MAX_EVENTS, &timeoutZero);
+        if (numEvents == -1)
+        {
+            std::cerr << "Failed to wait the event queue" << std::endl;
+            return 1;
+        }
+        changes.clear();
+
+        for (int i = 0; i < numEvents; i++)
+        {
+            const EventQueue::Event& currEvent = events[i];
+            const int pairIdx = static_cast<int>(reinterpret_cast<intptr_t>(currEvent.udata));
+
+            if (currEvent.filter == EventQueue::FILTER_READ)
+            {
+#if defined(IRC_EVENT_BACKEND_IO_URING)
+                (void)eventQueue.GetRecvBuffer(currEvent);
+#else
+                char buf[512];
+                const ssize_t nRecv = recv(serverSides[pairIdx], buf, sizeof(buf), 0);
+                (void)nRecv;
+#endif
+
+                EventQueue::Event ev;
+                EventQueue::SetEvent(ev, serverSides[pairIdx], EventQueue::FILTER_WRITE, EventQueue::FLAG_ADD, currEvent.udata);
+                changes.push_back(ev);
+            }
+            else if (currEvent.filter == EventQueue::FILTER_WRITE)
+            {
+                EventQueue::Event ev;
+                EventQueue::SetEvent(ev, serverSides[pairIdx], EventQueue::FILTER_WRITE, EventQueue::FLAG_DELETE, currEvent.udata);
+                changes.push_back(ev);
+            }
+        }
+
+        const double elapsed = getTimeMicrosec() - beginTime;
+        latencies.push_back(elapsed);
+        totalTime += elapsed;
+        totalEvents += numEvents;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const double p50 = latencies[latencies.size() * 50 / 100];
+    const double p99 = latencies[latencies.size() * 99 / 100];
+
+    std::cout << "[EventQueueBench] backend=" << EventQueue::GetBackendName()
+              << " pairs=" << numPairs << " active=" << numActive << " rounds=" << numRounds << std::endl;
+    std::cout << "  events/sec      : " << static_cast<int64_t>(totalEvents / (totalTime / 1000000.0)) << std::endl;
+    std::cout << "  loop latency us : p50=" << p50 << " p99=" << p99 << " max=" << latencies.back() << std::endl;
+
+    for (int i = 0; i < numPairs; i++)
+    {
+        close(serverSides[i]);
+        close(clientSides[i]);
+    }
+
+    return 0;
+}
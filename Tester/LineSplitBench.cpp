@@ -0,0 +1,247 @@
+// Benchmark of the line splitter of the received messages. (See Source/Core/CharScan.hpp)
+//
+//  $ make bench_line_split && ./LineSplitBench [MB of traffic] [rounds]
+//
+// The traffic is a mix of the client messages (PRIVMSG, PING, JOIN, MODE, ...) cut into 512 byte blocks like RecvMsgBlocks.
+// - scan  : Find every '\n' of the traffic with each scanner, and memchr() for the reference.
+// - split : Copy every message into a 512 byte buffer, with the byte loop that checks "\r\n" after every byte
+//           (the splitter before the scanner) and with the scanner and memcpy() like separateMsgsFromClientRecvMsgs().
+
+#include <time.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/CharScan.hpp"
+
+using namespace IRCCore;
+
+#define BLOCK_LEN           512
+#define TRAFFIC_MB          64
+#define NUM_ROUNDS          10
+
+static double getTimeSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static unsigned int gSeed = 12345;
+static unsigned int nextRandom()
+{
+    gSeed = gSeed * 1103515245 + 12345;
+    return (gSeed >> 16) & 0x7fff;
+}
+
+static void appendText(std::string& out, const size_t len)
+{
+    static const char words[][8] = { "hello", "the", "irc", "server", "is", "up", "lol", "ok", "see", "you" };
+    while (out.size() < len)
+    {
+        out += words[nextRandom() % 10];
+        out += ' ';
+    }
+}
+
+// Chat heavy traffic. Most lines are PRIVMSG of 20 ~ 300 bytes.
+static std::string makeTraffic(const size_t len)
+{
+    std::string traffic;
+    traffic.reserve(len + BLOCK_LEN);
+    while (traffic.size() < len)
+    {
+        const unsigned int kind = nextRandom() % 100;
+        const size_t lineStart = traffic.size();
+        if (kind < 80)
+        {
+            traffic += (kind < 60) ? "PRIVMSG #channel" : "PRIVMSG nickname";
+            traffic += " :";
+            appendText(traffic, lineStart + 20 + nextRandom() % 280);
+        }
+        else if (kind < 90)
+        {
+            traffic += "PING :1700000000123";
+        }
+        else if (kind < 95)
+        {
+            traffic += "JOIN #channel,#another key";
+        }
+        else
+        {
+            traffic += "MODE #channel +o nickname";
+        }
+        traffic += "\r\n";
+    }
+    return traffic;
+}
+
+static void report(const char* name, const double sec, const size_t numBytes, const size_t numRounds, const size_t checksum)
+{
+    const double gbPerSec = static_cast<double>(numBytes) * numRounds / sec / 1000000000.0;
+    std::cout << "  " << std::left << std::setw(22) << name << std::right
+              << " " << std::fixed << std::setprecision(2) << std::setw(6) << gbPerSec << " GB/s"
+              << "  (checksum " << checksum << ")" << std::endl;
+}
+
+typedef size_t (*FindLineFeedFunc)(const char* str, const size_t len);
+
+struct Scanner
+{
+    const char* Name;
+    FindLineFeedFunc Func;
+};
+
+static size_t findLineFeedMemchr(const char* str, const size_t len)
+{
+    const void* found = std::memchr(str, '\n', len);
+    return (found != NULL) ? static_cast<const char*>(found) - str : len;
+}
+
+static size_t countLineFeeds(const std::vector<std::string>& blocks, FindLineFeedFunc findLineFeed)
+{
+    size_t count = 0;
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx++)
+    {
+        const char* str = blocks[blockIdx].data();
+        const size_t len = blocks[blockIdx].size();
+        for (size_t idx = findLineFeed(str, len); idx < len; idx = idx + 1 + findLineFeed(str + idx + 1, len - idx - 1))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+// The byte loop. Returns the sum of the message lengths.
+static size_t splitByteLoop(const std::vector<std::string>& blocks)
+{
+    char msg[BLOCK_LEN];
+    size_t msgLen = 0;
+    size_t sum = 0;
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx++)
+    {
+        const char* str = blocks[blockIdx].data();
+        const size_t len = blocks[blockIdx].size();
+        for (size_t i = 0; i < len; i++)
+        {
+            msg[msgLen++] = str[i];
+            if (msgLen >= 2 && msg[msgLen - 2] == '\r' && msg[msgLen - 1] == '\n')
+            {
+                sum += msgLen;
+                msgLen = 0;
+            }
+            else if (msgLen == BLOCK_LEN)
+            {
+                msgLen = 0;
+            }
+        }
+    }
+    return sum;
+}
+
+// The scanner and memcpy(). Returns the sum of the message lengths.
+static size_t splitScanner(const std::vector<std::string>& blocks)
+{
+    char msg[BLOCK_LEN];
+    size_t msgLen = 0;
+    size_t sum = 0;
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx++)
+    {
+        const char* str = blocks[blockIdx].data();
+        const size_t len = blocks[blockIdx].size();
+        size_t i = 0;
+        while (i < len)
+        {
+            const size_t lineFeedIdx = FindLineFeed(str + i, len - i);
+            const bool bLineFeedFound = (i + lineFeedIdx < len);
+            const size_t segmentLen = bLineFeedFound ? lineFeedIdx + 1 : lineFeedIdx;
+            if (msgLen + segmentLen > BLOCK_LEN - 1)
+            {
+                msgLen = 0;
+                i += segmentLen;
+                continue;
+            }
+            std::memcpy(msg + msgLen, str + i, segmentLen);
+            msgLen += segmentLen;
+            i += segmentLen;
+            if (bLineFeedFound && msgLen >= 2 && msg[msgLen - 2] == '\r')
+            {
+                sum += msgLen;
+                msgLen = 0;
+            }
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t trafficMb = (argc > 1) ? std::atoi(argv[1]) : TRAFFIC_MB;
+    const size_t numRounds = (argc > 2) ? std::atoi(argv[2]) : NUM_ROUNDS;
+
+    const std::string traffic = makeTraffic(trafficMb * 1000000);
+    std::vector<std::string> blocks;
+    for (size_t offset = 0; offset < traffic.size(); offset += BLOCK_LEN)
+    {
+        blocks.push_back(traffic.substr(offset, BLOCK_LEN));
+    }
+    const size_t numLines = countLineFeeds(blocks, FindLineFeedScalar);
+    std::cout << "Traffic: " << traffic.size() << " bytes, " << numLines << " lines, "
+              << traffic.size() / numLines << " bytes/line, " << numRounds << " rounds" << std::endl;
+#if defined(IRCCORE_CHAR_SCAN_AVX2)
+    std::cout << "AVX2: " << (IsAvx2Supported() ? "supported" : "not supported") << std::endl;
+#endif
+
+    std::vector<Scanner> scanners;
+    Scanner scalar = { "scan scalar", FindLineFeedScalar };
+    scanners.push_back(scalar);
+#if defined(__SSE2__)
+    Scanner sse2 = { "scan SSE2", FindLineFeedSse2 };
+    scanners.push_back(sse2);
+#endif
+#if defined(IRCCORE_CHAR_SCAN_AVX2)
+    if (IsAvx2Supported())
+    {
+        Scanner avx2 = { "scan AVX2", FindLineFeedAvx2 };
+        scanners.push_back(avx2);
+    }
+#endif
+    Scanner memchrScanner = { "scan memchr", findLineFeedMemchr };
+    scanners.push_back(memchrScanner);
+
+    for (size_t scannerIdx = 0; scannerIdx < scanners.size(); scannerIdx++)
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t round = 0; round < numRounds; round++)
+        {
+            checksum += countLineFeeds(blocks, scanners[scannerIdx].Func);
+        }
+        report(scanners[scannerIdx].Name, getTimeSec() - start, traffic.size(), numRounds, checksum);
+    }
+
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t round = 0; round < numRounds; round++)
+        {
+            checksum += splitByteLoop(blocks);
+        }
+        report("split byte loop", getTimeSec() - start, traffic.size(), numRounds, checksum);
+    }
+    {
+        size_t checksum = 0;
+        const double start = getTimeSec();
+        for (size_t round = 0; round < numRounds; round++)
+        {
+            checksum += splitScanner(blocks);
+        }
+        report("split scanner+memcpy", getTimeSec() - start, traffic.size(), numRounds, checksum);
+    }
+    return 0;
+}
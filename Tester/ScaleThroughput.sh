@@ -0,0 +1,29 @@
+#!/bin/sh
+# Run "./Stress throughput" against the server with 1, 2 and 4 reactors, and print the median messages/sec of each.
+#
+#  $ make && ./ScaleThroughput.sh [port] [pairs] [messages] [runs]
+#
+# Run it on a host with 4 or more cores. The server and the Stress share the cores.
+
+PORT=${1:-6667}
+PAIRS=${2:-100}
+MSGS=${3:-2000}
+RUNS=${4:-3}
+SERVER=../ircserv
+
+for REACTORS in 1 2 4
+do
+    RATES=""
+    for RUN in $(seq 1 "$RUNS")
+    do
+        $SERVER "$PORT" 1234 --reactors="$REACTORS" > /dev/null 2>&1 &
+        SERVER_PID=$!
+        sleep 0.5
+        RATE=$(./Stress throughput "$PAIRS" "$PORT" "$MSGS" | sed -n 's/.*messages\/sec=\([0-9.e+]*\).*/\1/p')
+        kill "$SERVER_PID"
+        wait "$SERVER_PID" 2> /dev/null
+        RATES="$RATES $RATE"
+    done
+    MEDIAN=$(echo "$RATES" | tr ' ' '\n' | grep . | sort -g | sed -n "$(( (RUNS + 1) / 2 ))p")
+    echo "reactors=$REACTORS cores=$(nproc) messages/sec=$MEDIAN (runs:$RATES)"
+done
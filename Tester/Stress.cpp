@@ -1,10 +1,29 @@
+// Stress test of the server.
+//  $ make && ./Stress              : Flood the server from NUM_THREADS clients.
+//  $ make && ./Stress latency [N] [port] : Measure the PRIVMSG round-trip latency between two idle clients. (N rounds)
+//  $ make && ./Stress accept [N] [port]  : Connect and register N clients at once, and measure the connections per second.
+//  $ make && ./Stress disconnect [N] [port] : Close N connected clients at once, and measure the stall of the server with a probe client.
+//  $ make && ./Stress fanout [N] [port] [M]  : Send M long PRIVMSGs to a channel of N members, and measure the deliveries per second.
+//  $ make && ./Stress packets [N] [port] [M] : N clients join a channel and chat M rounds, and measure the packets from the server. (Linux)
+//  $ make && ./Stress throughput [N] [port] [M] : N pairs of clients send M PRIVMSGs to each other at once, and measure the messages per second.
+//  $ make && ./Stress upgrade <pid> [N] [port] : N clients in channels talk while the server of the pid is hot upgraded by SIGUSR2, and check the nicknames, channels and topics after it.
+//  $ make && ./Stress boundary [port] : Send the lines of 509, 510 and 511 bytes without the CR-LF, and check that only the longest one is dropped.
+
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <sys/event.h>
 #include <sys/time.h>
+#include <netinet/in.h>
+#if defined(__linux__)
+#include <linux/tcp.h> //< tcp_info with the segment counters
+#else
+#include <netinet/tcp.h>
+#endif
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
 
 #include <iostream>
 #include <cstdlib>
@@ -12,6 +31,10 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <set>
 
 #define PORT 6667
 #define PASSWORD "1234"
@@ -20,10 +43,76 @@
 #define MAX_PRIVMSG_LENGTH 1234
 #define NUM_THREADS 12
 
+#define NUM_LATENCY_ROUNDS 10000
+#define NUM_ACCEPT_STORM_CLIENTS 5000
+#define ACCEPT_STORM_TIMEOUT_MS 30000
+
+#define NUM_FANOUT_MEMBERS 10000
+#define NUM_FANOUT_MSGS 200
+#define FANOUT_PAYLOAD_LENGTH 400
+#define FANOUT_TIMEOUT_MS 300000
+
+#define NUM_PACKETS_CLIENTS 200
+#define NUM_PACKETS_ROUNDS 100
+
+#define NUM_THROUGHPUT_PAIRS 100
+#define NUM_THROUGHPUT_MSGS 2000
+
+#define NUM_UPGRADE_CLIENTS 100
+#define NUM_UPGRADE_CLIENTS_PER_CHANNEL 10
+#define UPGRADE_TIMEOUT_MS 15000
+
+// RFC 1459 allows 510 bytes of a line without the CR-LF.
+#define LINE_PAYLOAD_LEN_MAX 510
+
+// Shorter than the idle timeout of the server, so that the members are not disconnected by the PING timeout while the others join.
+#define FANOUT_KEEPALIVE_MS 20000
+
 int test();
+int latency(int numRounds, int port);
+int acceptStorm(int numClients, int port);
+int disconnectStorm(int numClients, int port);
+int fanout(int numMembers, int port, int numMsgs);
+int packets(int numClients, int port, int numRounds);
+int throughput(int numPairs, int port, int numMsgs);
+int upgrade(int serverPid, int numClients, int port);
+int boundary(int port);
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "latency")
+    {
+        return latency((argc > 2) ? std::atoi(argv[2]) : NUM_LATENCY_ROUNDS, (argc > 3) ? std::atoi(argv[3]) : PORT);
+    }
+    if (argc > 1 && std::string(argv[1]) == "accept")
+    {
+        return acceptStorm((argc > 2) ? std::atoi(argv[2]) : NUM_ACCEPT_STORM_CLIENTS, (argc > 3) ? std::atoi(argv[3]) : PORT);
+    }
+    if (argc > 1 && std::string(argv[1]) == "disconnect")
+    {
+        return disconnectStorm((argc > 2) ? std::atoi(argv[2]) : NUM_ACCEPT_STORM_CLIENTS, (argc > 3) ? std::atoi(argv[3]) : PORT);
+    }
+    if (argc > 1 && std::string(argv[1]) == "fanout")
+    {
+        return fanout((argc > 2) ? std::atoi(argv[2]) : NUM_FANOUT_MEMBERS, (argc > 3) ? std::atoi(argv[3]) : PORT, (argc > 4) ? std::atoi(argv[4]) : NUM_FANOUT_MSGS);
+    }
+    if (argc > 1 && std::string(argv[1]) == "packets")
+    {
+        return packets((argc > 2) ? std::atoi(argv[2]) : NUM_PACKETS_CLIENTS, (argc > 3) ? std::atoi(argv[3]) : PORT, (argc > 4) ? std::atoi(argv[4]) : NUM_PACKETS_ROUNDS);
+    }
+    if (argc > 1 && std::string(argv[1]) == "throughput")
+    {
+        return throughput((argc > 2) ? std::atoi(argv[2]) : NUM_THROUGHPUT_PAIRS, (argc > 3) ? std::atoi(argv[3]) : PORT, (argc > 4) ? std::atoi(argv[4]) : NUM_THROUGHPUT_MSGS);
+    }
+    if (argc > 2 && std::string(argv[1]) == "upgrade")
+    {
+        return upgrade(std::atoi(argv[2]), (argc > 3) ? std::atoi(argv[3]) : NUM_UPGRADE_CLIENTS, (argc > 4) ? std::atoi(argv[4]) : PORT);
+    }
+    if (argc > 1 && std::string(argv[1]) == "boundary")
+    {
+        return boundary((argc > 2) ? std::atoi(argv[2]) : PORT);
+    }
+
     std::vector<std::thread> threads;
     for (int i = 0; i < NUM_THREADS; i++)
     {
@@ -182,3 +271,901 @@ int test()
 
     return 0;
 }
+
+// Connect and register a client with the blocking socket.
+static int connectClient(const std::string& nick, int port)
+{
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0)
+    {
+        return -1;
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    serv_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        close(sockfd);
+        return -1;
+    }
+
+    int noDelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    const std::string message = std::string("PASS ") + PASSWORD + "\r\nNICK " + nick + "\r\nUSER Tester 0 * :Tester\r\n";
+    send(sockfd, message.c_str(), message.length(), 0);
+    return sockfd;
+}
+
+// Receive until the line with the token arrives.
+static bool recvUntil(int sockfd, const std::string& token, std::string& buffer)
+{
+    char chunk[4096];
+    while (buffer.find(token) == std::string::npos)
+    {
+        const ssize_t nRecv = recv(sockfd, chunk, sizeof(chunk), 0);
+        if (nRecv <= 0)
+        {
+            return false;
+        }
+        buffer.append(chunk, nRecv);
+    }
+    buffer.erase(0, buffer.find(token) + token.length());
+    return true;
+}
+
+int latency(int numRounds, int port)
+{
+    const std::string nickA = "LatA" + std::to_string(getpid() % 10000);
+    const std::string nickB = "LatB" + std::to_string(getpid() % 10000);
+    int sockA = connectClient(nickA, port);
+    int sockB = connectClient(nickB, port);
+    if (sockA < 0 || sockB < 0)
+    {
+        std::cerr << "Failed to connect" << std::endl;
+        return 1;
+    }
+
+    std::string bufferA;
+    std::string bufferB;
+    if (!recvUntil(sockA, " 001 ", bufferA) || !recvUntil(sockB, " 001 ", bufferB))
+    {
+        std::cerr << "Failed to register" << std::endl;
+        return 1;
+    }
+
+    // A -> B -> A ping pong. The round-trip is two PRIVMSGs through the server.
+    std::vector<double> latencies;
+    latencies.reserve(numRounds);
+    for (int round = 0; round < numRounds; round++)
+    {
+        const std::string token = "ping" + std::to_string(round);
+        const std::string toB = "PRIVMSG " + nickB + " :" + token + "\r\n";
+        const std::string toA = "PRIVMSG " + nickA + " :" + token + "\r\n";
+
+        const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        send(sockA, toB.c_str(), toB.length(), 0);
+        if (!recvUntil(sockB, token + "\r\n", bufferB))
+        {
+            std::cerr << "Connection closed" << std::endl;
+            return 1;
+        }
+        send(sockB, toA.c_str(), toA.length(), 0);
+        if (!recvUntil(sockA, token + "\r\n", bufferA))
+        {
+            std::cerr << "Connection closed" << std::endl;
+            return 1;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - beginTime).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "[Latency] PRIVMSG round-trip of " << numRounds << " rounds (us)" << std::endl;
+    std::cout << "  p50=" << latencies[latencies.size() * 50 / 100]
+              << " p99=" << latencies[latencies.size() * 99 / 100]
+              << " max=" << latencies.back() << std::endl;
+
+    close(sockA);
+    close(sockB);
+    return 0;
+}
+
+// Connect all clients with non-blocking sockets at once, and register the first numRegistered of them when connected.
+// A registered client is done when the RPL_WELCOME arrives, which means the server accepted and processed it.
+// The others only send the PASS, and are done when it is sent.
+static void connectClients(int numClients, int numRegistered, int port, std::vector<int>& outSockets, int& outNumDone, int& outNumFailed)
+{
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    serv_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    enum EState { CONNECTING, REGISTERING, DONE, FAILED };
+    std::vector<struct pollfd> pollFds(numClients);
+    std::vector<EState> states(numClients, CONNECTING);
+    std::vector<std::string> buffers(numClients);
+
+    outSockets.clear();
+    outNumDone = 0;
+    outNumFailed = 0;
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < numClients; i++)
+    {
+        const int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0)
+        {
+            std::cerr << "Failed to create socket. (Check ulimit -n)" << std::endl;
+            outNumFailed += numClients - i;
+            return;
+        }
+        fcntl(sockfd, F_SETFL, O_NONBLOCK);
+        if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0 && errno != EINPROGRESS)
+        {
+            states[i] = FAILED;
+            outNumFailed++;
+        }
+        pollFds[i].fd = sockfd;
+        pollFds[i].events = (states[i] == FAILED) ? 0 : POLLOUT;
+        outSockets.push_back(sockfd);
+    }
+
+    while (outNumDone + outNumFailed < numClients)
+    {
+        const int numReady = poll(&pollFds[0], numClients, 1000);
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+        if (numReady < 0 || elapsedMs > ACCEPT_STORM_TIMEOUT_MS)
+        {
+            break;
+        }
+
+        for (int i = 0; i < numClients; i++)
+        {
+            if (pollFds[i].revents == 0 || states[i] == DONE || states[i] == FAILED)
+            {
+                continue;
+            }
+
+            if (pollFds[i].revents & (POLLERR | POLLHUP))
+            {
+                states[i] = FAILED;
+                pollFds[i].events = 0;
+                outNumFailed++;
+                continue;
+            }
+
+            if (states[i] == CONNECTING && (pollFds[i].revents & POLLOUT))
+            {
+                if (i >= numRegistered)
+                {
+                    const std::string message = std::string("PASS ") + PASSWORD + "\r\n";
+                    send(pollFds[i].fd, message.c_str(), message.length(), 0);
+                    states[i] = DONE;
+                    pollFds[i].events = 0;
+                    outNumDone++;
+                    continue;
+                }
+                const std::string message = std::string("PASS ") + PASSWORD + "\r\nNICK S" + std::to_string(i) + "\r\nUSER Tester 0 * :Tester\r\n";
+                send(pollFds[i].fd, message.c_str(), message.length(), 0);
+                states[i] = REGISTERING;
+                pollFds[i].events = POLLIN;
+            }
+            else if (states[i] == REGISTERING && (pollFds[i].revents & POLLIN))
+            {
+                char chunk[4096];
+                const ssize_t nRecv = recv(pollFds[i].fd, chunk, sizeof(chunk), 0);
+                if (nRecv <= 0)
+                {
+                    states[i] = FAILED;
+                    pollFds[i].events = 0;
+                    outNumFailed++;
+                    continue;
+                }
+                buffers[i].append(chunk, nRecv);
+                if (buffers[i].find(" 001 ") != std::string::npos)
+                {
+                    states[i] = DONE;
+                    pollFds[i].events = 0;
+                    outNumDone++;
+                }
+            }
+        }
+    }
+}
+
+int acceptStorm(int numClients, int port)
+{
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    connectClients(numClients, numClients, port, sockets, numDone, numFailed);
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+    std::cout << "[Accept] " << numDone << " of " << numClients << " clients registered in " << elapsedSec * 1000 << " ms"
+              << " (failed " << numFailed << ", pending " << numClients - numDone - numFailed << ")" << std::endl;
+    std::cout << "  connections/sec=" << numDone / elapsedSec << std::endl;
+
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    return 0;
+}
+
+// Connect N clients (a half registered, the other half only sent the PASS) and close them all at once.
+// The stall of the server is measured with the PINGs of a probe client sent right after the close.
+int disconnectStorm(int numClients, int port)
+{
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    connectClients(numClients, numClients / 2, port, sockets, numDone, numFailed);
+    if (numDone != numClients)
+    {
+        std::cerr << "Failed to connect " << numClients - numDone << " clients" << std::endl;
+        return 1;
+    }
+
+    const std::string probeNick = "Probe" + std::to_string(getpid() % 10000);
+    const int probe = connectClient(probeNick, port);
+    std::string buffer;
+    if (probe < 0 || !recvUntil(probe, " 001 ", buffer))
+    {
+        std::cerr << "Failed to register the probe" << std::endl;
+        return 1;
+    }
+
+    // The probe is accepted after all clients, so the PONG of this PING means that all of them are in the server.
+    send(probe, "PING sync\r\n", 11, 0);
+    if (!recvUntil(probe, "sync\r\n", buffer))
+    {
+        std::cerr << "Connection closed" << std::endl;
+        return 1;
+    }
+
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    const double closeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+
+    // PING one at a time until the server is idle again. The worst round-trip is the stall by the disconnections.
+    double maxRttMs = 0;
+    double totalMs = 0;
+    int numPings = 0;
+    for (;;)
+    {
+        const std::string token = "tear" + std::to_string(numPings);
+        const std::string ping = "PING " + token + "\r\n";
+        const std::chrono::steady_clock::time_point pingTime = std::chrono::steady_clock::now();
+        send(probe, ping.c_str(), ping.length(), 0);
+        if (!recvUntil(probe, token + "\r\n", buffer))
+        {
+            std::cerr << "Connection closed" << std::endl;
+            return 1;
+        }
+        const std::chrono::steady_clock::time_point pongTime = std::chrono::steady_clock::now();
+        const double rttMs = std::chrono::duration<double, std::milli>(pongTime - pingTime).count();
+        maxRttMs = std::max(maxRttMs, rttMs);
+        totalMs = std::chrono::duration<double, std::milli>(pongTime - beginTime).count();
+        numPings++;
+        if (rttMs < 1 || totalMs > ACCEPT_STORM_TIMEOUT_MS)
+        {
+            break;
+        }
+    }
+
+    std::cout << "[Disconnect] " << numClients << " clients closed (" << numClients / 2 << " registered) in " << closeMs << " ms" << std::endl;
+    std::cout << "  probe max PING round-trip=" << maxRttMs << " ms, idle after " << totalMs << " ms (" << numPings << " PINGs)" << std::endl;
+
+    close(probe);
+    return 0;
+}
+
+// Send all bytes to the non-blocking socket.
+static bool sendAll(int sockfd, const std::string& message)
+{
+    size_t nSentBytes = 0;
+    while (nSentBytes < message.length())
+    {
+        const ssize_t nSent = send(sockfd, message.c_str() + nSentBytes, message.length() - nSentBytes, 0);
+        if (nSent > 0)
+        {
+            nSentBytes += nSent;
+            continue;
+        }
+        if (nSent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd pollFd = { sockfd, POLLOUT, 0 };
+            poll(&pollFd, 1, 1000);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Receive from all non-blocking sockets until each of them received the token. Returns the number of the sockets that did not.
+// The sockets still receiving send a PING every FANOUT_KEEPALIVE_MS.
+static int recvAllUntil(const std::vector<int>& sockets, const std::string& token, uint64_t& outNumRecvBytes)
+{
+    const size_t numSockets = sockets.size();
+    std::vector<struct pollfd> pollFds(numSockets);
+    std::vector<std::string> tails(numSockets);
+    for (size_t i = 0; i < numSockets; i++)
+    {
+        pollFds[i].fd = sockets[i];
+        pollFds[i].events = POLLIN;
+    }
+
+    size_t numPending = numSockets;
+    std::vector<char> chunk(65536);
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    double keepaliveMs = FANOUT_KEEPALIVE_MS;
+    while (numPending > 0)
+    {
+        const int numReady = poll(&pollFds[0], numSockets, 1000);
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+        if (numReady < 0 || elapsedMs > FANOUT_TIMEOUT_MS)
+        {
+            break;
+        }
+
+        if (elapsedMs > keepaliveMs)
+        {
+            for (size_t i = 0; i < numSockets; i++)
+            {
+                if (pollFds[i].events != 0)
+                {
+                    sendAll(pollFds[i].fd, "PING keepalive\r\n");
+                }
+            }
+            keepaliveMs += FANOUT_KEEPALIVE_MS;
+        }
+
+        for (size_t i = 0; i < numSockets; i++)
+        {
+            if (pollFds[i].revents == 0 || pollFds[i].events == 0)
+            {
+                continue;
+            }
+
+            const ssize_t nRecv = recv(pollFds[i].fd, &chunk[0], chunk.size(), 0);
+            if (nRecv <= 0)
+            {
+                if (nRecv == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                {
+                    pollFds[i].events = 0;
+                }
+                continue;
+            }
+            outNumRecvBytes += nRecv;
+
+            // Keep the tail that can be the start of the token in the next chunk.
+            tails[i].append(&chunk[0], nRecv);
+            if (tails[i].find(token) != std::string::npos)
+            {
+                pollFds[i].events = 0;
+                numPending--;
+                continue;
+            }
+            if (tails[i].length() >= token.length())
+            {
+                tails[i].erase(0, tails[i].length() - token.length() + 1);
+            }
+        }
+    }
+    return static_cast<int>(numPending);
+}
+
+// N members join a channel, and the first one sends M long PRIVMSGs at once.
+// The server shares a message block among the members, so the sending queues of the members are deep with the same blocks.
+int fanout(int numMembers, int port, int numMsgs)
+{
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    connectClients(numMembers, numMembers, port, sockets, numDone, numFailed);
+    if (numDone != numMembers)
+    {
+        std::cerr << "Failed to connect " << numMembers - numDone << " members" << std::endl;
+        return 1;
+    }
+
+    // Each JOIN is sent to all members already joined. Wait until every member has its RPL_ENDOFNAMES.
+    const std::chrono::steady_clock::time_point joinTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < numMembers; i++)
+    {
+        sendAll(sockets[i], "JOIN #fanout\r\n");
+    }
+    uint64_t numRecvBytes = 0;
+    if (recvAllUntil(sockets, " 366 ", numRecvBytes) != 0)
+    {
+        std::cerr << "Failed to join" << std::endl;
+        return 1;
+    }
+
+    // The JOINs queued before this are received too.
+    std::vector<int> receivers(sockets.begin() + 1, sockets.end());
+    sendAll(sockets[0], "PRIVMSG #fanout :sync\r\n");
+    if (recvAllUntil(receivers, ":sync\r\n", numRecvBytes) != 0)
+    {
+        std::cerr << "Failed to sync" << std::endl;
+        return 1;
+    }
+    const double joinSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - joinTime).count();
+    std::cout << "[Fanout] " << numMembers << " members joined in " << joinSec << " s" << std::endl;
+
+    std::string burst;
+    const std::string payload(FANOUT_PAYLOAD_LENGTH, 'x');
+    for (int i = 0; i < numMsgs; i++)
+    {
+        burst += "PRIVMSG #fanout :" + payload + ((i + 1 == numMsgs) ? " end" : " msg") + "\r\n";
+    }
+
+    numRecvBytes = 0;
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    sendAll(sockets[0], burst);
+    const int numLost = recvAllUntil(receivers, " end\r\n", numRecvBytes);
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+    std::cout << "[Fanout] " << numMsgs << " messages to " << numMembers << " members in " << elapsedSec * 1000 << " ms"
+              << " (not received " << numLost << ")" << std::endl;
+    std::cout << "  deliveries/sec=" << static_cast<double>(numMsgs) * (numMembers - 1) / elapsedSec
+              << " MB/sec=" << numRecvBytes / elapsedSec / (1024 * 1024) << std::endl;
+
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    return 0;
+}
+
+// Sum of the data segments and the bytes received by the sockets, which are the ones the server sent.
+static bool readRecvCounters(const std::vector<int>& sockets, uint64_t& outNumSegs, uint64_t& outNumBytes)
+{
+    outNumSegs = 0;
+    outNumBytes = 0;
+#if defined(__linux__)
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        struct tcp_info info;
+        socklen_t infoLen = sizeof(info);
+        memset(&info, 0, sizeof(info));
+        if (getsockopt(sockets[i], IPPROTO_TCP, TCP_INFO, &info, &infoLen) == -1)
+        {
+            return false;
+        }
+        outNumSegs += info.tcpi_data_segs_in;
+        outNumBytes += info.tcpi_bytes_received;
+    }
+    return true;
+#else
+    (void)sockets;
+    return false;
+#endif
+}
+
+static void printPacketStats(const char* phase, uint64_t numSegs, uint64_t numBytes, double elapsedSec)
+{
+    std::cout << "[Packets] " << phase << ": " << numSegs << " packets, " << numBytes << " bytes in " << elapsedSec * 1000 << " ms" << std::endl;
+    std::cout << "  packets/sec=" << numSegs / elapsedSec << " bytes/packet=" << static_cast<double>(numBytes) / numSegs << std::endl;
+}
+
+// N clients join a channel one by one, then each of them sends a short PRIVMSG to the channel in each of M rounds.
+// A JOIN is replied with several message blocks, and a round queues N - 1 short messages to each member.
+int packets(int numClients, int port, int numRounds)
+{
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    connectClients(numClients, numClients, port, sockets, numDone, numFailed);
+    if (numDone != numClients)
+    {
+        std::cerr << "Failed to connect " << numClients - numDone << " clients" << std::endl;
+        return 1;
+    }
+
+    uint64_t baseSegs;
+    uint64_t baseBytes;
+    if (!readRecvCounters(sockets, baseSegs, baseBytes))
+    {
+        std::cerr << "TCP_INFO is not supported" << std::endl;
+        return 1;
+    }
+
+    // JOIN one at a time, so that each one is a separate burst of replies.
+    uint64_t numRecvBytes = 0;
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < numClients; i++)
+    {
+        sendAll(sockets[i], "JOIN #packets\r\n");
+        if (recvAllUntil(std::vector<int>(1, sockets[i]), " 366 ", numRecvBytes) != 0)
+        {
+            std::cerr << "Failed to join" << std::endl;
+            return 1;
+        }
+    }
+    std::vector<int> receivers(sockets.begin() + 1, sockets.end());
+    sendAll(sockets[0], "PRIVMSG #packets :sync\r\n");
+    if (recvAllUntil(receivers, ":sync\r\n", numRecvBytes) != 0)
+    {
+        std::cerr << "Failed to sync" << std::endl;
+        return 1;
+    }
+    double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+    uint64_t numSegs;
+    uint64_t numBytes;
+    readRecvCounters(sockets, numSegs, numBytes);
+    printPacketStats("join", numSegs - baseSegs, numBytes - baseBytes, elapsedSec);
+    baseSegs = numSegs;
+    baseBytes = numBytes;
+
+    // Each round waits for its last message, so that the sending queues do not grow over the rounds.
+    beginTime = std::chrono::steady_clock::now();
+    for (int round = 0; round < numRounds; round++)
+    {
+        const std::string token = "r" + std::to_string(round) + " end\r\n";
+        for (int i = 1; i < numClients; i++)
+        {
+            sendAll(sockets[i], "PRIVMSG #packets :r" + std::to_string(round) + " c" + std::to_string(i) + "\r\n");
+        }
+        sendAll(sockets[0], "PRIVMSG #packets :" + token);
+        if (recvAllUntil(receivers, token, numRecvBytes) != 0)
+        {
+            std::cerr << "Failed to receive the round " << round << std::endl;
+            return 1;
+        }
+    }
+    elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+    readRecvCounters(sockets, numSegs, numBytes);
+    printPacketStats("chat", numSegs - baseSegs, numBytes - baseBytes, elapsedSec);
+
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    return 0;
+}
+
+// N pairs of clients, and the first one of each pair sends M short PRIVMSGs to the other at once.
+// The pairs are spread over the reactors by the kernel (SO_REUSEPORT), so that every reactor has messages to process.
+// The messages are sent by a thread while this thread receives them, so that the server is not blocked by the full socket buffers.
+int throughput(int numPairs, int port, int numMsgs)
+{
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    connectClients(numPairs * 2, numPairs * 2, port, sockets, numDone, numFailed);
+    if (numDone != numPairs * 2)
+    {
+        std::cerr << "Failed to connect " << numPairs * 2 - numDone << " clients" << std::endl;
+        return 1;
+    }
+
+    std::vector<int> senders;
+    std::vector<int> receivers;
+    std::vector<std::string> bursts;
+    for (int pairIdx = 0; pairIdx < numPairs; pairIdx++)
+    {
+        senders.push_back(sockets[pairIdx * 2]);
+        receivers.push_back(sockets[pairIdx * 2 + 1]);
+
+        // Nicknames of the connectClients()
+        std::string burst;
+        const std::string target = "PRIVMSG S" + std::to_string(pairIdx * 2 + 1) + " :";
+        for (int i = 0; i < numMsgs; i++)
+        {
+            burst += target + "hello, this is a short chat message " + std::to_string(i) + ((i + 1 == numMsgs) ? " end" : " msg") + "\r\n";
+        }
+        bursts.push_back(burst);
+    }
+
+    // The bursts are sent in slices of every pair in turn, so that the pairs are processed at the same time.
+    uint64_t numRecvBytes = 0;
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    std::thread senderThread([&]()
+    {
+        const size_t sliceLength = 4096;
+        for (size_t offset = 0; ; offset += sliceLength)
+        {
+            bool bSent = false;
+            for (int pairIdx = 0; pairIdx < numPairs; pairIdx++)
+            {
+                if (offset < bursts[pairIdx].length())
+                {
+                    sendAll(senders[pairIdx], bursts[pairIdx].substr(offset, sliceLength));
+                    bSent = true;
+                }
+            }
+            if (!bSent)
+            {
+                break;
+            }
+        }
+    });
+    const int numLost = recvAllUntil(receivers, " end\r\n", numRecvBytes);
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+    senderThread.join();
+
+    std::cout << "[Throughput] " << numMsgs << " messages of " << numPairs << " pairs in " << elapsedSec * 1000 << " ms"
+              << " (not received " << numLost << ")" << std::endl;
+    std::cout << "  messages/sec=" << static_cast<double>(numMsgs) * numPairs / elapsedSec
+              << " MB/sec=" << numRecvBytes / elapsedSec / (1024 * 1024) << std::endl;
+
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    return numLost == 0 ? 0 : 1;
+}
+
+// The process exited, or is a zombie not reaped yet by its parent.
+static bool isProcessGone(int pid)
+{
+    if (kill(pid, 0) == -1 && errno == ESRCH)
+    {
+        return true;
+    }
+#if defined(__linux__)
+    std::ifstream statFile("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    std::getline(statFile, stat);
+    const size_t stateIdx = stat.rfind(')');
+    return stateIdx != std::string::npos && stateIdx + 2 < stat.length() && stat[stateIdx + 2] == 'Z';
+#else
+    return false;
+#endif
+}
+
+// Receive the blocking socket until the token arrives, and keep all received text.
+static bool recvText(int sockfd, const std::string& token, std::string& outText)
+{
+    char chunk[4096];
+    while (outText.find(token) == std::string::npos)
+    {
+        const ssize_t nRecv = recv(sockfd, chunk, sizeof(chunk), 0);
+        if (nRecv <= 0)
+        {
+            return false;
+        }
+        outText.append(chunk, nRecv);
+    }
+    return true;
+}
+
+// N clients join the channels of NUM_UPGRADE_CLIENTS_PER_CHANNEL members, and the first member of each channel sets the topic.
+// They keep sending to the channels while the server is hot upgraded, and every connection, nickname, member and topic must survive it.
+int upgrade(int serverPid, int numClients, int port)
+{
+    const int numChannels = std::max(1, numClients / NUM_UPGRADE_CLIENTS_PER_CHANNEL);
+    std::vector<int> sockets;
+    int numDone;
+    int numFailed;
+    connectClients(numClients, numClients, port, sockets, numDone, numFailed);
+    if (numDone != numClients)
+    {
+        std::cerr << "Failed to connect " << numClients - numDone << " clients" << std::endl;
+        return 1;
+    }
+
+    // The first members join first, so that they are the operators to set the topics.
+    uint64_t numRecvBytes = 0;
+    for (int phase = 0; phase < 2; phase++)
+    {
+        std::vector<int> joiners;
+        for (int i = (phase == 0) ? 0 : numChannels; i < ((phase == 0) ? numChannels : numClients); i++)
+        {
+            const std::string channel = "#up" + std::to_string(i % numChannels);
+            std::string message = "JOIN " + channel + "\r\n";
+            if (phase == 0)
+            {
+                message += "TOPIC " + channel + " :topic of " + channel + "\r\n";
+            }
+            sendAll(sockets[i], message + "PING joined\r\n");
+            joiners.push_back(sockets[i]);
+        }
+        if (recvAllUntil(joiners, ":joined\r\n", numRecvBytes) != 0)
+        {
+            std::cerr << "Failed to join the channels" << std::endl;
+            return 1;
+        }
+    }
+
+    // Talk until the old process exits after the handover.
+    const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    if (kill(serverPid, SIGUSR2) == -1)
+    {
+        std::cerr << "Failed to signal the server " << serverPid << std::endl;
+        return 1;
+    }
+    int numRounds = 0;
+    while (!isProcessGone(serverPid))
+    {
+        if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count() > UPGRADE_TIMEOUT_MS)
+        {
+            std::cerr << "The server " << serverPid << " did not exit in " << UPGRADE_TIMEOUT_MS << " ms" << std::endl;
+            return 1;
+        }
+        for (int i = 0; i < numClients; i++)
+        {
+            sendAll(sockets[i], "PRIVMSG #up" + std::to_string(i % numChannels) + " :round " + std::to_string(numRounds) + "\r\n");
+        }
+        numRounds++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const double upgradeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+
+    // Every connection is served by the new process.
+    int numErrors = 0;
+    for (int i = 0; i < numClients; i++)
+    {
+        sendAll(sockets[i], "PING alive\r\n");
+    }
+    const int numClosed = recvAllUntil(sockets, ":alive\r\n", numRecvBytes);
+    numErrors += numClosed;
+
+    // The nicknames are still in use, and the channels keep the members and the topics.
+    const int probeSocket = connectClient("Probe" + std::to_string(getpid() % 10000), port);
+    std::string probeText;
+    if (probeSocket < 0 || !recvText(probeSocket, " 001 ", probeText))
+    {
+        std::cerr << "Failed to connect the probe client" << std::endl;
+        return 1;
+    }
+    std::string probeMessage;
+    for (int i = 0; i < numClients; i++)
+    {
+        probeMessage += "NICK S" + std::to_string(i) + "\r\n";
+    }
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++)
+    {
+        probeMessage += "JOIN #up" + std::to_string(channelIdx) + "\r\n";
+    }
+    probeMessage += "PING probed\r\n";
+    probeText.clear();
+    if (!sendAll(probeSocket, probeMessage) || !recvText(probeSocket, ":probed\r\n", probeText))
+    {
+        std::cerr << "The probe client is disconnected" << std::endl;
+        return 1;
+    }
+
+    int numNicksInUse = 0;
+    for (size_t idx = probeText.find(" 433 "); idx != std::string::npos; idx = probeText.find(" 433 ", idx + 1))
+    {
+        numNicksInUse++;
+    }
+    if (numNicksInUse != numClients)
+    {
+        std::cerr << "Lost nicknames: " << numClients - numNicksInUse << std::endl;
+        numErrors++;
+    }
+
+    for (int channelIdx = 0; channelIdx < numChannels; channelIdx++)
+    {
+        const std::string channel = "#up" + std::to_string(channelIdx);
+        if (probeText.find(" 332 ") == std::string::npos || probeText.find(channel + " :topic of " + channel + "\r\n") == std::string::npos)
+        {
+            std::cerr << "Lost the topic of " << channel << std::endl;
+            numErrors++;
+        }
+
+        // The names can be split into several RPL_NAMREPLY, and have the prefix of the operator or the member.
+        std::set<std::string> names;
+        const std::string namesPrefix = " 353 ";
+        for (size_t lineIdx = probeText.find(namesPrefix); lineIdx != std::string::npos; lineIdx = probeText.find(namesPrefix, lineIdx + 1))
+        {
+            const size_t lineEnd = probeText.find("\r\n", lineIdx);
+            const std::string line = probeText.substr(lineIdx, lineEnd - lineIdx);
+            const size_t namesIdx = line.find(channel + " :");
+            if (namesIdx == std::string::npos)
+            {
+                continue;
+            }
+            std::string name;
+            for (size_t i = namesIdx + channel.length() + 2; i <= line.length(); i++)
+            {
+                if (i == line.length() || line[i] == ' ')
+                {
+                    if (!name.empty())
+                    {
+                        names.insert((name[0] == '@' || name[0] == '+') ? name.substr(1) : name);
+                    }
+                    name.clear();
+                    continue;
+                }
+                name += line[i];
+            }
+        }
+        for (int i = channelIdx; i < numClients; i += numChannels)
+        {
+            if (names.count("S" + std::to_string(i)) == 0)
+            {
+                std::cerr << "Lost the member S" << i << " of " << channel << std::endl;
+                numErrors++;
+            }
+        }
+    }
+
+    std::cout << "[Upgrade] " << numClients << " clients in " << numChannels << " channels, handed over in " << upgradeMs << " ms"
+              << " while sending " << numRounds << " rounds" << std::endl;
+    std::cout << "  disconnected=" << numClosed << " errors=" << numErrors << std::endl;
+
+    close(probeSocket);
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        close(sockets[i]);
+    }
+    return numErrors == 0 ? 0 : 1;
+}
+
+// A sends a PRIVMSG line of each length to B, alone and after a short line so that it is placed at another offset of the receive block.
+// The line of LINE_PAYLOAD_LEN_MAX bytes or shorter must be relayed, and the longer one must be dropped without closing the connection.
+int boundary(int port)
+{
+    const std::string nickA = "BndA" + std::to_string(getpid() % 10000);
+    const std::string nickB = "BndB" + std::to_string(getpid() % 10000);
+    int sockA = connectClient(nickA, port);
+    int sockB = connectClient(nickB, port);
+    if (sockA < 0 || sockB < 0)
+    {
+        std::cerr << "Failed to connect" << std::endl;
+        return 1;
+    }
+
+    std::string bufferA;
+    std::string bufferB;
+    if (!recvUntil(sockA, " 001 ", bufferA) || !recvUntil(sockB, " 001 ", bufferB))
+    {
+        std::cerr << "Failed to register" << std::endl;
+        return 1;
+    }
+
+    int numErrors = 0;
+    const int payloadLens[] = { LINE_PAYLOAD_LEN_MAX - 1, LINE_PAYLOAD_LEN_MAX, LINE_PAYLOAD_LEN_MAX + 1 };
+    for (int lenIdx = 0; lenIdx < 3; lenIdx++)
+    {
+        for (int bShifted = 0; bShifted < 2; bShifted++)
+        {
+            const int payloadLen = payloadLens[lenIdx];
+            const std::string token = "len" + std::to_string(payloadLen) + "_" + std::to_string(bShifted);
+            std::string line = "PRIVMSG " + nickB + " :" + token + " ";
+            line.append(payloadLen - line.length(), 'x');
+            line += "\r\n";
+            const std::string shift = bShifted ? "PING :shift\r\n" : "";
+
+            // The PONG to A means the line is processed, and the PONG to B comes after the relayed line.
+            if (!sendAll(sockA, shift + line + "PING :" + token + "\r\n") || !recvUntil(sockA, token + "\r\n", bufferA))
+            {
+                std::cerr << token << ": Connection of the sender closed" << std::endl;
+                return 1;
+            }
+            std::string textB;
+            if (!sendAll(sockB, "PING :" + token + "\r\n") || !recvText(sockB, token + "\r\n", textB))
+            {
+                std::cerr << token << ": Connection of the receiver closed" << std::endl;
+                return 1;
+            }
+
+            const bool bRelayed = textB.find(" :" + token + " x") != std::string::npos;
+            const bool bExpected = payloadLen <= LINE_PAYLOAD_LEN_MAX;
+            std::cout << "  payload=" << payloadLen << " shifted=" << bShifted << " relayed=" << bRelayed << (bRelayed == bExpected ? "" : "  <- WRONG") << std::endl;
+            if (bRelayed != bExpected)
+            {
+                numErrors++;
+            }
+        }
+    }
+    std::cout << "[Boundary] errors=" << numErrors << std::endl;
+
+    close(sockA);
+    close(sockB);
+    return numErrors == 0 ? 0 : 1;
+}